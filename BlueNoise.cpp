@@ -0,0 +1,525 @@
+#include "BlueNoise.h"
+
+// Generated offline with void-and-cluster (Ulichney 1993): toroidal
+// Gaussian energy with sigma 1.9, a 10% initial pattern from xorshift32
+// seeds 1424447641 (R) and 2654435769 (G), ranks scaled to 0..255 so
+// every value occurs 16 times.
+static const unsigned char blueNoise[BlueNoise::Size * BlueNoise::Size * 2] = {
+    107,252, 53,59, 184,195, 71,231, 117,26, 243,175, 191,10, 160,53,
+    141,164, 97,88, 202,70, 11,8, 137,159, 108,35, 239,82, 198,112,
+    214,3, 175,125, 150,198, 205,55, 35,141, 60,44, 202,229, 22,3,
+    188,178, 65,221, 119,191, 76,133, 38,244, 167,43, 13,66, 49,224,
+    204,166, 225,204, 55,80, 137,127, 27,193, 220,171, 106,147, 53,201,
+    190,252, 72,178, 17,227, 243,115, 89,40, 5,206, 78,67, 18,190,
+    121,123, 210,254, 30,200, 56,60, 79,27, 39,169, 102,16, 22,236,
+    242,106, 131,227, 179,165, 223,81, 66,248, 251,99, 43,204, 74,78,
+    29,114, 162,14, 236,152, 38,68, 155,140, 61,92, 89,105, 221,240,
+    16,225, 236,149, 32,101, 117,252, 163,201, 79,129, 65,232, 39,187,
+    96,48, 51,95, 18,237, 224,156, 98,216, 168,129, 126,69, 149,85,
+    240,54, 48,145, 158,11, 255,61, 102,22, 224,215, 82,88, 244,31,
+    156,112, 7,56, 117,235, 241,157, 96,67, 163,246, 81,15, 211,51,
+    31,137, 157,68, 224,6, 140,166, 57,57, 194,138, 237,171, 225,107,
+    65,52, 141,18, 186,179, 109,153, 239,117, 15,196, 203,49, 218,145,
+    148,208, 75,61, 25,120, 155,40, 94,14, 129,175, 211,33, 188,163,
+    222,49, 122,95, 92,170, 201,245, 2,43, 213,208, 27,192, 44,128,
+    123,37, 175,187, 195,16, 49,176, 249,51, 19,92, 228,20, 141,207,
+    158,144, 237,226, 131,73, 69,10, 190,111, 234,185, 9,251, 77,158,
+    175,199, 29,237, 139,109, 201,160, 57,183, 115,125, 28,153, 132,246,
+    94,135, 173,98, 34,10, 200,37, 61,116, 184,96, 236,228, 7,81,
+    120,187, 198,38, 111,102, 40,85, 153,230, 175,26, 113,244, 46,4,
+    160,215, 9,83, 89,131, 228,227, 133,95, 177,243, 64,80, 91,161,
+    53,7, 232,96, 113,182, 202,240, 5,153, 168,68, 21,229, 149,135,
+    64,239, 13,205, 249,123, 140,84, 105,18, 130,158, 168,61, 252,28,
+    108,78, 78,136, 62,65, 153,214, 217,111, 102,168, 173,247, 192,63,
+    0,33, 85,172, 178,22, 109,193, 45,89, 141,36, 90,24, 217,103,
+    107,121, 208,39, 93,73, 10,253, 180,99, 146,196, 194,8, 214,72,
+    63,173, 231,192, 80,217, 126,144, 14,182, 149,209, 42,29, 135,129,
+    246,158, 62,238, 84,196, 22,150, 209,211, 98,119, 32,76, 131,157,
+    199,143, 250,238, 26,40, 153,70, 48,0, 118,212, 254,34, 162,126,
+    10,253, 174,25, 40,200, 246,53, 58,130, 104,107, 241,196, 87,22,
+    199,147, 171,7, 75,219, 49,182, 181,109, 230,227, 68,255, 149,171,
+    188,115, 4,222, 241,241, 130,41, 88,142, 35,5, 125,77, 56,155,
+    115,132, 254,115, 30,213, 211,56, 15,240, 159,139, 248,223, 57,174,
+    38,15, 129,211, 233,141, 23,171, 242,33, 71,53, 161,233, 3,209,
+    43,23, 187,48, 143,254, 254,86, 208,17, 109,58, 74,168, 178,109,
+    93,218, 169,21, 229,125, 185,13, 255,181, 68,45, 217,98, 84,199,
+    172,173, 103,21, 70,112, 215,186, 192,137, 3,57, 142,174, 105,190,
+    199,67, 127,142, 84,221, 143,83, 214,2, 181,215, 44,87, 136,178,
+    111,103, 34,75, 191,37, 217,56, 20,132, 84,0, 35,144, 203,91,
+    93,204, 139,8, 211,156, 21,86, 180,197, 204,122, 13,222, 223,184,
+    73,98, 198,245, 151,81, 62,149, 231,123, 121,165, 24,63, 195,78,
+    181,231, 148,50, 81,90, 170,5, 123,222, 37,118, 100,83, 247,147,
+    110,106, 166,123, 18,66, 99,163, 51,132, 164,240, 232,199, 26,43,
+    214,72, 48,93, 11,56, 122,255, 136,67, 18,135, 148,234, 1,34,
+    241,63, 55,92, 127,207, 168,251, 83,154, 37,103, 219,232, 73,87,
+    21,113, 229,158, 189,38, 27,172, 120,236, 76,118, 8,42, 233,62,
+    57,225, 125,188, 146,164, 98,243, 160,199, 116,74, 237,46, 13,189,
+    52,22, 227,54, 40,103, 113,180, 68,29, 146,235, 243,55, 161,18,
+    95,42, 42,198, 133,8, 184,178, 87,45, 173,209, 72,2, 114,191,
+    226,151, 1,128, 65,182, 215,203, 51,65, 228,135, 200,165, 84,38,
+    130,237, 220,186, 69,3, 30,225, 225,102, 194,78, 2,147, 117,5,
+    144,245, 104,175, 161,204, 77,106, 54,166, 195,217, 233,17, 117,188,
+    182,127, 34,223, 206,47, 19,165, 238,29, 97,12, 180,219, 244,45,
+    46,19, 155,242, 65,100, 99,136, 226,191, 151,27, 163,166, 209,253,
+    252,19, 26,139, 227,112, 6,29, 243,153, 62,99, 176,216, 125,122,
+    166,162, 102,248, 156,131, 193,210, 232,69, 81,150, 49,108, 136,208,
+    216,161, 22,69, 246,232, 101,105, 4,29, 205,92, 138,115, 47,243,
+    97,100, 252,30, 156,247, 105,157, 188,107, 140,229, 19,17, 154,179,
+    55,93, 205,202, 177,151, 122,41, 154,211, 90,25, 66,189, 250,113,
+    200,224, 36,154, 237,30, 206,142, 173,1, 94,84, 44,114, 157,249,
+    78,150, 139,5, 227,81, 108,118, 150,69, 60,203, 205,147, 132,123,
+    115,197, 170,180, 4,10, 250,75, 52,59, 194,152, 18,206, 94,128,
+    176,50, 156,92, 80,213, 55,65, 197,230, 141,13, 207,176, 24,236,
+    76,63, 247,80, 58,228, 7,37, 169,13, 27,171, 105,83, 176,249,
+    9,127, 119,25, 167,141, 53,218, 222,255, 35,185, 240,136, 165,21,
+    18,219, 201,58, 33,82, 119,14, 10,44, 92,192, 174,251, 33,58,
+    236,29, 8,76, 81,117, 247,248, 39,54, 138,177, 182,124, 52,62,
+    156,85, 86,131, 128,49, 7,235, 244,184, 111,39, 28,161, 224,52,
+    62,102, 189,197, 9,176, 48,243, 123,133, 164,94, 13,238, 30,60,
+    89,80, 213,214, 137,48, 177,247, 34,220, 110,109, 132,12, 67,81,
+    205,160, 108,246, 186,6, 132,191, 39,125, 88,85, 105,38, 221,107,
+    183,27, 134,147, 201,187, 89,117, 123,98, 253,239, 189,137, 64,1,
+    236,190, 204,94, 79,169, 190,58, 147,76, 123,156, 80,48, 215,71,
+    62,198, 129,164, 177,122, 241,214, 75,147, 210,72, 250,100, 68,128,
+    116,220, 145,140, 188,169, 106,14, 12,90, 215,159, 126,236, 16,36,
+    72,208, 219,13, 24,194, 187,69, 66,95, 142,201, 210,227, 167,73,
+    99,139, 245,31, 86,230, 199,17, 253,187, 74,38, 231,171, 193,3,
+    57,162, 241,105, 71,151, 202,127, 85,91, 221,37, 236,237, 41,195,
+    90,120, 245,179, 16,43, 223,145, 171,171, 254,252, 0,210, 48,136,
+    150,200, 33,3, 18,167, 224,52, 143,218, 39,195, 213,44, 86,62,
+    154,226, 31,117, 109,36, 67,194, 244,124, 11,16, 107,238, 151,176,
+    191,142, 89,38, 45,234, 223,92, 57,175, 132,0, 163,205, 194,162,
+    97,11, 46,242, 225,63, 61,195, 169,108, 239,218, 100,19, 193,142,
+    233,250, 170,102, 106,170, 150,116, 41,247, 81,129, 123,22, 5,174,
+    22,210, 129,64, 155,98, 177,156, 38,54, 95,113, 142,228, 111,138,
+    151,255, 40,32, 105,204, 12,21, 123,167, 148,183, 169,144, 2,69,
+    143,227, 50,32, 121,105, 71,76, 30,57, 158,22, 115,156, 235,49,
+    66,223, 98,89, 210,250, 110,71, 71,126, 160,18, 1,158, 128,181,
+    47,79, 140,148, 227,213, 19,9, 163,228, 49,88, 179,204, 29,104,
+    238,4, 5,114, 144,188, 168,25, 23,133, 110,239, 42,113, 2,48,
+    214,188, 129,97, 157,33, 26,229, 205,131, 75,80, 45,47, 31,184,
+    114,73, 137,157, 57,221, 227,26, 250,58, 175,153, 195,6, 238,108,
+    219,244, 53,44, 112,127, 26,215, 216,79, 6,196, 174,23, 222,90,
+    21,69, 187,192, 229,115, 161,233, 27,64, 58,212, 76,1, 191,97,
+    33,200, 232,131, 152,220, 101,236, 214,195, 188,119, 79,97, 130,70,
+    196,183, 164,111, 250,32, 176,142, 55,206, 231,91, 101,110, 199,253,
+    247,25, 183,52, 93,242, 212,109, 132,164, 202,40, 97,131, 225,60,
+    70,225, 116,77, 206,248, 100,52, 197,66, 151,219, 227,30, 84,144,
+    176,77, 17,211, 235,121, 90,155, 118,2, 143,173, 161,203, 253,98,
+    179,121, 0,4, 92,43, 200,140, 15,89, 101,214, 34,192, 72,78,
+    144,148, 182,14, 205,168, 67,251, 136,10, 241,150, 55,219, 79,178,
+    206,50, 129,131, 92,8, 255,84, 183,45, 215,135, 242,251, 114,55,
+    208,163, 180,13, 60,149, 202,90, 12,7, 139,167, 57,244, 218,15,
+    8,129, 85,162, 43,237, 15,8, 188,176, 120,232, 23,35, 170,133,
+    62,202, 12,174, 118,97, 40,66, 83,184, 255,146, 58,251, 158,31,
+    136,209, 37,168, 251,148, 78,101, 10,198, 237,158, 63,87, 140,173,
+    254,235, 74,57, 197,181, 51,42, 185,254, 7,67, 222,148, 84,232,
+    66,56, 213,243, 47,204, 158,176, 131,239, 61,35, 118,120, 162,235,
+    91,180, 41,87, 249,206, 82,104, 166,68, 118,121, 100,39, 43,100,
+    158,240, 0,147, 66,222, 138,188, 48,101, 102,174, 17,114, 129,26,
+    95,84, 5,177, 165,65, 85,212, 248,37, 42,139, 175,202, 28,228,
+    243,41, 122,61, 154,193, 136,83, 78,54, 241,151, 35,66, 217,216,
+    76,86, 157,5, 237,139, 173,199, 191,21, 6,79, 125,117, 22,157,
+    189,95, 218,20, 55,183, 181,8, 126,124, 93,41, 187,252, 32,21,
+    120,106, 104,9, 37,137, 135,88, 247,222, 98,105, 20,15, 149,31,
+    195,192, 121,134, 243,80, 26,106, 224,67, 184,159, 210,50, 11,25,
+    232,134, 106,57, 3,36, 153,185, 196,139, 16,235, 234,201, 178,167,
+    247,14, 113,76, 33,163, 170,247, 82,17, 197,151, 155,74, 66,238,
+    221,123, 243,46, 23,254, 127,109, 112,184, 227,55, 93,81, 147,103,
+    104,146, 191,212, 60,119, 221,23, 202,224, 93,104, 149,168, 132,16,
+    107,118, 196,160, 52,230, 30,46, 148,244, 73,211, 232,9, 172,192,
+    90,68, 107,49, 155,137, 28,230, 212,211, 47,72, 162,190, 13,130,
+    206,224, 171,163, 154,206, 68,26, 211,193, 174,117, 58,168, 129,215,
+    36,91, 103,161, 168,23, 71,11, 87,226, 149,187, 254,99, 51,208,
+    191,225, 126,113, 217,241, 59,4, 35,161, 212,26, 128,62, 69,112,
+    145,208, 192,33, 225,54, 211,119, 9,204, 233,39, 39,219, 174,190,
+    78,141, 47,202, 144,19, 196,156, 66,128, 159,239, 17,28, 205,174,
+    70,11, 230,253, 32,93, 6,179, 112,137, 178,246, 49,45, 253,194,
+    4,240, 88,75, 137,32, 218,127, 100,104, 114,57, 209,169, 46,235,
+    245,217, 0,108, 68,244, 171,34, 137,90, 248,114, 112,12, 222,152,
+    56,64, 243,95, 3,243, 231,74, 30,52, 112,140, 203,247, 244,41,
+    227,64, 12,183, 188,114, 139,253, 42,126, 109,143, 20,6, 80,169,
+    138,71, 28,150, 173,194, 97,94, 144,221, 184,49, 88,86, 29,250,
+    14,128, 96,183, 53,92, 122,138, 147,67, 109,231, 249,4, 137,96,
+    118,31, 187,217, 103,73, 235,93, 32,0, 212,219, 132,117, 182,190,
+    45,69, 168,157, 89,36, 157,201, 237,72, 19,2, 64,126, 207,96,
+    182,183, 228,60, 16,218, 244,153, 61,178, 163,88, 14,134, 81,37,
+    133,123, 200,82, 118,154, 227,167, 15,58, 83,178, 70,241, 194,49,
+    97,199, 142,36, 86,124, 124,179, 165,157, 46,12, 90,82, 156,128,
+    79,231, 55,146, 209,213, 238,46, 4,200, 201,60, 177,90, 228,248,
+    164,18, 68,45, 245,124, 232,76, 113,175, 49,134, 224,189, 163,151,
+    201,0, 239,216, 76,234, 182,24, 23,178, 88,109, 58,161, 26,59,
+    216,169, 156,115, 8,231, 173,193, 51,60, 80,163, 250,45, 2,89,
+    115,227, 244,130, 128,52, 216,110, 73,220, 140,155, 166,32, 33,210,
+    116,143, 71,19, 158,112, 126,197, 203,0, 35,224, 181,26, 222,149,
+    151,188, 31,17, 240,200, 94,4, 184,225, 35,142, 158,207, 131,80,
+    42,174, 182,109, 19,3, 218,213, 74,237, 192,100, 5,204, 136,171,
+    28,0, 179,29, 116,96, 91,77, 160,173, 128,33, 59,219, 96,111,
+    117,158, 39,202, 199,29, 18,254, 77,107, 5,12, 249,229, 60,72,
+    107,42, 136,104, 40,159, 159,80, 228,196, 194,47, 169,130, 204,240,
+    36,10, 71,148, 223,41, 92,176, 123,132, 190,245, 100,206, 59,143,
+    142,6, 25,240, 187,170, 53,19, 102,187, 195,236, 125,85, 235,51,
+    96,249, 45,173, 175,81, 24,43, 83,252, 251,70, 140,99, 64,238,
+    102,47, 191,64, 44,255, 60,100, 146,125, 204,25, 236,94, 9,15,
+    228,133, 65,251, 201,150, 102,47, 146,67, 240,32, 225,186, 170,111,
+    104,55, 253,243, 145,194, 66,157, 32,15, 219,235, 247,129, 22,80,
+    210,178, 146,230, 87,63, 158,145, 134,209, 192,23, 122,199, 149,119,
+    174,172, 209,61, 8,242, 253,8, 67,145, 127,214, 3,86, 97,186,
+    134,102, 54,248, 252,83, 141,24, 21,104, 237,14, 153,77, 177,112,
+    226,63, 83,210, 209,99, 11,80, 41,140, 249,61, 81,116, 7,160,
+    190,11, 143,100, 214,233, 108,140, 193,120, 51,183, 119,208, 235,166,
+    10,115, 78,219, 160,135, 217,74, 124,193, 106,45, 25,234, 174,160,
+    114,218, 152,30, 247,190, 27,89, 56,119, 117,221, 39,148, 67,75,
+    216,225, 15,137, 44,120, 234,63, 192,103, 77,149, 151,189, 49,54,
+    185,1, 1,135, 223,88, 57,38, 177,165, 213,55, 93,96, 37,247,
+    19,26, 83,135, 118,205, 101,122, 49,34, 219,250, 150,20, 239,70,
+    183,198, 12,53, 197,139, 167,213, 41,228, 206,154, 13,37, 72,198,
+    36,180, 164,28, 110,151, 147,248, 175,10, 220,206, 23,177, 155,228,
+    225,129, 58,201, 242,62, 2,28, 153,158, 94,13, 19,55, 169,85,
+    207,6, 130,179, 176,159, 5,28, 243,214, 52,170, 72,118, 213,61,
+    90,102, 48,75, 168,231, 132,138, 183,166, 12,24, 95,255, 187,43,
+    125,91, 202,13, 164,181, 100,217, 122,250, 7,44, 170,207, 108,27,
+    236,242, 127,102, 102,218, 253,183, 43,239, 26,126, 240,156, 69,84,
+    222,186, 236,226, 193,50, 142,94, 179,176, 17,107, 111,155, 83,222,
+    208,173, 120,30, 79,118, 104,67, 65,182, 114,94, 135,255, 217,165,
+    96,120, 254,49, 58,223, 203,128, 119,43, 64,105, 133,24, 107,74,
+    38,39, 89,217, 127,168, 70,88, 230,195, 179,221, 218,130, 36,145,
+    111,246, 252,38, 26,108, 99,56, 85,87, 195,148, 140,248, 255,35,
+    127,182, 1,11, 76,207, 234,56, 212,6, 157,196, 249,127, 142,176,
+    80,210, 54,162, 229,35, 23,83, 181,7, 208,140, 85,92, 140,121,
+    66,167, 33,198, 195,14, 74,115, 117,69, 165,6, 105,215, 185,37,
+    156,146, 55,14, 32,76, 164,191, 75,230, 245,64, 44,44, 160,128,
+    62,93, 22,232, 240,158, 155,201, 181,5, 229,126, 51,57, 194,21,
+    123,236, 5,89, 232,188, 18,69, 90,164, 163,195, 243,241, 204,94,
+    183,152, 169,6, 27,113, 200,47, 44,244, 132,104, 80,23, 148,73,
+    53,203, 67,92, 201,225, 154,238, 223,184, 37,1, 164,71, 17,198,
+    188,144, 205,124, 34,172, 108,110, 86,236, 63,97, 200,61, 31,18,
+    2,105, 154,239, 88,53, 136,199, 58,113, 38,172, 249,226, 13,74,
+    220,59, 174,154, 156,45, 20,82, 143,141, 203,192, 9,233, 137,109,
+    90,66, 128,169, 1,116, 215,158, 94,12, 199,140, 31,210, 226,2,
+    100,188, 144,77, 216,18, 33,241, 0,46, 246,146, 82,215, 27,76,
+    159,140, 184,7, 136,110, 78,31, 191,216, 29,144, 49,52, 74,184,
+    10,135, 146,254, 255,189, 102,75, 162,148, 9,36, 244,234, 194,170,
+    92,188, 231,10, 138,124, 47,139, 120,22, 180,209, 107,112, 63,228,
+    96,48, 225,86, 147,249, 177,41, 21,80, 45,158, 121,206, 222,143,
+    178,72, 245,123, 112,150, 213,231, 236,66, 159,24, 119,186, 199,246,
+    96,33, 52,132, 244,224, 87,252, 231,168, 59,19, 220,51, 45,133,
+    252,208, 197,252, 113,218, 234,31, 58,239, 137,84, 122,112, 172,253,
+    86,145, 50,52, 190,110, 126,170, 94,86, 139,194, 170,106, 212,176,
+    68,227, 105,202, 45,156, 246,251, 149,82, 218,2, 98,119, 235,209,
+    117,67, 213,26, 79,223, 52,126, 114,178, 211,212, 30,62, 122,116,
+    166,46, 1,156, 186,68, 80,168, 12,50, 233,98, 28,134, 240,18,
+    159,162, 54,215, 117,25, 245,150, 134,220, 230,185, 163,33, 105,245,
+    73,222, 47,2, 194,189, 10,94, 70,129, 102,158, 187,15, 76,105,
+    26,208, 129,91, 208,188, 4,26, 183,104, 124,203, 78,95, 169,178,
+    16,2, 69,86, 175,45, 150,130, 21,57, 185,202, 6,167, 255,37,
+    157,124, 17,226, 233,209, 72,134, 204,34, 42,247, 111,17, 14,65,
+    147,40, 228,132, 32,54, 169,174, 125,101, 2,232, 176,20, 138,87,
+    62,173, 21,107, 189,56, 232,17, 142,92, 184,2, 63,136, 227,99,
+    104,223, 24,253, 248,32, 206,195, 66,241, 148,79, 212,177, 135,245,
+    82,62, 15,101, 198,192, 70,68, 6,9, 192,130, 92,115, 19,49,
+    207,86, 129,174, 33,29, 174,42, 149,253, 20,218, 44,52, 229,147,
+    165,175, 147,3, 112,122, 41,56, 101,149, 152,75, 32,240, 239,159,
+    109,28, 208,105, 35,196, 82,152, 219,99, 107,179, 73,22, 202,68,
+    36,196, 179,8, 106,95, 164,63, 59,153, 225,223, 178,118, 251,163,
+    54,96, 196,243, 92,15, 210,124, 59,63, 108,190, 197,160, 42,246,
+    225,35, 165,154, 126,235, 37,202, 89,163, 14,242, 76,193, 176,151,
+    45,17, 158,84, 129,107, 112,215, 171,120, 92,153, 48,40, 121,188,
+    186,5, 41,118, 211,136, 101,237, 172,176, 150,94, 58,16, 251,200,
+    139,161, 168,111, 96,211, 224,139, 124,76, 255,201, 138,118, 212,83,
+    60,233, 239,67, 178,242, 69,212, 250,181, 213,36, 192,225, 92,64,
+    139,122, 50,244, 127,183, 247,73, 162,8, 46,220, 238,241, 130,160,
+    211,79, 118,248, 249,175, 7,26, 150,187, 22,81, 88,1, 120,207,
+    77,182, 133,78, 11,197, 238,35, 72,225, 17,139, 252,47, 82,129,
+    152,216, 95,78, 4,142, 245,44, 203,119, 153,81, 251,30, 136,54,
+    219,205, 86,181, 56,143, 225,6, 33,59, 245,25, 197,232, 3,91,
+    165,147, 251,205, 141,34, 29,53, 236,78, 79,226, 37,142, 216,251,
+    5,70, 63,57, 241,238, 80,9, 54,102, 179,179, 0,35, 107,11,
+    83,138, 22,164, 197,43, 14,110, 135,129, 55,10, 24,139, 160,48,
+    181,201, 223,143, 8,18, 98,229, 190,120, 25,136, 143,49, 65,104,
+    14,16, 56,216, 87,113, 219,44, 130,234, 198,125, 235,53, 36,141,
+    188,25, 221,231, 151,151, 116,113, 183,208, 161,74, 134,11, 29,95,
+    208,197, 180,180, 69,8, 110,101, 170,227, 56,66, 98,172, 34,247,
+    196,125, 16,71, 146,234, 189,95, 10,171, 75,208, 105,128, 218,70,
+    63,225, 87,169, 112,250, 52,110, 220,209, 128,166, 114,40, 186,186,
+    157,22, 107,153, 197,124, 28,192, 206,166, 91,62, 157,241, 193,223,
+    36,191, 125,98, 95,17, 226,81, 172,247, 84,166, 116,93, 13,215,
+    233,81, 74,168, 148,40, 60,61, 205,207, 114,87, 90,34, 227,150,
+    166,129, 195,56, 139,163, 30,138, 75,200, 103,100, 156,249, 3,214,
+    166,109, 99,46, 26,90, 48,4, 205,178, 89,165, 228,241, 56,111,
+    119,23, 237,58, 47,251, 219,131, 130,187, 25,19, 230,218, 120,110,
+    211,39, 68,14, 243,163, 95,46, 160,251, 137,191, 177,106, 23,12,
+    149,50, 230,82, 179,19, 17,156, 161,0, 196,62, 22,120, 86,101,
+    233,232, 42,89, 146,222, 12,48, 116,20, 237,149, 67,91, 135,127,
+    247,54, 215,205, 159,152, 44,230, 147,196, 238,24, 202,186, 65,112,
+    104,5, 196,235, 31,97, 171,155, 234,255, 3,173, 182,194, 151,236,
+    101,182, 45,204, 242,88, 172,6, 185,71, 62,155, 208,36, 51,171,
+    242,66, 67,161, 176,133, 248,254, 141,59, 37,31, 187,145, 20,220,
+    101,123, 145,71, 12,168, 195,36, 83,208, 186,145, 9,95, 163,156,
+    105,199, 179,133, 41,220, 117,114, 209,77, 49,34, 226,139, 124,160,
+    38,182, 194,199, 131,96, 73,127, 95,195, 248,242, 49,216, 176,10,
+    69,137, 123,35, 220,200, 188,79, 166,246, 47,113, 218,211, 17,25,
+    176,74, 56,177, 111,118, 73,35, 2,59, 127,71, 217,153, 41,250,
+    136,32, 251,131, 120,189, 84,111, 132,27, 41,0, 245,116, 77,65,
+    123,39, 207,21, 9,252, 110,221, 40,176, 254,18, 126,87, 143,194,
+    113,12, 214,236, 84,186, 7,216, 106,104, 65,83, 125,201, 244,50,
+    201,185, 78,230, 161,151, 39,84, 139,114, 238,52, 62,5, 150,229,
+    79,83, 3,60, 134,186, 233,150, 18,1, 65,227, 252,62, 81,246,
+    98,120, 13,41, 244,234, 210,141, 1,31, 147,87, 206,152, 134,73,
+    8,179, 253,164, 96,104, 75,3, 130,139, 32,186, 102,39, 80,160,
+    145,255, 9,2, 204,215, 252,142, 186,106, 100,221, 25,125, 174,52,
+    155,204, 10,65, 50,224, 214,77, 159,53, 69,142, 217,219, 27,97,
+    61,229, 230,109, 82,147, 147,120, 223,60, 25,239, 91,134, 15,226,
+    189,121, 34,75, 131,22, 233,40, 170,124, 219,232, 154,15, 0,159,
+    172,92, 223,0, 60,212, 248,25, 115,237, 94,195, 204,73, 45,167,
+    254,32, 220,244, 169,23, 86,89, 195,202, 108,170, 155,99, 204,210,
+    171,26, 59,218, 156,69, 43,175, 120,55, 62,107, 103,190, 229,47,
+    162,249, 34,60, 55,128, 173,208, 244,173, 153,66, 227,227, 184,107,
+    119,135, 232,48, 89,83, 31,169, 165,245, 52,7, 241,179, 77,88,
+    191,146, 227,172, 94,21, 180,160, 15,201, 108,245, 138,82, 189,156,
+    20,171, 159,73, 133,48, 198,185, 70,31, 163,210, 180,108, 229,149,
+    75,52, 160,99, 201,203, 17,154, 51,174, 196,68, 74,137, 91,244,
+    31,41, 128,107, 104,135, 19,63, 175,178, 30,125, 216,249, 126,139,
+    183,102, 27,177, 57,121, 148,235, 36,50, 185,132, 4,17, 30,78,
+    140,152, 237,111, 107,11, 188,255, 225,160, 167,225, 30,23, 78,206,
+    190,114, 141,224, 212,28, 20,234, 109,51, 10,85, 196,12, 59,197,
+    41,94, 168,238, 134,186, 63,19, 198,97, 115,45, 142,210, 90,231,
+    60,11, 113,103, 29,239, 239,122, 203,43, 52,180, 250,131, 171,13,
+    116,191, 238,243, 51,133, 98,98, 1,199, 212,79, 46,43, 103,3,
+    239,184, 57,242, 119,141, 148,88, 97,7, 255,195, 117,115, 43,177,
+    212,76, 185,197, 151,255, 229,162, 197,98, 73,17, 144,46, 15,214,
+    110,10, 93,206, 201,69, 242,145, 131,108, 74,193, 221,241, 116,56,
+    48,181, 215,134, 78,93, 24,204, 88,80, 180,5, 244,133, 14,146,
+    115,88, 89,13, 198,158, 231,97, 67,149, 138,248, 92,125, 210,167,
+    23,33, 240,150, 103,68, 213,202, 151,131, 18,155, 223,115, 7,78,
+    211,38, 166,136, 145,193, 124,89, 79,7, 152,213, 36,61, 91,32,
+    6,91, 186,214, 34,5, 174,167, 246,24, 115,156, 137,253, 152,172,
+    11,217, 207,34, 87,62, 37,212, 186,250, 23,54, 166,30, 140,224,
+    241,20, 68,121, 50,53, 5,221, 88,35, 167,155, 55,186, 245,111,
+    159,56, 71,161, 121,39, 13,220, 99,12, 165,33, 248,88, 91,164,
+    178,231, 127,37, 6,192, 201,47, 142,121, 40,233, 128,183, 217,42,
+    59,70, 152,176, 41,194, 121,38, 179,117, 47,20, 250,214, 158,58,
+    74,223, 189,9, 14,121, 80,233, 43,55, 246,29, 177,195, 130,166,
+    36,252, 253,57, 70,218, 0,71, 193,147, 100,101, 223,232, 209,117,
+    147,42, 77,151, 221,64, 127,236, 61,223, 82,124, 192,92, 32,68,
+    69,118, 175,163, 243,20, 217,130, 134,108, 62,157, 227,96, 8,208,
+    98,146, 199,167, 122,9, 252,86, 136,204, 103,75, 222,227, 35,89,
+    189,237, 233,132, 46,81, 226,254, 207,185, 53,156, 144,207, 16,116,
+    233,6, 64,221, 153,66, 255,149, 113,169, 70,32, 158,95, 203,251,
+    101,217, 248,126, 6,242, 164,79, 85,203, 222,181, 4,73, 124,137,
+    144,190, 110,110, 221,78, 162,162, 124,215, 95,242, 56,66, 203,23,
+    103,184, 187,119, 45,16, 229,174, 169,248, 18,25, 131,162, 66,198,
+    253,251, 106,18, 24,84, 202,111, 161,141, 16,55, 225,194, 251,16,
+    128,104, 108,234, 3,83, 162,179, 79,229, 106,41, 204,79, 176,242,
+    81,65, 25,189, 160,103, 40,239, 182,140, 12,123, 202,4, 83,148,
+    129,195, 0,22, 172,173, 152,100, 24,54, 68,126, 191,70, 40,248,
+    198,143, 102,101, 170,24, 53,243, 227,106, 10,210, 238,58, 50,164,
+    22,9, 184,103, 73,52, 236,140, 32,0, 200,238, 100,100, 173,43,
+    35,250, 53,174, 255,21, 1,39, 193,140, 234,86, 71,107, 21,148,
+    159,224, 83,98, 138,157, 111,49, 57,203, 237,110, 179,73, 46,137,
+    190,172, 157,122, 90,182, 239,207, 144,40, 41,9, 97,177, 167,244,
+    54,136, 197,200, 143,49, 48,2, 234,191, 16,142, 125,172, 54,10,
+    145,130, 234,44, 110,213, 208,28, 70,172, 235,51, 116,250, 149,34,
+    64,65, 212,117, 105,203, 86,2, 183,141, 110,227, 218,23, 133,45,
+    82,83, 28,175, 212,214, 18,130, 96,75, 190,18, 83,197, 139,116,
+    171,150, 124,29, 211,228, 146,170, 111,63, 135,161, 64,25, 232,153,
+    205,87, 182,200, 68,229, 137,101, 31,179, 171,1, 112,208, 146,129,
+    243,10, 10,82, 219,241, 198,31, 31,127, 154,183, 87,1, 121,55,
+    39,97, 216,238, 8,30, 53,71, 109,231, 185,153, 209,219, 75,77,
+    19,38, 220,148, 93,214, 31,121, 187,70, 152,27, 251,202, 38,116,
+    220,227, 189,82, 60,154, 91,113, 141,69, 24,199, 50,181, 178,102,
+    20,165, 239,219, 141,44, 33,244, 249,89, 124,170, 7,111, 160,188,
+    240,200, 148,57, 119,159, 182,1, 131,185, 162,141, 32,237, 109,84,
+    224,68, 62,206, 95,187, 14,90, 54,114, 188,211, 17,230, 82,127,
+    24,7, 96,50, 119,133, 156,63, 85,254, 206,190, 47,52, 226,237,
+    177,41, 64,194, 126,139, 94,62, 248,230, 73,87, 207,211, 13,225,
+    167,155, 133,47, 71,193, 175,165, 123,90, 234,128, 6,100, 154,26,
+    119,169, 179,61, 247,94, 70,159, 209,237, 115,103, 88,250, 166,59,
+    19,23, 129,180, 2,247, 247,7, 169,223, 214,93, 157,19, 253,128,
+    92,238, 194,76, 54,152, 77,183, 227,64, 169,214, 94,14, 50,239,
+    222,127, 71,30, 38,253, 247,89, 61,51, 220,225, 200,36, 4,177,
+    252,132, 36,244, 194,14, 241,42, 155,135, 210,33, 250,193, 166,108,
+    149,70, 242,210, 214,168, 43,118, 231,17, 15,154, 133,94, 92,167,
+    28,74, 211,176, 42,215, 166,101, 4,165, 142,39, 113,145, 231,14,
+    196,204, 100,132, 246,107, 220,6, 29,250, 65,58, 139,203, 87,116,
+    230,190, 40,254, 133,16, 104,222, 172,35, 9,134, 65,86, 214,162,
+    101,144, 76,97, 178,55, 35,135, 124,161, 100,42, 74,229, 39,144,
+    134,53, 114,12, 163,113, 11,30, 199,133, 63,40, 23,161, 188,97,
+    106,71, 1,151, 204,108, 89,219, 145,122, 45,162, 73,99, 152,7,
+    88,49, 134,157, 166,104, 77,221, 119,254, 39,79, 102,55, 125,180,
+    50,246, 7,148, 196,224, 107,34, 63,81, 247,233, 186,122, 119,26,
+    78,203, 154,112, 191,5, 106,24, 222,255, 184,192, 28,112, 62,80,
+    44,27, 18,65, 151,218, 85,146, 195,21, 48,181, 254,46, 188,230,
+    25,10, 60,132, 158,75, 21,181, 228,51, 50,198, 199,5, 137,217,
+    239,187, 154,37, 230,209, 53,192, 198,75, 8,118, 223,205, 186,84,
+    15,190, 230,211, 210,97, 44,228, 130,199, 150,79, 209,143, 253,222,
+    136,9, 178,206, 165,41, 113,194, 25,19, 236,67, 121,249, 181,209,
+    208,192, 51,122, 23,71, 226,175, 2,147, 175,4, 68,164, 217,96,
+    139,29, 78,12, 176,90, 23,198, 164,46, 142,217, 7,66, 200,143,
+    54,247, 252,55, 15,134, 70,154, 51,72, 128,123, 242,58, 82,244,
+    143,185, 180,93, 114,240, 2,120, 163,79, 128,213, 99,138, 171,85,
+    112,163, 214,102, 202,205, 85,115, 145,152, 245,171, 120,68, 27,233,
+    43,119, 193,15, 112,238, 146,103, 83,30, 242,252, 109,3, 59,170,
+    171,23, 81,247, 144,157, 103,123, 241,6, 87,252, 117,186, 42,51,
+    80,175, 57,236, 228,135, 16,80, 191,172, 102,144, 170,110, 12,24,
+    232,232, 115,92, 99,28, 185,59, 143,195, 89,117, 235,215, 29,234,
+    187,141, 230,189, 91,110, 126,161, 222,129, 72,178, 100,105, 168,13,
+    216,160, 111,222, 145,91, 237,233, 172,181, 91,15, 159,221, 213,170,
+    252,3, 203,159, 56,42, 236,198, 212,171, 34,32, 224,155, 12,64,
+    74,238, 238,42, 125,27, 0,246, 190,90, 72,20, 162,108, 183,43,
+    93,80, 63,174, 13,64, 212,128, 25,167, 162,149, 128,58, 205,108,
+    29,136, 250,68, 67,43, 6,172, 183,59, 28,93, 173,112, 12,21,
+    235,121, 153,63, 127,101, 208,12, 76,240, 249,185, 58,57, 31,76,
+    141,167, 67,137, 246,216, 213,240, 49,16, 200,87, 157,41, 11,125,
+    115,65, 59,48, 35,230, 154,72, 203,5, 49,209, 26,238, 232,38,
+    38,188, 130,76, 81,29, 22,48, 200,208, 37,99, 8,37, 103,137,
+    25,115, 124,233, 77,61, 95,12, 140,101, 69,246, 152,111, 196,1,
+    42,216, 143,192, 53,141, 176,58, 97,226, 39,212, 109,130, 8,253,
+    254,157, 220,140, 173,221, 135,12, 68,88, 181,213, 43,183, 151,235,
+    97,33, 120,86, 192,185, 157,237, 231,27, 72,154, 215,207, 99,242,
+    197,86, 30,165, 93,227, 49,200, 159,38, 132,124, 218,220, 85,152,
+    202,2, 164,40, 37,182, 128,107, 17,160, 63,207, 106,249, 254,20,
+    170,177, 206,204, 239,136, 0,250, 110,24, 251,149, 179,57, 88,96,
+    157,121, 4,171, 185,197, 219,110, 116,131, 230,162, 135,249, 67,84,
+    222,150, 40,212, 169,76, 190,133, 20,222, 117,49, 246,186, 90,128,
+    167,169, 105,72, 251,119, 29,177, 218,8, 235,146, 207,189, 142,30,
+    81,201, 122,94, 34,50, 104,241, 245,194, 90,44, 235,72, 1,127,
+    216,224, 51,202, 223,144, 38,102, 127,215, 56,74, 143,138, 161,34,
+    120,191, 67,3, 243,154, 186,54, 3,91, 38,27, 150,205, 184,98,
+    109,253, 7,197, 79,82, 152,127, 241,51, 180,144, 134,73, 75,105,
+    46,155, 95,84, 132,35, 192,99, 81,169, 147,191, 121,82, 57,138,
+    196,253, 243,0, 64,146, 97,241, 151,11, 54,69, 192,54, 175,203,
+    150,103, 11,17, 209,176, 241,194, 50,147, 182,88, 6,21, 58,229,
+    207,96, 15,15, 79,243, 156,85, 135,46, 59,101, 20,76, 170,60,
+    52,1, 151,179, 228,111, 202,27, 50,145, 19,116, 193,8, 76,95,
+    135,162, 175,16, 21,118, 91,1, 108,49, 189,229, 247,178, 45,126,
+    224,46, 10,217, 140,142, 215,117, 115,247, 231,168, 97,133, 19,47,
+    253,114, 228,66, 195,222, 116,31, 92,11, 221,170, 33,191, 211,223,
+    145,1, 16,240, 162,120, 66,61, 42,221, 209,113, 11,30, 222,201,
+    103,226, 139,65, 43,42, 170,85, 29,219, 77,174, 238,189, 109,30,
+    48,47, 132,243, 99,122, 155,34, 83,254, 216,71, 135,205, 232,56,
+    122,150, 186,37, 226,197, 114,159, 199,207, 88,232, 126,168, 241,243,
+    193,124, 72,226, 4,207, 160,70, 118,164, 144,248, 224,218, 163,176,
+    111,52, 64,255, 204,64, 242,191, 168,166, 4,108, 23,20, 85,65,
+    180,251, 105,77, 167,106, 82,182, 56,16, 172,74, 71,226, 125,10,
+    44,178, 61,158, 173,140, 24,245, 54,95, 163,233, 9,60, 188,130,
+    229,27, 117,164, 248,212, 184,180, 21,8, 235,243, 135,51, 72,163,
+    174,18, 16,106, 212,210, 255,155, 121,118, 207,20, 1,141, 88,226,
+    165,165, 229,90, 63,59, 26,157, 111,6, 38,117, 158,164, 96,181,
+    27,236, 145,109, 40,126, 68,64, 5,134, 184,18, 44,115, 102,39,
+    216,154, 29,83, 94,17, 249,132, 187,99, 60,37, 98,198, 35,22,
+    254,152, 10,79, 150,209, 138,134, 75,245, 218,84, 199,200, 133,158,
+    61,97, 255,205, 36,29, 201,234, 25,61, 244,193, 190,146, 211,85,
+    159,237, 138,21, 98,55, 206,201, 234,182, 126,116, 83,36, 104,89,
+    61,198, 29,50, 87,75, 218,141, 106,92, 167,155, 92,125, 32,73,
+    239,177, 113,132, 84,184, 158,56, 19,232, 137,96, 186,74, 246,128,
+    75,2, 196,183, 122,232, 248,106, 203,213, 172,42, 64,134, 255,28,
+    198,77, 52,211, 174,3, 246,247, 161,32, 228,184, 145,91, 11,217,
+    114,191, 180,53, 133,246, 40,173, 81,230, 9,59, 130,85, 201,139,
+    180,107, 86,234, 234,28, 46,94, 30,40, 118,14, 98,146, 155,236,
+    209,9, 17,170, 124,42, 148,127, 99,156, 133,213, 6,101, 87,36,
+    30,122, 223,209, 75,106, 1,4, 146,74, 43,152, 246,211, 199,254,
+    158,144, 179,109, 51,228, 125,39, 154,196, 202,15, 46,217, 190,235,
+    150,89, 52,32, 199,246, 69,9, 177,194, 101,36, 59,252, 33,199,
+    215,219, 17,28, 181,138, 139,77, 3,189, 221,239, 78,92, 13,220,
+    110,144, 87,51, 211,98, 22,172, 99,223, 75,147, 207,67, 252,7,
+    64,138, 155,105, 233,32, 209,149, 168,3, 219,187, 240,125, 23,226,
+    55,44, 122,184, 101,121, 185,161, 225,180, 57,219, 175,116, 41,53,
+    230,188, 73,137, 184,220, 236,90, 64,0, 224,50, 153,251, 52,188,
+    182,69, 120,225, 240,88, 189,166, 108,135, 174,46, 71,16, 134,169,
+    4,68, 240,187, 143,24, 76,129, 8,251, 63,60, 250,108, 122,43,
+    2,206, 216,143, 130,102, 36,79, 235,166, 220,148, 146,110, 115,64,
+    157,153, 94,117, 43,207, 58,51, 103,15, 147,170, 191,62, 131,20,
+    169,252, 224,161, 139,193, 118,83, 56,44, 131,108, 34,205, 165,165,
+    84,237, 50,77, 19,200, 106,119, 67,67, 147,210, 112,159, 74,13,
+    153,72, 214,201, 17,4, 161,57, 129,232, 247,70, 80,130, 142,82,
+    2,26, 114,110, 162,63, 47,245, 11,177, 110,113, 206,25, 250,132,
+    103,171, 14,149, 165,33, 65,193, 31,246, 216,228, 20,98, 224,122,
+    95,7, 39,235, 205,159, 234,101, 25,81, 221,171, 100,189, 77,151,
+    182,4, 229,67, 105,222, 12,126, 91,49, 46,212, 200,13, 6,85,
+    252,44, 171,175, 226,97, 82,245, 238,145, 24,103, 48,126, 242,185,
+    33,113, 70,12, 1,131, 195,236, 239,22, 178,123, 15,255, 192,48,
+    121,20, 203,180, 141,221, 184,90, 30,252, 46,47, 193,100, 173,242,
+    230,169, 39,143, 197,250, 69,105, 7,151, 204,33, 24,212, 239,253,
+    191,161, 94,229, 214,196, 84,77, 196,142, 168,206, 37,162, 79,60,
+    144,8, 201,241, 42,51, 132,112, 254,22, 87,62, 152,184, 55,220,
+    120,85, 166,57, 107,200, 187,13, 135,212, 174,137, 159,27, 28,119,
+    138,249, 60,196, 166,174, 193,19, 153,243, 242,181, 79,134, 131,230,
+    65,248, 21,71, 193,9, 113,197, 163,34, 185,231, 119,80, 207,202,
+    98,40, 160,72, 231,207, 43,59, 152,153, 107,188, 90,74, 223,96,
+    244,129, 3,159, 97,42, 237,13, 124,137, 250,175, 93,23, 0,115,
+    134,34, 84,91, 251,210, 113,77, 147,195, 89,13, 108,174, 167,45,
+    53,98, 132,6, 27,150, 248,36, 142,16, 123,96, 21,235, 176,83,
+    60,199, 233,99, 93,213, 156,130, 193,78, 114,159, 207,203, 183,138,
+    248,40, 65,177, 16,145, 84,245, 43,35, 114,70, 200,233, 240,93,
+    39,56, 86,158, 249,38, 22,114, 120,90, 173,60, 28,32, 107,190,
+    204,22, 149,166, 127,131, 34,59, 215,156, 67,215, 86,0, 8,166,
+    144,149, 58,224, 183,103, 82,177, 213,8, 26,225, 136,33, 61,198,
+    40,231, 172,62, 75,111, 217,152, 14,234, 161,81, 60,193, 210,217,
+    106,64, 28,130, 169,19, 58,47, 216,114, 179,136, 35,90, 221,202,
+    67,121, 151,181, 229,56, 41,213, 69,124, 96,224, 238,44, 219,180,
+    112,120, 26,15, 213,145, 5,231, 50,175, 77,4, 11,107, 137,31,
+    28,240, 229,114, 153,91, 213,122, 254,51, 55,182, 93,165, 9,220,
+    149,16, 112,82, 205,138, 72,228, 141,203, 57,162, 185,100, 231,123,
+    9,205, 50,110, 76,223, 249,91, 16,181, 153,116, 226,48, 176,242,
+    252,91, 108,26, 126,249, 12,136, 248,86, 71,163, 187,116, 148,142,
+    111,5, 156,214, 53,187, 197,30, 86,201, 138,124, 226,53, 185,146,
+    44,229, 236,173, 140,239, 190,187, 47,222, 243,167, 127,245, 11,20,
+    200,69, 118,240, 15,105, 172,160, 210,191, 189,68, 3,138, 130,31,
+    161,249, 74,72, 181,187, 125,41, 230,93, 168,253, 38,53, 104,153,
+    198,75, 91,206, 177,1, 2,218, 131,154, 72,103, 226,9, 171,131,
+    215,112, 186,186, 47,239, 4,71, 228,1, 215,146, 37,221, 96,78,
+    240,54, 178,151, 208,40, 140,254, 101,75, 55,18, 129,135, 41,66,
+    20,189, 218,122, 203,54, 94,38, 161,216, 48,65, 237,247, 208,51,
+    22,172, 228,79, 131,100, 178,249, 37,70, 113,0, 18,106, 77,160,
+    123,11, 156,41, 6,99, 95,155, 20,65, 73,2, 159,53, 101,147,
+    254,216, 181,134, 80,27, 109,82, 157,255, 54,4, 86,109, 46,168,
+    192,218, 249,154, 56,25, 141,62, 96,209, 240,125, 215,185, 148,224,
+    48,23, 74,165, 119,64, 34,191, 194,231, 146,79, 24,255, 124,197,
+    62,45, 238,213, 100,29, 161,105, 115,180, 85,48, 135,16, 164,240,
+    110,175, 122,5, 88,189, 0,27, 183,143, 240,211, 199,233, 165,106,
+    77,172, 51,13, 141,199, 32,148, 173,108, 116,182, 8,24, 99,92,
+    83,238, 255,19, 6,133, 68,167, 206,45, 150,227, 244,180, 171,244,
+    203,87, 64,206, 219,121, 118,28, 232,82, 136,228, 209,109, 85,185,
+    44,87, 59,41, 238,173, 32,229, 225,48, 138,148, 245,205, 149,55,
+    14,85, 104,102, 34,197, 205,115, 21,166, 178,11, 61,84, 123,136,
+    245,100, 221,249, 167,130, 99,43, 242,30, 208,140, 108,23, 14,66,
+    82,173, 133,145, 27,58, 178,127, 253,252, 16,198, 198,87, 70,136,
+    218,103, 40,65, 229,228, 162,119, 66,168, 112,97, 27,196, 91,33,
+    118,155, 242,220, 192,78, 66,237, 221,2, 131,207, 201,126, 181,153,
+    35,190, 121,114, 164,57, 103,149, 235,212, 25,93, 56,136, 98,22,
+    13,72, 249,184, 80,142, 177,254, 198,196, 31,131, 172,164, 1,24,
+    148,234, 193,197, 133,10, 7,118, 99,95, 180,182, 23,20, 200,236,
+    121,133, 224,7, 81,244, 154,141, 115,233, 8,35, 85,214, 162,60,
+    25,196, 13,14, 189,175, 63,87, 44,111, 160,205, 180,160, 231,98,
+    198,230, 38,84, 152,11, 76,169, 208,155, 49,34, 147,119, 24,216,
+    61,164, 154,243, 29,81, 194,203, 47,44, 220,58, 148,4, 234,85,
+    181,246, 3,61, 155,132, 105,94, 21,165, 232,47, 73,75, 52,228,
+    145,39, 219,204, 194,223, 45,9, 88,120, 220,35, 130,195, 191,59,
+    144,114, 33,216, 104,7, 50,58, 152,102, 61,38, 113,210, 230,73,
+    217,123, 121,154, 165,63, 206,211, 66,164, 116,74, 78,125, 215,189,
+    61,39, 164,222, 235,173, 187,50, 69,71, 253,106, 197,157, 135,241,
+    207,47, 111,117, 234,234, 137,150, 86,185, 26,53, 54,217, 95,3,
+    140,117, 246,245, 217,202, 59,94, 126,226, 99,73, 186,190, 245,24,
+    174,146, 128,93, 97,11, 255,132, 81,157, 133,250, 10,185, 207,144,
+    36,113, 127,42, 85,180, 253,27, 42,194, 150,245, 91,102, 167,15,
+    246,138, 63,67, 14,86, 138,183, 182,241, 160,77, 73,152, 42,248,
+    213,163, 165,46, 134,233, 237,170, 18,151, 92,14, 248,239, 70,95,
+    36,50, 20,250, 90,104, 250,140, 45,31, 233,242, 171,216, 37,61,
+    93,159, 0,78, 134,96, 47,17, 31,193, 221,129, 101,179, 52,28,
+    38,144, 72,76, 155,211, 5,7, 123,70, 251,248, 214,126, 69,39,
+    0,192, 164,152, 109,50, 14,19, 234,112, 167,60, 3,235, 84,46,
+    231,212, 10,180, 143,36, 210,109, 20,220, 173,74, 104,123, 54,213,
+    71,21, 226,203, 170,231, 59,119, 210,143, 185,59, 5,217, 125,177,
+    27,162, 110,254, 80,29, 242,104, 118,170, 2,18, 251,205, 111,100,
+    89,126, 226,31, 5,93, 183,78, 210,202, 128,116, 189,179, 144,143,
+    106,3, 181,184, 76,21, 153,223, 192,45, 11,89, 129,0, 145,105,
+    251,120, 177,28, 103,209, 206,148, 124,249, 167,88, 146,9, 182,226,
+    246,93, 95,163, 172,37, 222,104, 195,224, 145,138, 168,89, 117,179,
+    190,72, 46,28, 87,134, 195,214, 33,184, 142,143, 116,4, 204,125
+};
+
+const unsigned char* BlueNoise::data()
+{
+    return blueNoise;
+}
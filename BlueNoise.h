@@ -0,0 +1,18 @@
+#ifndef BLUENOISE_H
+#define BLUENOISE_H
+
+// Tileable blue noise for the occlusion passes: two independent
+// Size x Size maps, 8 bits each, interleaved as RG.  Neighbouring texels
+// differ as much as possible, so the error of a low tap count looks like
+// fine grain that a small blur (or none) hides, rather than blotches.
+class BlueNoise
+{
+    BlueNoise() {}
+public:
+    static const int Size = 64;
+
+    // Size * Size * 2 bytes, rows bottom up as osg::Image expects
+    static const unsigned char* data();
+};
+
+#endif // BLUENOISE_H
@@ -2,20 +2,21 @@
 #include "ui_MainWindow.h"
 #include "SSAONode.h"
 #include "Osg3dSSAOView.h"
+#include "SceneBuilder.h"
+#include "ModelLoader.h"
 
 #include <QSettings>
+#include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QProgressDialog>
 
-#include <osg/ShapeDrawable>
-#include <osg/Geode>
-#include <osgDB/ReadFile>
-#include <osgDB/WriteFile>
-
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(QWidget *parent, const QString& sceneFile)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_world(new osg::Group)
+    , m_ssaoWorld(new osg::Group)
+    , m_loader(new ModelLoader(this))
 
 {
     ui->setupUi(this);
@@ -27,10 +28,44 @@ MainWindow::MainWindow(QWidget *parent)
     setupSSAOWidget(ssaoView);
     setMouseModeOrbit();
 
-    m_world->addChild(buildScene());
+    // Models load in the background, the views keep drawing the old scene
+    m_loadProgress = new QProgressDialog("Loading models", "Cancel", 0, 100, this);
+    m_loadProgress->setWindowModality(Qt::NonModal);
+    m_loadProgress->setMinimumDuration(500);
+    m_loadProgress->reset();
+    connect(m_loadProgress, SIGNAL(canceled()), m_loader, SLOT(cancel()));
+    connect(m_loader, SIGNAL(progress(int)), m_loadProgress, SLOT(setValue(int)));
+    connect(m_loader, SIGNAL(finished()), this, SLOT(modelsLoaded()));
+    connect(m_loader, SIGNAL(cancelled()), m_loadProgress, SLOT(reset()));
+
+    // Each view pages PagedLOD models (see ssao_tiler) into its own
+    // instance of the scene
+    QSettings settings;
+    auto createPager = [&settings]() {
+        ScenePager* pager = new ScenePager;
+        pager->setMemoryBudget(settings.value("pagingBudgetMB", 1024).toUInt());
+        pager->setPrefetchScale(settings.value("pagingPrefetchScale", 1.5).toDouble());
+        return pager;
+    };
+    ui->osgWidget->setScenePager(createPager());
+    ssaoView->setScenePager(createPager());
+
+    ui->actionOptimizeOnLoad->setChecked(settings.value("optimizeOnLoad", true).toBool());
+    m_loader->setOptimizeEnabled(ui->actionOptimizeOnLoad->isChecked());
+    connect(ui->actionOptimizeOnLoad, SIGNAL(toggled(bool)),
+            this, SLOT(setOptimizeOnLoad(bool)));
+
+    // The window shows right away, the scene follows from the cache or a
+    // worker thread and is swapped in by modelsLoaded()
+    std::string sceneFileName = QFile::encodeName(sceneFile).toStdString();
+    m_loader->build("generated scene", [sceneFileName]() {
+        osg::ref_ptr<osg::Node> scene = SceneBuilder::loadOrBuildScene(5000, true);
+        if (!sceneFileName.empty())
+            SceneBuilder::writeScene(scene.get(), sceneFileName);
+        return scene;
+    });
     ui->osgWidget->setScene(m_world);
-    ui->uiEventWidget->ssaoView()->addNode(m_world);
-    ui->uiEventWidget->ssaoView()->cameraModel()->fitToScreen();
+    ui->uiEventWidget->ssaoView()->addNode(m_ssaoWorld);
 }
 
 MainWindow::~MainWindow()
@@ -49,6 +84,13 @@ void MainWindow::applicationSetup()
     qApp->setApplicationVersion(__DATE__ __TIME__);
 
 
+    ui->aoResolutionCombo->addItem("Full", SSAONode::AO_FullRes);
+    ui->aoResolutionCombo->addItem("Half", SSAONode::AO_HalfRes);
+    ui->aoResolutionCombo->addItem("Quarter", SSAONode::AO_QuarterRes);
+
+    ui->aoAlgorithmCombo->addItem("Hemisphere", SSAONode::AO_HemisphereKernel);
+    ui->aoAlgorithmCombo->addItem("Horizon", SSAONode::AO_HorizonBased);
+
     QActionGroup *group = new QActionGroup(this);
     group->addAction(ui->actionOrbit);
     group->addAction(ui->actionPan);
@@ -71,8 +113,24 @@ void MainWindow::connectHandlers(Osg3dSSAOView *ssaoView)
             this, SLOT(setPower()));
     connect(ui->displayModeCombo, SIGNAL(currentIndexChanged(int)),
             this, SLOT(handleDisplayModeCombo()));
+    connect(ui->aoResolutionCombo, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(handleAOResolutionCombo()));
+    connect(ui->aoAlgorithmCombo, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(handleAOAlgorithmCombo()));
     connect(ui->aoBlurr, SIGNAL(toggled(bool)),
             this, SLOT(ssaoBlur(bool)));
+    connect(ui->temporalAO, SIGNAL(toggled(bool)),
+            this, SLOT(ssaoTemporal(bool)));
+    connect(ui->deinterleavedAO, SIGNAL(toggled(bool)),
+            this, SLOT(ssaoDeinterleaved(bool)));
+    connect(ui->blueNoiseAO, SIGNAL(toggled(bool)),
+            this, SLOT(ssaoBlueNoise(bool)));
+    connect(ui->noiseOffsetAO, SIGNAL(toggled(bool)),
+            this, SLOT(ssaoNoiseOffset(bool)));
+    connect(ui->occlusionCulling, SIGNAL(toggled(bool)),
+            this, SLOT(ssaoOcclusionCulling(bool)));
+    connect(ui->osgWidget, SIGNAL(ssaoPassTimesChanged()),
+            this, SLOT(showPassTimes()));
     connect(ui->haloRemoval, SIGNAL(toggled(bool)),
             this, SLOT(ssaoHalo(bool)));
     connect(ui->ssaoCheckBox, SIGNAL(toggled(bool)),
@@ -84,7 +142,16 @@ void MainWindow::connectHandlers(Osg3dSSAOView *ssaoView)
 
     ui->haloRemoval->setChecked(ssaoView->ssaoHaloRemovalIsEnabled());
     ui->aoBlurr->setChecked(ssaoView->ssaoBlurIsEnabled());
+    ui->temporalAO->setChecked(ssaoView->ssaoTemporalIsEnabled());
+    ui->deinterleavedAO->setChecked(ssaoView->ssaoDeinterleavedIsEnabled());
+    ui->blueNoiseAO->setChecked(ssaoView->ssaoBlueNoiseIsEnabled());
+    ui->noiseOffsetAO->setChecked(ssaoView->ssaoNoiseOffsetIsEnabled());
+    ui->occlusionCulling->setChecked(ssaoView->ssaoOcclusionCullingIsEnabled());
     ui->displayModeCombo->setCurrentIndex(ssaoView->ssaoDisplayMode());
+    ui->aoResolutionCombo->setCurrentIndex(
+                ui->aoResolutionCombo->findData(ssaoView->ssaoResolution()));
+    ui->aoAlgorithmCombo->setCurrentIndex(
+                ui->aoAlgorithmCombo->findData(ssaoView->ssaoAlgorithm()));
 
 }
 
@@ -97,6 +164,13 @@ void MainWindow::setupOSGWidget(Osg3dSSAOView *ssaoView)
     ui->osgWidget->setSSAOHaloRemoval(ssaoView->ssaoHaloRemovalIsEnabled());
     ui->osgWidget->setSSAOBlurEnabled(ssaoView->ssaoBlurIsEnabled());
     ui->osgWidget->setSSAODisplayMode((SSAONode::DisplayMode)ssaoView->ssaoDisplayMode());
+    ui->osgWidget->setSSAOResolution(ssaoView->ssaoResolution());
+    ui->osgWidget->setSSAOAlgorithm(ssaoView->ssaoAlgorithm());
+    ui->osgWidget->setSSAOTemporalEnabled(ssaoView->ssaoTemporalIsEnabled());
+    ui->osgWidget->setSSAODeinterleavedEnabled(ssaoView->ssaoDeinterleavedIsEnabled());
+    ui->osgWidget->setSSAOBlueNoiseEnabled(ssaoView->ssaoBlueNoiseIsEnabled());
+    ui->osgWidget->setSSAONoiseOffsetEnabled(ssaoView->ssaoNoiseOffsetIsEnabled());
+    ui->osgWidget->setSSAOOcclusionCullingEnabled(ssaoView->ssaoOcclusionCullingIsEnabled());
     ui->osgWidget->setCameraModel(ssaoView->cameraModel());
 
     ui->osgWidget->setSSAOEnabled(true);
@@ -111,132 +185,67 @@ void MainWindow::setupSSAOWidget(Osg3dSSAOView *ssaoView)
     connect(ui->ssaoCheckBox, SIGNAL(toggled(bool)),
             ssaoView, SLOT(setSSAOEnabled(bool)));
 }
-osg::ref_ptr<osg::Geode> MainWindow::buildAxes()
-{
-    osg::ref_ptr<osg::Geometry> m_axisGeom = new osg::Geometry();
-    // allocate verticies
-    osg::ref_ptr<osg::Vec3Array> m_axisVerts = new osg::Vec3Array;
-    m_axisVerts->push_back(osg::Vec3(-1.0, 0.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(1.0, 0.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, -1.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, 1.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, -1.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 0.0));
-    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 1.0));
-
-    m_axisGeom->setVertexArray(m_axisVerts);
-    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 0, 2));
-    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 1, 2));
-    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 3, 2));
-    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 4, 2));
-    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 6, 2));
-    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 7, 2));
-
-    // allocate colors
-    osg::Vec4Array* colors = new osg::Vec4Array;
-    colors->push_back(osg::Vec4(.35f,0.0f,0.0f,1.0f));
-    colors->push_back(osg::Vec4(1.0f,0.0f,0.0f,1.0f));
-    colors->push_back(osg::Vec4(0.0f,.35f,0.0f,1.0f));
-    colors->push_back(osg::Vec4(0.0f,1.0f,0.0f,1.0f));
-    colors->push_back(osg::Vec4(0.0f,0.0f,.35f,1.0f));
-    colors->push_back(osg::Vec4(0.0f,0.0f,1.0f,1.0f));
-
-    m_axisGeom->setColorArray(colors);
-    m_axisGeom->setColorBinding(osg::Geometry::BIND_PER_PRIMITIVE_SET);
-    m_axisGeom->setDataVariance(osg::Object::DYNAMIC);
-
-    // generate the Geode
-    osg::ref_ptr<osg::Geode> m_axisGeode = new osg::Geode();
-    m_axisGeode->addDrawable(m_axisGeom);
-    //m_axisGeode->setNodeMask( MASK_AXIS );
-    m_axisGeode->setName("Axis");
-
-    //turn off lighting so we always see the line color
-    osg::StateSet *ss = m_axisGeode->getOrCreateStateSet();
-    ss->setMode( GL_LIGHTING, osg::StateAttribute::OFF );
-
-    // Set the linewidth a little wider so we can see the thing
-    osg::LineWidth *lineWidth = new osg::LineWidth;
-    lineWidth->setWidth( 2.0 );
-    ss->setAttributeAndModes(lineWidth);
-
-    return m_axisGeode;
-}
-
-
-// TODO: Remove
-double drand48()
-{
-    return ((double)rand()/(double)RAND_MAX);
-}
-double randColor()
-{
-    return drand48() * 0.875 + 0.125;
-}
-osg::ref_ptr<osg::Node> MainWindow::buildScene()
-{
-    osg::ref_ptr<osg::Group> node = new osg::Group;
-
-    osg::ref_ptr<osg::Geode> geode = buildAxes();
-    node->addChild(geode);
-#if 1
-    geode = new osg::Geode;
-#define RANDCOORD ((drand48() - 0.5) * 2.0)
-
-    float boxDimen = 30.0;
-    float sphMin = 0.125;
-    float sphMax = 4;
-
-    for (int i=0 ; i < 5000 ; i++ ) {
-        float x = boxDimen * RANDCOORD;
-        float y = boxDimen * RANDCOORD;
-        float z = boxDimen * RANDCOORD;
-        float radius =  sphMin + (drand48() * (sphMax-sphMin));
-
-        osg::ShapeDrawable *sd = new osg::ShapeDrawable(new osg::Box(osg::Vec3(x, y, z), radius));
-        sd->setColor(osg::Vec4(randColor(), randColor(), randColor(), 1.0));
-        geode->addDrawable(sd);
-    }
-
-    node->addChild(geode);
-    osgDB::writeNodeFile(*node, "testScene.osg");
-#endif
-
-    return node;
-}
-
 void MainWindow::on_actionOpen_triggered()
 {
 
     QSettings settings;
     // if there is a current workFlowController, we need
 
-    QString fileName = QFileDialog::getOpenFileName(this, "Select File",
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, "Select Files",
              settings.value("currentDirectory").toString(),
              "OSG File (*.osg *.ive *.osgt *.osgb *.obj *.ply)");
 
-    if (fileName.isEmpty() || fileName.isNull())
+    if (fileNames.isEmpty())
         return;
 
-    osg::ref_ptr<osg::Node> loaded = osgDB::readNodeFile(fileName.toStdString());
+    QFileInfo fi(fileNames.first());
+    settings.setValue("currentDirectory", fi.absolutePath());
 
-    if (!loaded.valid()) return;
+    // Replaces a load still running
+    m_loader->load(fileNames);
+}
 
-    const osg::BoundingSphere &bs = loaded->getBound();
-    if (bs.radius() <= 0.0) return;
+void MainWindow::modelsLoaded()
+{
+    // Queued from the loader threads, so this runs between two frames
+    std::vector<osg::ref_ptr<osg::Node> > loaded = m_loader->takeNodes();
+    SceneOptimizer::Statistics before, after;
+    if (!m_loader->failedFiles().isEmpty())
+        ui->statusBar->showMessage("Could not load " +
+                                   m_loader->failedFiles().join(", "), 10000);
+    else if (m_loader->optimizerStatistics(before, after))
+        ui->statusBar->showMessage(
+                    QString("Optimized: draw calls %1 -> %2, vertices %3 -> %4, "
+                            "state sets %5 -> %6 (%7 -> %8 applied)")
+                    .arg(before.drawCalls).arg(after.drawCalls)
+                    .arg(before.vertices).arg(after.vertices)
+                    .arg(before.stateSets).arg(after.stateSets)
+                    .arg(before.stateSetRefs).arg(after.stateSetRefs), 20000);
+    if (loaded.empty()) return;
 
     m_world->removeChildren(0, m_world->getNumChildren());
+    m_ssaoWorld->removeChildren(0, m_ssaoWorld->getNumChildren());
 
-    m_world->addChild(loaded);
+    for (osg::Node* node : loaded) {
+        m_world->addChild(node);
+        m_ssaoWorld->addChild(ScenePager::instance(node));
+    }
 
-    QFileInfo fi(fileName);
-    settings.setValue("currentDirectory", fi.absolutePath());
+    // The new scene may have the old one's bound, e.g. a file reopened
+    // after editing it
+    ui->osgWidget->dirtySSAOScene();
+    ui->uiEventWidget->ssaoView()->dirtySSAOScene();
 
     ui->uiEventWidget->ssaoView()->cameraModel()->fitToScreen();
 }
 
+void MainWindow::setOptimizeOnLoad(bool tf)
+{
+    QSettings settings;
+    settings.setValue("optimizeOnLoad", tf);
+    m_loader->setOptimizeEnabled(tf);
+}
+
 void MainWindow::setMouseModeOrbit()
 {
     ui->actionOrbit->setChecked(true);
@@ -276,6 +285,26 @@ void MainWindow::handleDisplayModeCombo()
     ui->uiEventWidget->ssaoView()->update();
 }
 
+void MainWindow::handleAOResolutionCombo()
+{
+    SSAONode::AOResolution resolution =
+            (SSAONode::AOResolution)
+            ui->aoResolutionCombo->currentData().toInt();
+
+    ui->osgWidget->setSSAOResolution(resolution);
+    ui->uiEventWidget->ssaoView()->setSSAOResolution(resolution);
+}
+
+void MainWindow::handleAOAlgorithmCombo()
+{
+    SSAONode::AOAlgorithm algorithm =
+            (SSAONode::AOAlgorithm)
+            ui->aoAlgorithmCombo->currentData().toInt();
+
+    ui->osgWidget->setSSAOAlgorithm(algorithm);
+    ui->uiEventWidget->ssaoView()->setSSAOAlgorithm(algorithm);
+}
+
 void MainWindow::ssaoHalo(bool tf)
 {
     ui->osgWidget->setSSAOHaloRemoval(tf);
@@ -292,6 +321,54 @@ void MainWindow::ssaoBlur(bool tf)
     ui->uiEventWidget->ssaoView()->update();
 }
 
+void MainWindow::ssaoTemporal(bool tf)
+{
+    ui->osgWidget->setSSAOTemporalEnabled(tf);
+    ui->uiEventWidget->ssaoView()->setSSAOTemporalEnabled(tf);
+}
+
+void MainWindow::ssaoDeinterleaved(bool tf)
+{
+    ui->osgWidget->setSSAODeinterleavedEnabled(tf);
+    ui->uiEventWidget->ssaoView()->setSSAODeinterleavedEnabled(tf);
+}
+
+void MainWindow::ssaoBlueNoise(bool tf)
+{
+    ui->osgWidget->setSSAOBlueNoiseEnabled(tf);
+    ui->uiEventWidget->ssaoView()->setSSAOBlueNoiseEnabled(tf);
+}
+
+void MainWindow::ssaoNoiseOffset(bool tf)
+{
+    ui->osgWidget->setSSAONoiseOffsetEnabled(tf);
+    ui->uiEventWidget->ssaoView()->setSSAONoiseOffsetEnabled(tf);
+}
+
+void MainWindow::ssaoOcclusionCulling(bool tf)
+{
+    ui->osgWidget->setSSAOOcclusionCullingEnabled(tf);
+    ui->uiEventWidget->ssaoView()->setSSAOOcclusionCullingEnabled(tf);
+}
+
+void MainWindow::showPassTimes()
+{
+    QString text("GPU ms  last / mean / max");
+    for (int i = 0; i < SSAONode::PassCount; i++) {
+        SSAONode::RenderPass pass = (SSAONode::RenderPass)i;
+        double lastMs, meanMs, maxMs;
+        if (!ui->osgWidget->ssaoPassTime(pass, lastMs, meanMs, maxMs))
+            continue;
+
+        text += QString("\n%1: %2 / %3 / %4")
+                .arg(SSAONode::PassName(pass))
+                .arg(lastMs, 0, 'f', 2)
+                .arg(meanMs, 0, 'f', 2)
+                .arg(maxMs, 0, 'f', 2);
+    }
+    ui->passTimesLabel->setText(text);
+}
+
 void MainWindow::setSSAOEnabled(bool tf)
 {
     ui->displayModeCombo->setEnabled(tf);
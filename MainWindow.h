@@ -4,6 +4,9 @@
 #include <QMainWindow>
 #include "UiEventWidget.h"
 #include <osg/Group>
+#include "ScenePager.h"
+class ModelLoader;
+class QProgressDialog;
 namespace Ui {
 class MainWindow;
 }
@@ -13,19 +16,31 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = 0);
+    // sceneFile, when given, receives a copy of the generated scene
+    explicit MainWindow(QWidget *parent = 0,
+                        const QString& sceneFile = QString());
     ~MainWindow();
 public slots:
     void on_actionOpen_triggered();
+    void modelsLoaded();
+    void setOptimizeOnLoad(bool tf);
     void setMouseModeOrbit();
     void setMouseModePan();
     void setMouseModeRotate();
     void setMouseModeZoom();
     void handleDisplayModeCombo();
+    void handleAOResolutionCombo();
+    void handleAOAlgorithmCombo();
 
     void ssaoHalo(bool tf);
     void ssaoBlur(bool tf);
+    void ssaoTemporal(bool tf);
+    void ssaoDeinterleaved(bool tf);
+    void ssaoBlueNoise(bool tf);
+    void ssaoNoiseOffset(bool tf);
+    void ssaoOcclusionCulling(bool tf);
     void setSSAOEnabled(bool tf);
+    void showPassTimes();
 
     void setRadius();
     void setThreshold();
@@ -34,15 +49,16 @@ public slots:
 
 private:
     void applicationSetup();
-    osg::ref_ptr<osg::Geode> buildAxes();
-    osg::ref_ptr<osg::Node> buildScene();
 
     void setupOSGWidget(Osg3dSSAOView *ssaoView);
     void setupSSAOWidget(Osg3dSSAOView *ssaoView);
     void connectHandlers(Osg3dSSAOView *ssaoView);
 
     Ui::MainWindow *ui;
-    osg::ref_ptr<osg::Group> m_world;
+    osg::ref_ptr<osg::Group> m_world;     // drawn by the OSGWidget
+    osg::ref_ptr<osg::Group> m_ssaoWorld; // its instance in the SSAO view
+    ModelLoader *m_loader;
+    QProgressDialog *m_loadProgress;
 
 
 };
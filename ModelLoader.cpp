@@ -0,0 +1,305 @@
+#include "ModelLoader.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/Registry>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <istream>
+#include <streambuf>
+
+namespace {
+
+// Reads a file in large chunks, counting the bytes and failing like an
+// end of file once the batch is cancelled, which ends every reader early
+class ProgressStreamBuf : public std::streambuf
+{
+public:
+    ProgressStreamBuf(std::atomic<qint64>& bytesRead,
+                      const std::atomic<bool>& cancelled)
+        : m_bytesRead(bytesRead)
+        , m_cancelled(cancelled)
+        , m_buffer(1 << 16)
+    {
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+    }
+
+    bool open(const std::string& fileName)
+    {
+        return m_file.open(fileName, std::ios::in | std::ios::binary) != nullptr;
+    }
+
+protected:
+    virtual int_type underflow()
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        if (m_cancelled)
+            return traits_type::eof();
+
+        std::streamsize n = m_file.sgetn(m_buffer.data(), m_buffer.size());
+        if (n <= 0)
+            return traits_type::eof();
+        m_bytesRead += n;
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // Some readers peek at a header and seek back
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which)
+    {
+        if (dir == std::ios_base::cur)
+            off -= egptr() - gptr();
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+        return m_file.pubseekoff(off, dir, which);
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which)
+    {
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+        return m_file.pubseekpos(pos, which);
+    }
+
+private:
+    std::atomic<qint64>& m_bytesRead;
+    const std::atomic<bool>& m_cancelled;
+    std::filebuf m_file;
+    std::vector<char> m_buffer;
+};
+
+} // namespace
+
+struct ModelLoader::Batch
+{
+    Batch() : totalBytes(0), bytesRead(0), cancelled(false), remaining(0),
+        optimize(false), optimized(false) {}
+
+    int id;
+    QStringList fileNames;
+    std::vector<Builder> builders; // one per file name, empty for files
+    qint64 totalBytes;
+    std::atomic<qint64> bytesRead;
+    std::atomic<bool> cancelled;
+    int remaining; // only touched on the loader's thread
+    bool optimize;
+    SceneOptimizer::Options optimizerOptions;
+
+    QMutex mutex;
+    std::vector<osg::ref_ptr<osg::Node> > nodes; // one per file name
+    bool optimized;
+    SceneOptimizer::Statistics statisticsBefore;
+    SceneOptimizer::Statistics statisticsAfter;
+};
+
+class ModelLoader::LoadTask : public QRunnable
+{
+public:
+    LoadTask(ModelLoader* loader, std::shared_ptr<Batch> batch, int index)
+        : m_loader(loader), m_batch(batch), m_index(index) {}
+
+    virtual void run()
+    {
+        osg::ref_ptr<osg::Node> node;
+        const Builder& builder = m_batch->builders[m_index];
+        if (!m_batch->cancelled)
+            node = builder ? builder() : readNode(m_batch->fileNames[m_index]);
+
+        // Generated scenes are built the way they should be drawn
+        bool optimize = node.valid() && !builder && m_batch->optimize &&
+                !m_batch->cancelled;
+        SceneOptimizer::Statistics before, after;
+        if (optimize) {
+            before = SceneOptimizer::collect(node.get());
+            SceneOptimizer::optimize(node.get(), m_batch->optimizerOptions);
+            after = SceneOptimizer::collect(node.get());
+        }
+
+        // The bound is computed here rather than by the first frame
+        if (node.valid() && (m_batch->cancelled || node->getBound().radius() <= 0.0))
+            node = nullptr;
+
+        {
+            QMutexLocker lock(&m_batch->mutex);
+            m_batch->nodes[m_index] = node;
+            if (optimize && node.valid()) {
+                m_batch->optimized = true;
+                m_batch->statisticsBefore += before;
+                m_batch->statisticsAfter += after;
+            }
+        }
+        // The loader outlives its tasks, see ~ModelLoader()
+        QMetaObject::invokeMethod(m_loader, "fileFinished", Qt::QueuedConnection,
+                                  Q_ARG(int, m_batch->id));
+    }
+
+private:
+    osg::ref_ptr<osg::Node> readNode(const QString& fileName)
+    {
+        std::string name = QFile::encodeName(fileName).toStdString();
+        osgDB::Registry* registry = osgDB::Registry::instance();
+        osgDB::ReaderWriter* rw = registry->getReaderWriterForExtension(
+                    osgDB::getLowerCaseFileExtension(name));
+        if (!rw)
+            return nullptr;
+
+        // Relative paths in the file (textures, proxies) resolve next to it
+        osg::ref_ptr<osgDB::Options> options = registry->getOptions() ?
+                    osg::clone(registry->getOptions(), osg::CopyOp::SHALLOW_COPY) :
+                    new osgDB::Options;
+        options->getDatabasePathList().push_front(osgDB::getFilePath(name));
+
+        ProgressStreamBuf buffer(m_batch->bytesRead, m_batch->cancelled);
+        if (buffer.open(name)) {
+            std::istream stream(&buffer);
+            osgDB::ReaderWriter::ReadResult result = rw->readNode(stream, options.get());
+            if (result.status() != osgDB::ReaderWriter::ReadResult::NOT_IMPLEMENTED)
+                return result.getNode();
+        }
+
+        // This format only reads by file name
+        osgDB::ReaderWriter::ReadResult result = rw->readNode(name, options.get());
+        m_batch->bytesRead += QFileInfo(fileName).size();
+        return result.getNode();
+    }
+
+    ModelLoader* m_loader;
+    std::shared_ptr<Batch> m_batch;
+    int m_index;
+};
+
+ModelLoader::ModelLoader(QObject *parent)
+    : QObject(parent)
+    , m_batchId(0)
+    , m_optimizeEnabled(true)
+    , m_optimized(false)
+{
+    // Past a few files reading is bound by the disk rather than the cores
+    m_pool.setMaxThreadCount(std::max(1, std::min(QThread::idealThreadCount(), 4)));
+
+    m_progressTimer.setInterval(100);
+    connect(&m_progressTimer, SIGNAL(timeout()), this, SLOT(reportProgress()));
+}
+
+ModelLoader::~ModelLoader()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void ModelLoader::load(const QStringList& fileNames)
+{
+    start(fileNames, std::vector<Builder>(fileNames.size()));
+}
+
+void ModelLoader::build(const QString& name, const Builder& builder)
+{
+    start(QStringList() << name, std::vector<Builder>(1, builder));
+}
+
+void ModelLoader::start(const QStringList& fileNames,
+                        const std::vector<Builder>& builders)
+{
+    // The tasks of a cancelled batch finish unnoticed, see fileFinished()
+    cancel();
+
+    m_batch = std::make_shared<Batch>();
+    m_batch->id = ++m_batchId;
+    m_batch->fileNames = fileNames;
+    m_batch->builders = builders;
+    m_batch->optimize = m_optimizeEnabled;
+    m_batch->optimizerOptions = m_optimizerOptions;
+    m_batch->nodes.resize(fileNames.size());
+    m_batch->remaining = fileNames.size();
+    for (int i = 0; i < fileNames.size(); i++) {
+        if (!builders[i])
+            m_batch->totalBytes += QFileInfo(fileNames[i]).size();
+    }
+
+    emit progress(0);
+    if (fileNames.isEmpty()) {
+        fileFinished(m_batch->id);
+        return;
+    }
+
+    for (int i = 0; i < fileNames.size(); i++)
+        m_pool.start(new LoadTask(this, m_batch, i));
+    m_progressTimer.start();
+}
+
+bool ModelLoader::isLoading() const
+{
+    return m_batch != nullptr;
+}
+
+std::vector<osg::ref_ptr<osg::Node> > ModelLoader::takeNodes()
+{
+    std::vector<osg::ref_ptr<osg::Node> > nodes;
+    nodes.swap(m_nodes);
+    return nodes;
+}
+
+bool ModelLoader::optimizerStatistics(SceneOptimizer::Statistics& before,
+                                         SceneOptimizer::Statistics& after) const
+{
+    before = m_statisticsBefore;
+    after = m_statisticsAfter;
+    return m_optimized;
+}
+
+void ModelLoader::cancel()
+{
+    if (m_batch)
+        m_batch->cancelled = true;
+}
+
+void ModelLoader::fileFinished(int batchId)
+{
+    if (!m_batch || batchId != m_batch->id)
+        return;
+    if (--m_batch->remaining > 0)
+        return;
+
+    m_progressTimer.stop();
+    std::shared_ptr<Batch> batch;
+    batch.swap(m_batch);
+    if (batch->cancelled) {
+        emit cancelled();
+        return;
+    }
+
+    m_nodes.clear();
+    m_failedFiles.clear();
+    {
+        QMutexLocker lock(&batch->mutex);
+        m_optimized = batch->optimized;
+        m_statisticsBefore = batch->statisticsBefore;
+        m_statisticsAfter = batch->statisticsAfter;
+        for (int i = 0; i < batch->fileNames.size(); i++) {
+            if (batch->nodes[i].valid())
+                m_nodes.push_back(batch->nodes[i]);
+            else
+                m_failedFiles << batch->fileNames[i];
+        }
+    }
+    emit progress(100);
+    emit finished();
+}
+
+void ModelLoader::reportProgress()
+{
+    if (!m_batch || m_batch->totalBytes <= 0)
+        return;
+
+    // Readers that seek back count some bytes twice
+    qint64 percent = m_batch->bytesRead * 100 / m_batch->totalBytes;
+    emit progress(int(std::min<qint64>(percent, 99)));
+}
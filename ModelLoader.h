@@ -0,0 +1,83 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <osg/Node>
+#include "SceneOptimizer.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Reads model files on a pool of worker threads, one task per file, so
+// the views keep rendering the current scene meanwhile.  Formats whose
+// ReaderWriter reads from a stream (osgb, ive, osgt, osg, obj) report
+// progress by bytes and stop as soon as the batch is cancelled.  The
+// others (e.g. ply) read by file name, they count once done and a cancel
+// only drops their result.  Generated scenes run on the same pool, see
+// build().  Loaded files go through SceneOptimizer on the same worker
+// unless that is turned off.  Signals arrive on the loader's thread.
+class ModelLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModelLoader(QObject *parent = 0);
+    // Cancels the running batch and waits for its tasks
+    ~ModelLoader();
+
+    // Starts a batch, cancelling the one still running
+    void load(const QStringList& fileNames);
+    // A batch of one node made by builder on a worker thread, name stands
+    // for it in failedFiles().  Cancelling only drops the node.
+    typedef std::function<osg::ref_ptr<osg::Node>()> Builder;
+    void build(const QString& name, const Builder& builder);
+    bool isLoading() const;
+
+    // What the last finished batch loaded, in the order of its file names.
+    // Files that failed or have an empty bound are left out.
+    std::vector<osg::ref_ptr<osg::Node> > takeNodes();
+    QStringList failedFiles() const { return m_failedFiles; }
+
+    // Applies to batches started afterwards
+    void setOptimizeEnabled(bool tf) { m_optimizeEnabled = tf; }
+    bool isOptimizeEnabled() const { return m_optimizeEnabled; }
+    void setOptimizerOptions(const SceneOptimizer::Options& options) { m_optimizerOptions = options; }
+    // Summed over the files of the last finished batch.  False when none
+    // of them was optimized.
+    bool optimizerStatistics(SceneOptimizer::Statistics& before,
+                                SceneOptimizer::Statistics& after) const;
+
+public slots:
+    void cancel();
+
+signals:
+    void progress(int percent);
+    void finished();
+    void cancelled();
+
+private slots:
+    void fileFinished(int batchId);
+    void reportProgress();
+
+private:
+    struct Batch;
+    class LoadTask;
+    void start(const QStringList& names, const std::vector<Builder>& builders);
+
+    QThreadPool m_pool;
+    QTimer m_progressTimer;
+    std::shared_ptr<Batch> m_batch;
+    int m_batchId;
+    std::vector<osg::ref_ptr<osg::Node> > m_nodes;
+    QStringList m_failedFiles;
+
+    bool m_optimizeEnabled;
+    SceneOptimizer::Options m_optimizerOptions;
+    bool m_optimized;
+    SceneOptimizer::Statistics m_statisticsBefore;
+    SceneOptimizer::Statistics m_statisticsAfter;
+};
+
+#endif // MODELLOADER_H
@@ -13,7 +13,9 @@
 
 OSGWidget::OSGWidget(QWidget *parent)
     : QGLWidget(parent)
-    , m_ssao(new SSAONode(width(), height()))
+    , m_ssao(new SSAONode(0, 0)) // render targets allocated by resizeGL()
+    , m_pagerRevision(0)
+    , m_passTimeSamples(0)
     , m_root(new osg::Switch)
     , m_scene(new osg::Group)
     , m_cameraModel(new CameraModel)
@@ -42,6 +44,7 @@ OSGWidget::OSGWidget(QWidget *parent)
     // Set the minimum size for this viewer window
     setMinimumSize(64, 64);
 
+    m_passTimeReported.start();
 
     SSAONode::buildGraph(m_root, m_scene, m_ssao);
 
@@ -81,7 +84,11 @@ void OSGWidget::paintGL()
 
 #else
 
-    cam->setCullMask( m_cameraModel->cullMask() );
+    // Nodes the cull mask hides or shows change the G-buffer
+    if (cam->getCullMask() != m_cameraModel->cullMask()) {
+        cam->setCullMask( m_cameraModel->cullMask() );
+        m_ssao->DirtyScene();
+    }
 
     //m_cameraModel->setAspect((double)width() / (double)height());
 
@@ -91,10 +98,33 @@ void OSGWidget::paintGL()
     // Let SSAO class know that camera has changed
 
     m_ssao->updateProjectionMatrix(getCamera()->getProjectionMatrix());
+    m_ssao->updateViewMatrix(getCamera()->getViewMatrix());
 
     // Invoke the OSG traversal pipeline
     frame();
 
+    // Tiles this frame merged change the scene inside the same bound, the
+    // next frame draws them
+    if (m_pager.valid() && m_pager->mergeRevision() != m_pagerRevision) {
+        m_pagerRevision = m_pager->mergeRevision();
+        m_ssao->DirtyScene();
+        update();
+    }
+
+    // Temporal AO, a render target format switch or tiles still paging
+    // in need a few more frames to settle
+    if (m_pager.valid())
+        m_pager->prefetch(this, m_scene.get());
+    if (m_ssao->NeedsRedraw() || (m_pager.valid() && m_pager->isLoading()))
+        update();
+
+    if (m_ssao->GetPassTimeSamples() != m_passTimeSamples &&
+            m_passTimeReported.elapsed() > 500) {
+        m_passTimeSamples = m_ssao->GetPassTimeSamples();
+        m_passTimeReported.restart();
+        emit ssaoPassTimesChanged();
+    }
+
     // Start the timer again
     //m_redrawTimer.start();
 }
@@ -106,6 +136,14 @@ void OSGWidget::paintGL()
 
 
 
+void OSGWidget::setScenePager(ScenePager* pager)
+{
+    m_pager = pager;
+    m_pagerRevision = m_pager->mergeRevision();
+    m_pager->attach(this);
+    update();
+}
+
 void OSGWidget::setScene(osg::Node *scene)
 {
     m_scene->removeChildren(0, m_scene->getNumChildren());
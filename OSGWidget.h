@@ -8,6 +8,7 @@
 #include <osg/Switch>
 #include "CameraModel.h"
 #include "SSAONode.h"
+#include "ScenePager.h"
 
 class OSGWidget : public QGLWidget,
     public osgViewer::Viewer
@@ -29,6 +30,19 @@ public:
     float ssaoPower() const { return m_ssao->GetSSAOPower(); }
     float ssaoHaloThreshold() const { return m_ssao->GetHaloTreshold(); }
     unsigned ssaoDisplayMode() const { return m_ssao->GetDisplayMode(); }
+    SSAONode::AOResolution ssaoResolution() const { return m_ssao->GetAOResolution(); }
+    SSAONode::AOAlgorithm ssaoAlgorithm() const { return m_ssao->GetAOAlgorithm(); }
+    bool ssaoTemporalIsEnabled() const { return m_ssao->IsTemporalEnabled(); }
+    bool ssaoDeinterleavedIsEnabled() const { return m_ssao->IsDeinterleavedEnabled(); }
+    bool ssaoBlueNoiseIsEnabled() const { return m_ssao->IsBlueNoiseEnabled(); }
+    bool ssaoNoiseOffsetIsEnabled() const { return m_ssao->IsNoiseOffsetEnabled(); }
+    bool ssaoOcclusionCullingIsEnabled() const { return m_ssao->IsOcclusionCullingEnabled(); }
+    bool ssaoPassTime(SSAONode::RenderPass pass, double& lastMs, double& meanMs, double& maxMs) const
+        { return m_ssao->GetPassTime(pass, lastMs, meanMs, maxMs); }
+
+signals:
+    /// New GPU pass times were read back, at most twice a second
+    void ssaoPassTimesChanged();
 
 
 public slots:
@@ -39,15 +53,30 @@ public slots:
     void setSSAOPower(float f) { m_ssao->SetSSAOPower(f);}
     void setSSAOHaloThreshold(float f) { m_ssao->SetHaloTreshold(f);}
     void setSSAODisplayMode(SSAONode::DisplayMode mode);
+    void setSSAOResolution(SSAONode::AOResolution r) { m_ssao->SetAOResolution(r); update();}
+    void setSSAOAlgorithm(SSAONode::AOAlgorithm a) { m_ssao->SetAOAlgorithm(a); update();}
+    void setSSAOTemporalEnabled(bool tf) { m_ssao->SetTemporalEnabled(tf); update();}
+    void setSSAODeinterleavedEnabled(bool tf) { m_ssao->SetDeinterleavedEnabled(tf); update();}
+    void setSSAOBlueNoiseEnabled(bool tf) { m_ssao->SetBlueNoiseEnabled(tf); update();}
+    void setSSAONoiseOffsetEnabled(bool tf) { m_ssao->SetNoiseOffsetEnabled(tf); update();}
+    void setSSAOOcclusionCullingEnabled(bool tf) { m_ssao->SetOcclusionCullingEnabled(tf); update();}
+    /// The scene graph was edited, the G-buffer has to be drawn again
+    void dirtySSAOScene() { m_ssao->DirtyScene(); update();}
     /// Render one frame
     virtual void paintGL() override;
 
     void setCameraModel(osg::ref_ptr<CameraModel> cameraModel);
+    /// Page PagedLODs with a pager of this view's own
+    void setScenePager(ScenePager* pager);
 
 private:
     //  SSAO support //////////////////////////////////////
 
     SSAONode* m_ssao;
+    osg::ref_ptr<ScenePager> m_pager;
+    unsigned int m_pagerRevision; // merges the G-buffer was dirtied for
+    unsigned int m_passTimeSamples;
+    QTime m_passTimeReported;
     // Helper functions ///////////////////////////////////////////////////////
 
     /// OSG uses singleSided drawing/display by default.
@@ -0,0 +1,604 @@
+#include "OcclusionCuller.h"
+#include <osg/ColorMask>
+#include <osg/Depth>
+#include <osg/FrameStamp>
+#include <osg/GLExtensions>
+#include <osg/Geode>
+#include <osg/LOD>
+#include <osg/NodeVisitor>
+#include <osg/OcclusionQueryNode>
+#include <osg/State>
+#include <osgUtil/CullVisitor>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+#include <cfloat>
+
+#ifndef GL_SAMPLES_PASSED
+#define GL_SAMPLES_PASSED 0x8914
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+
+typedef OpenThreads::ScopedLock<OpenThreads::Mutex> Lock;
+
+// Bounding box of a node drawn inside an occlusion query.  The result is
+// read back by OcclusionCuller::collect() a frame later.
+class OcclusionCuller::QueryBox : public osg::Drawable
+{
+public:
+    QueryBox(OcclusionCuller* culler = nullptr)
+        : m_culler(culler), name(0), queuedFrame(0), queued(false),
+          issued(false), answered(false), visible(false)
+    {
+        setUseDisplayList(false);
+    }
+    QueryBox(const QueryBox& other, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY)
+        : osg::Drawable(other, copyop), m_culler(other.m_culler), name(0),
+          queuedFrame(0), queued(false), issued(false), answered(false), visible(false)
+    {}
+    META_Object(ssao, QueryBox)
+
+    virtual void drawImplementation(osg::RenderInfo& renderInfo) const
+    {
+        if (!m_culler || !m_culler->initialize(renderInfo))
+            return;
+
+        osg::GLExtensions* ext = m_culler->m_extensions;
+        {
+            Lock lock(m_culler->m_mutex);
+            if (!queued || issued)
+                return;
+            if (!name)
+                ext->glGenQueries(1, &name);
+        }
+
+        ext->glBeginQuery(GL_SAMPLES_PASSED, name);
+        m_culler->m_box->draw(renderInfo);
+        ext->glEndQuery(GL_SAMPLES_PASSED);
+
+        Lock lock(m_culler->m_mutex);
+        issued = true;
+    }
+
+    OcclusionCuller* m_culler; // owns the boxes
+
+    // Guarded by the culler's mutex
+    mutable GLuint name;
+    unsigned int queuedFrame;
+    bool queued;           // added to a frame, not answered yet
+    mutable bool issued;   // drawn, result not read back
+    bool answered;         // result not seen by a cull yet
+    bool visible;
+};
+
+struct OcclusionCuller::CameraCallback : public osg::NodeCallback
+{
+    CameraCallback(OcclusionCuller* culler) : culler(culler) {}
+
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        if (!cv) {
+            traverse(node, nv);
+            return;
+        }
+
+        // The nodes below find the culler in the visitor
+        culler->beginFrame(cv);
+        osg::ref_ptr<osg::Referenced> userData = cv->getUserData();
+        cv->setUserData(culler);
+        traverse(node, nv);
+        cv->setUserData(userData.get());
+    }
+
+    OcclusionCuller* culler; // owns the camera this is attached to
+};
+
+struct OcclusionCuller::CollectCallback : public osg::Camera::DrawCallback
+{
+    CollectCallback(OcclusionCuller* culler) : culler(culler) {}
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        culler->collect(renderInfo);
+    }
+
+    OcclusionCuller* culler;
+};
+
+struct OcclusionCuller::ReadbackCallback : public osg::Camera::DrawCallback
+{
+    ReadbackCallback(OcclusionCuller* culler) : culler(culler) {}
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        culler->readback(renderInfo);
+    }
+
+    OcclusionCuller* culler;
+};
+
+// One instance on every tested node, shared by all cullers
+struct OcclusionCuller::NodeCallback : public osg::NodeCallback
+{
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        OcclusionCuller* culler = cv ?
+                    dynamic_cast<OcclusionCuller*>(cv->getUserData()) : nullptr;
+        if (culler && !culler->cull(*node, cv))
+            return;
+        traverse(node, nv);
+    }
+};
+
+namespace {
+
+bool hasCallback(osg::Node& node, osg::Callback* callback)
+{
+    for (osg::Callback* c = node.getCullCallback(); c; c = c->getNestedCallback()) {
+        if (c == callback)
+            return true;
+    }
+    return false;
+}
+
+// Leaves and the Groups where the graph branches.  Testing every Group of
+// a chain would repeat the same test.
+class AttachVisitor : public osg::NodeVisitor
+{
+public:
+    AttachVisitor(osg::NodeCallback* callback)
+        : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN), m_callback(callback) {}
+
+    virtual void apply(osg::Geode& geode)
+    {
+        add(geode);
+    }
+
+    virtual void apply(osg::LOD& lod)
+    {
+        add(lod);
+        traverse(lod);
+    }
+
+    virtual void apply(osg::Group& group)
+    {
+        if (group.getNumChildren() > 1)
+            add(group);
+        traverse(group);
+    }
+
+    // HUDs and render to texture cameras of the scene are left alone
+    virtual void apply(osg::Camera& camera)
+    {
+        traverse(camera);
+    }
+
+private:
+    void add(osg::Node& node)
+    {
+        if (!hasCallback(node, m_callback))
+            node.addCullCallback(m_callback);
+    }
+
+    osg::NodeCallback* m_callback;
+};
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller()
+    : m_queryState(new osg::StateSet)
+    , m_box(new osg::Geometry)
+    , m_hiZWidth(0)
+    , m_hiZHeight(0)
+    , m_frame(0)
+    , m_epoch(0)
+    , m_revealed(false)
+    , m_tested(0)
+    , m_occluded(0)
+    , m_initialized(false)
+    , m_supported(true)
+    , m_contextID(0)
+    , m_extensions(nullptr)
+{
+    // Tested against the depth of everything drawn before, written nowhere
+    m_queryState->setAttributeAndModes(new osg::ColorMask(false, false, false, false));
+    m_queryState->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.0, 1.0, false));
+    m_queryState->setMode(GL_CULL_FACE, osg::StateAttribute::OFF);
+    m_queryState->setRenderBinDetails(QueryBin, "RenderBin");
+
+    osg::ref_ptr<osg::Vec3Array> corners = new osg::Vec3Array;
+    for (int i = 0; i < 8; i++)
+        corners->push_back(osg::Vec3((i & 1) ? 1.0f : -1.0f,
+                                     (i & 2) ? 1.0f : -1.0f,
+                                     (i & 4) ? 1.0f : -1.0f));
+    static const GLubyte faces[] = {
+        0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,  0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5
+    };
+    m_box->setVertexArray(corners.get());
+    m_box->addPrimitiveSet(new osg::DrawElementsUByte(GL_TRIANGLES, 36, faces));
+    m_box->setUseDisplayList(false);
+    m_box->setUseVertexBufferObjects(true);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    releaseGLObjects();
+}
+
+void OcclusionCuller::attach(osg::Node* node)
+{
+    static osg::ref_ptr<osg::NodeCallback> callback = new NodeCallback;
+    if (!node)
+        return;
+    AttachVisitor visitor(callback.get());
+    node->accept(visitor);
+}
+
+osg::Callback* OcclusionCuller::cameraCullCallback()
+{
+    return new CameraCallback(this);
+}
+
+osg::Camera::DrawCallback* OcclusionCuller::collectCallback()
+{
+    return new CollectCallback(this);
+}
+
+osg::Camera::DrawCallback* OcclusionCuller::readbackCallback()
+{
+    return new ReadbackCallback(this);
+}
+
+void OcclusionCuller::setHiZTexture(osg::Texture2D* texture)
+{
+    Lock lock(m_mutex);
+    m_hiZTexture = texture;
+}
+
+void OcclusionCuller::viewChanged()
+{
+    Lock lock(m_mutex);
+    m_epoch++;
+}
+
+void OcclusionCuller::reset()
+{
+    Lock lock(m_mutex);
+    m_hiZ.clear();
+    for (Readback& r : m_readbacks)
+        r.pending = false;
+    m_revealed = false;
+}
+
+bool OcclusionCuller::isSettling() const
+{
+    Lock lock(m_mutex);
+    return m_revealed || !m_pendingQueries.empty();
+}
+
+void OcclusionCuller::statistics(unsigned int& tested, unsigned int& occluded) const
+{
+    Lock lock(m_mutex);
+    tested = m_tested;
+    occluded = m_occluded;
+}
+
+void OcclusionCuller::releaseGLObjects(osg::State* state)
+{
+    Lock lock(m_mutex);
+    if (!m_initialized || (state && state->getContextID() != m_contextID))
+        return;
+
+    // Deleted by OSG once the context is current, the next time it
+    // flushes deleted objects or when it is closed
+    for (auto& node : m_nodes) {
+        QueryBox* query = node.second.query.get();
+        if (!query)
+            continue;
+        if (query->name)
+            osg::QueryGeometry::deleteQueryObject(m_contextID, query->name);
+        query->name = 0;
+        query->queued = false;
+        query->issued = false;
+    }
+    m_pendingQueries.clear();
+
+    for (Readback& r : m_readbacks) {
+        if (r.buffer.valid())
+            r.buffer->releaseGLObjects(state);
+        r.buffer = nullptr;
+        r.size = 0;
+        r.pending = false;
+    }
+    m_hiZ.clear();
+    m_initialized = false;
+}
+
+bool OcclusionCuller::initialize(osg::RenderInfo& renderInfo)
+{
+    if (m_initialized)
+        return m_supported && renderInfo.getContextID() == m_contextID;
+
+    // Queries and buffers belong to one context, the first one to draw
+    m_initialized = true;
+    m_contextID = renderInfo.getContextID();
+    m_extensions = osg::GLExtensions::Get(m_contextID, true);
+    m_supported = m_extensions && m_extensions->isARBOcclusionQuerySupported &&
+            m_extensions->isPBOSupported;
+    return m_supported;
+}
+
+void OcclusionCuller::beginFrame(osgUtil::CullVisitor* cv)
+{
+    Lock lock(m_mutex);
+    m_frame++;
+    m_tested = 0;
+    m_occluded = 0;
+    m_revealed = false;
+
+    // The view and projection the HiZ of this frame will be rendered with
+    if (cv->getFrameStamp() && cv->getViewport()) {
+        unsigned int frameNumber = cv->getFrameStamp()->getFrameNumber();
+        FrameCamera& camera = m_frameCameras[frameNumber % 4];
+        camera.frame = frameNumber;
+        camera.view = *cv->getModelViewMatrix();
+        camera.projection = *cv->getProjectionMatrix();
+        camera.width = int(cv->getViewport()->width());
+        camera.height = int(cv->getViewport()->height());
+
+        if (!m_hiZ.empty())
+            m_viewToHiZView = osg::Matrixd::inverse(camera.view) * m_hiZCamera.view;
+    }
+
+    // Forget nodes gone from the scene, or culled for long
+    if (m_frame % 64 != 0)
+        return;
+    for (auto it = m_nodes.begin(); it != m_nodes.end();) {
+        NodeState& state = it->second;
+        bool stale = m_frame - state.lastSeen > 256;
+        if (!stale || (state.query.valid() && state.query->queued)) {
+            ++it;
+            continue;
+        }
+        if (state.query.valid() && state.query->name)
+            osg::QueryGeometry::deleteQueryObject(m_contextID, state.query->name);
+        it = m_nodes.erase(it);
+    }
+}
+
+bool OcclusionCuller::cull(osg::Node& node, osgUtil::CullVisitor* cv)
+{
+    // Geodes know a box tighter than their sphere
+    osg::BoundingBox box;
+    osg::Geode* geode = dynamic_cast<osg::Geode*>(&node);
+    if (geode)
+        box = geode->getBoundingBox();
+    if (!box.valid()) {
+        const osg::BoundingSphere& bound = node.getBound();
+        if (!bound.valid())
+            return true;
+        osg::Vec3 radius(bound.radius(), bound.radius(), bound.radius());
+        box.set(bound.center() - radius, bound.center() + radius);
+    }
+
+    Lock lock(m_mutex);
+    m_tested++;
+
+    // Keyed by node, a node under several transforms shares one state
+    NodeState& state = m_nodes[&node];
+    state.lastSeen = m_frame;
+    if (state.query.valid() && state.query->answered) {
+        state.query->answered = false;
+        if (state.query->visible)
+            state.visibleUntil = m_frame + VisibleFrames;
+    }
+    if (m_frame < state.visibleUntil)
+        return true;
+
+    const osg::Matrixd& modelView = *cv->getModelViewMatrix();
+    if (!hiZOccluded(box, modelView))
+        return true;
+
+    m_occluded++;
+    if (state.queriedEpoch != m_epoch &&
+            !(state.query.valid() && state.query->queued)) {
+        addQuery(state, box, cv);
+        state.queriedEpoch = m_epoch;
+    }
+    return false;
+}
+
+bool OcclusionCuller::hiZOccluded(const osg::BoundingBox& box,
+                                  const osg::Matrixd& modelView) const
+{
+    if (m_hiZ.empty() || m_hiZCamera.width <= 0 || m_hiZCamera.height <= 0)
+        return false;
+
+    // Into the view and clip space of the frame the HiZ was rendered in
+    osg::Matrixd toHiZView = modelView * m_viewToHiZView;
+    double nearest = DBL_MAX;
+    double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+    for (unsigned int i = 0; i < 8; i++) {
+        osg::Vec3d corner = osg::Vec3d(box.corner(i)) * toHiZView;
+        double distance = -corner.z();
+        osg::Vec4d clip = osg::Vec4d(corner, 1.0) * m_hiZCamera.projection;
+        // Reaching behind that camera, the box may cover anything
+        if (distance <= 0.0 || clip.w() <= 0.0)
+            return false;
+
+        nearest = std::min(nearest, distance);
+        double x = clip.x() / clip.w();
+        double y = clip.y() / clip.w();
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+
+    // Nothing is known about what was outside that frame
+    if (minX < -1.0 || maxX > 1.0 || minY < -1.0 || maxY > 1.0)
+        return false;
+
+    int columns = (m_hiZCamera.width + HiZTile - 1) / HiZTile;
+    int rows = (m_hiZCamera.height + HiZTile - 1) / HiZTile;
+    columns = std::min(columns, m_hiZWidth);
+    rows = std::min(rows, m_hiZHeight);
+    auto texel = [](double ndc, int pixels, int texels) {
+        int t = int((ndc * 0.5 + 0.5) * pixels) / HiZTile;
+        return std::min(std::max(t, 0), texels - 1);
+    };
+    int x0 = texel(minX, m_hiZCamera.width, columns);
+    int x1 = texel(maxX, m_hiZCamera.width, columns);
+    int y0 = texel(minY, m_hiZCamera.height, rows);
+    int y1 = texel(maxY, m_hiZCamera.height, rows);
+
+    // Hidden only if every texel it covers has a surface in front of it
+    for (int y = y0; y <= y1; y++) {
+        const float* row = &m_hiZ[size_t(y) * m_hiZWidth];
+        for (int x = x0; x <= x1; x++) {
+            if (row[x] >= nearest)
+                return false;
+        }
+    }
+    return true;
+}
+
+void OcclusionCuller::addQuery(NodeState& state, const osg::BoundingBox& box,
+                               osgUtil::CullVisitor* cv)
+{
+    if (!state.query.valid())
+        state.query = new QueryBox(this);
+    state.query->queued = true;
+    state.query->issued = false;
+    state.query->queuedFrame = m_frame;
+    m_pendingQueries.push_back(state.query);
+
+    // The unit cube stretched over the box
+    osg::Vec3 halfSize = (box._max - box._min) * 0.5f;
+    osg::ref_ptr<osg::RefMatrix> matrix = new osg::RefMatrix(
+                osg::Matrixd::scale(halfSize) * osg::Matrixd::translate(box.center()) *
+                *cv->getModelViewMatrix());
+    osg::BoundingBox unit(-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+
+    // Widen the near and far planes the cull computes, a clipped box
+    // would pass fewer samples than the node
+    cv->updateCalculatedNearFar(*matrix, unit);
+    float depth = -(box.center() * *cv->getModelViewMatrix()).z();
+
+    cv->pushStateSet(m_queryState.get());
+    cv->addDrawableAndDepth(state.query.get(), matrix.get(), depth);
+    cv->popStateSet();
+}
+
+void OcclusionCuller::collect(osg::RenderInfo& renderInfo)
+{
+    if (!initialize(renderInfo))
+        return;
+
+    Lock lock(m_mutex);
+
+    // Results are read once available, the draw never waits for them
+    auto answered = [this](osg::ref_ptr<QueryBox>& query) {
+        if (!query->issued) {
+            // Culled into a frame that was never drawn
+            if (m_frame - query->queuedFrame <= 2)
+                return false;
+            query->queued = false;
+            return true;
+        }
+
+        GLint available = 0;
+        m_extensions->glGetQueryObjectiv(query->name, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+
+        GLuint samples = 0;
+        m_extensions->glGetQueryObjectuiv(query->name, GL_QUERY_RESULT, &samples);
+        query->queued = false;
+        query->issued = false;
+        query->answered = true;
+        query->visible = samples > 0;
+        m_revealed |= query->visible;
+        return true;
+    };
+    m_pendingQueries.erase(std::remove_if(m_pendingQueries.begin(),
+                                          m_pendingQueries.end(), answered),
+                           m_pendingQueries.end());
+}
+
+GLuint OcclusionCuller::bufferName(const Readback& readback) const
+{
+    osg::GLBufferObject* object = readback.buffer->getOrCreateGLBufferObject(m_contextID);
+    return object ? object->getGLObjectID() : 0;
+}
+
+void OcclusionCuller::readback(osg::RenderInfo& renderInfo)
+{
+    osg::State* state = renderInfo.getState();
+    if (!initialize(renderInfo) || !state->getFrameStamp())
+        return;
+
+    Lock lock(m_mutex);
+    unsigned int frameNumber = state->getFrameStamp()->getFrameNumber();
+    const FrameCamera& camera = m_frameCameras[frameNumber % 4];
+    osg::Texture2D* texture = m_hiZTexture.get();
+    if (!texture || camera.frame != frameNumber)
+        return;
+
+    osg::GLExtensions* ext = m_extensions;
+    Readback& current = m_readbacks[frameNumber % 2];
+    Readback& previous = m_readbacks[(frameNumber + 1) % 2];
+
+    // Copy this frame's HiZ into a pixel buffer, the call returns at once.
+    // The buffers are OSG's, so they are deleted with the context.
+    int width = texture->getTextureWidth();
+    int height = texture->getTextureHeight();
+    size_t size = size_t(width) * height * sizeof(float);
+    if (!current.buffer.valid())
+        current.buffer = new osg::PixelDataBufferObject;
+    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER, bufferName(current));
+    if (current.size != size) {
+        ext->glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        current.size = size;
+    }
+    state->setActiveTextureUnit(0);
+    texture->apply(*state);
+    state->haveAppliedTextureAttribute(0, texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, nullptr);
+    current.textureWidth = width;
+    current.textureHeight = height;
+    current.camera = camera;
+    current.pending = true;
+
+    // The previous frame's copy has had a frame to complete
+    if (previous.pending) {
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER, bufferName(previous));
+        const float* data = static_cast<const float*>(
+                    ext->glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+        if (data) {
+            m_hiZ.assign(data, data + size_t(previous.textureWidth) * previous.textureHeight);
+            m_hiZWidth = previous.textureWidth;
+            m_hiZHeight = previous.textureHeight;
+            m_hiZCamera = previous.camera;
+            ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        previous.pending = false;
+    }
+    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
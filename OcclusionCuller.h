@@ -0,0 +1,156 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <osg/BufferObject>
+#include <osg/Camera>
+#include <osg/Drawable>
+#include <osg/GL>
+#include <osg/Geometry>
+#include <osg/Texture2D>
+#include <OpenThreads/Mutex>
+#include <map>
+#include <vector>
+
+namespace osg {
+class GLExtensions;
+}
+namespace osgUtil {
+class CullVisitor;
+}
+
+// Occlusion culling for the G-buffer pass of one SSAONode.  Bounding
+// boxes of scene nodes are tested against a hierarchical z buffer (HiZ):
+// the farthest view distance per HiZTile square of an earlier frame, read
+// back without waiting for the GPU and reprojected with that frame's
+// camera.  A node found hidden is skipped and its box is drawn in an
+// occlusion query against the current depth instead.  Geometry the HiZ
+// hid wrongly, say behind an occluder the camera just moved past, shows
+// up in the query and is drawn for the next VisibleFrames frames.
+//
+// The test runs in a cull callback attach() adds to the nodes of the
+// scene.  It only acts below a G-buffer camera that has the culler's
+// cameraCullCallback(), other views of the scene draw everything.
+class OcclusionCuller : public osg::Referenced
+{
+public:
+    // Depth texels per HiZ texel, HIZ_TILE in hiz.fp
+    static const int HiZTile = 16;
+    // Frames a node a query found visible is drawn without a HiZ test
+    static const int VisibleFrames = 8;
+    // Render bin of the query boxes, after the opaque geometry
+    static const int QueryBin = 100;
+
+    OcclusionCuller();
+
+    // Adds the test to the Geodes and branching Groups below node.  Nodes
+    // that have it already are left alone.
+    static void attach(osg::Node* node);
+
+    // Starts the frame, on the G-buffer camera
+    osg::Callback* cameraCullCallback();
+    // Reads back query results, pre draw callback of the G-buffer camera
+    osg::Camera::DrawCallback* collectCallback();
+    // Reads back the HiZ, post draw callback of the camera rendering it
+    osg::Camera::DrawCallback* readbackCallback();
+
+    // State of the query boxes: no color or depth writes.  SSAONode adds
+    // the program.
+    osg::StateSet* queryState() const { return m_queryState.get(); }
+
+    // Target the HiZ is rendered into, at most 1/HiZTile the G-buffer size
+    void setHiZTexture(osg::Texture2D* texture);
+
+    // The camera or the scene changed.  Nodes still hidden are queried
+    // again, until then each is queried once.
+    void viewChanged();
+    // Forgets the HiZ, e.g. while culling is switched off
+    void reset();
+
+    // True while queries are out or have just revealed geometry, so the
+    // G-buffer should be drawn again
+    bool isSettling() const;
+
+    // Nodes tested and skipped in the last frame
+    void statistics(unsigned int& tested, unsigned int& occluded) const;
+
+    // Hands the queries and pixel buffers of the context of state, or of
+    // any context without one, to OSG's deleted object lists of that
+    // context.  They are created again if the culler draws once more.
+    void releaseGLObjects(osg::State* state = nullptr);
+
+protected:
+    virtual ~OcclusionCuller();
+
+private:
+    struct CameraCallback;
+    struct CollectCallback;
+    struct ReadbackCallback;
+    struct NodeCallback;
+    friend struct NodeCallback;
+    class QueryBox;
+
+    // The camera of a frame, from its cull, for reprojecting its HiZ
+    struct FrameCamera {
+        unsigned int frame = ~0u;
+        osg::Matrixd view;
+        osg::Matrixd projection;
+        int width = 0; // viewport
+        int height = 0;
+    };
+
+    struct Readback {
+        osg::ref_ptr<osg::PixelDataBufferObject> buffer;
+        size_t size = 0;
+        int textureWidth = 0;
+        int textureHeight = 0;
+        FrameCamera camera;
+        bool pending = false;
+    };
+
+    struct NodeState {
+        osg::ref_ptr<QueryBox> query;
+        unsigned int lastSeen = 0;
+        unsigned int visibleUntil = 0; // frame
+        unsigned int queriedEpoch = ~0u;
+    };
+
+    void beginFrame(osgUtil::CullVisitor* cv);
+    bool cull(osg::Node& node, osgUtil::CullVisitor* cv);
+    bool hiZOccluded(const osg::BoundingBox& box, const osg::Matrixd& modelView) const;
+    void addQuery(NodeState& state, const osg::BoundingBox& box,
+                  osgUtil::CullVisitor* cv);
+    void collect(osg::RenderInfo& renderInfo);
+    void readback(osg::RenderInfo& renderInfo);
+    GLuint bufferName(const Readback& readback) const;
+    bool initialize(osg::RenderInfo& renderInfo);
+
+    osg::ref_ptr<osg::StateSet> m_queryState;
+    osg::ref_ptr<osg::Geometry> m_box; // unit cube the queries draw
+
+    mutable OpenThreads::Mutex m_mutex; // guards everything below
+    osg::ref_ptr<osg::Texture2D> m_hiZTexture;
+    FrameCamera m_frameCameras[4];      // by frame number, cull to draw
+    Readback m_readbacks[2];            // ping-ponged between frames
+
+    // The newest HiZ read back and the camera it was rendered with
+    std::vector<float> m_hiZ;
+    int m_hiZWidth;  // row length
+    int m_hiZHeight;
+    FrameCamera m_hiZCamera;
+    osg::Matrixd m_viewToHiZView; // this frame's view -> m_hiZCamera's
+
+    std::map<const osg::Node*, NodeState> m_nodes;
+    std::vector<osg::ref_ptr<QueryBox> > m_pendingQueries;
+    unsigned int m_frame;  // G-buffer culls so far
+    unsigned int m_epoch;  // viewChanged() calls
+    bool m_revealed;       // a query found a hidden node visible
+    unsigned int m_tested;
+    unsigned int m_occluded;
+
+    bool m_initialized;
+    bool m_supported;
+    unsigned int m_contextID;
+    osg::GLExtensions* m_extensions;
+};
+
+#endif // OCCLUSIONCULLER_H
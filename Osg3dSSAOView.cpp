@@ -2,7 +2,8 @@
 
 Osg3dSSAOView::Osg3dSSAOView(QWidget *parent)
     : Osg3dViewWithCamera(parent)
-    , m_ssao(new SSAONode(width(), height()))
+    , m_ssao(new SSAONode(0, 0)) // render targets allocated by resizeGL()
+    , m_pagerRevision(0)
 {
 
     m_root->removeChild(m_scene); // un-do the Osg3dViewWithCamera setup
@@ -22,7 +23,11 @@ void Osg3dSSAOView::paintGL()
     // Update the camera
     osg::Camera *cam = this->getCamera();
 
+    // Nodes the cull mask hides or shows change the G-buffer
+    if (cam->getCullMask() != m_cameraModel->cullMask()) {
         cam->setCullMask( m_cameraModel->cullMask() );
+        m_ssao->DirtyScene();
+    }
 
     m_cameraModel->setAspect((double)width() / (double)height());
 
@@ -31,9 +36,25 @@ void Osg3dSSAOView::paintGL()
 
     // Let SSAO class know that camera has changed
     m_ssao->updateProjectionMatrix(getCamera()->getProjectionMatrix());
+    m_ssao->updateViewMatrix(getCamera()->getViewMatrix());
 
     // Invoke the OSG traversal pipeline
     frame();
+
+    // Tiles this frame merged change the scene inside the same bound, the
+    // next frame draws them
+    if (m_pager.valid() && m_pager->mergeRevision() != m_pagerRevision) {
+        m_pagerRevision = m_pager->mergeRevision();
+        m_ssao->DirtyScene();
+        update();
+    }
+
+    // Temporal AO, a render target format switch or tiles still paging
+    // in need a few more frames to settle
+    if (m_pager.valid())
+        m_pager->prefetch(this, m_scene.get());
+    if (m_ssao->NeedsRedraw() || (m_pager.valid() && m_pager->isLoading()))
+        update();
 }
 
 void Osg3dSSAOView::resizeGL(int width, int height)
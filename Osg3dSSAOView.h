@@ -17,6 +17,13 @@ public:
     float ssaoPower() const { return m_ssao->GetSSAOPower(); }
     float ssaoHaloThreshold() const { return m_ssao->GetHaloTreshold(); }
     unsigned ssaoDisplayMode() const { return m_ssao->GetDisplayMode(); }
+    SSAONode::AOResolution ssaoResolution() const { return m_ssao->GetAOResolution(); }
+    SSAONode::AOAlgorithm ssaoAlgorithm() const { return m_ssao->GetAOAlgorithm(); }
+    bool ssaoTemporalIsEnabled() const { return m_ssao->IsTemporalEnabled(); }
+    bool ssaoDeinterleavedIsEnabled() const { return m_ssao->IsDeinterleavedEnabled(); }
+    bool ssaoBlueNoiseIsEnabled() const { return m_ssao->IsBlueNoiseEnabled(); }
+    bool ssaoNoiseOffsetIsEnabled() const { return m_ssao->IsNoiseOffsetEnabled(); }
+    bool ssaoOcclusionCullingIsEnabled() const { return m_ssao->IsOcclusionCullingEnabled(); }
 
 signals:
     void ssaoRadiusChanged(float f);
@@ -39,6 +46,15 @@ public slots:
     void setSSAOHaloThreshold(float f) { m_ssao->SetHaloTreshold(f);
                                        emit ssaoHaloThresholdChanged(f);}
     void setSSAODisplayMode(SSAONode::DisplayMode mode) { m_ssao->SetDisplayMode(mode); update();}
+    void setSSAOResolution(SSAONode::AOResolution r) { m_ssao->SetAOResolution(r); update();}
+    void setSSAOAlgorithm(SSAONode::AOAlgorithm a) { m_ssao->SetAOAlgorithm(a); update();}
+    void setSSAOTemporalEnabled(bool tf) { m_ssao->SetTemporalEnabled(tf); update();}
+    void setSSAODeinterleavedEnabled(bool tf) { m_ssao->SetDeinterleavedEnabled(tf); update();}
+    void setSSAOBlueNoiseEnabled(bool tf) { m_ssao->SetBlueNoiseEnabled(tf); update();}
+    void setSSAONoiseOffsetEnabled(bool tf) { m_ssao->SetNoiseOffsetEnabled(tf); update();}
+    void setSSAOOcclusionCullingEnabled(bool tf) { m_ssao->SetOcclusionCullingEnabled(tf); update();}
+    /// The scene graph was edited, the G-buffer has to be drawn again
+    void dirtySSAOScene() { m_ssao->DirtyScene(); update();}
     /// Render one frame
     virtual void paintGL() override;
 
@@ -47,6 +63,7 @@ public slots:
 
 protected:
     SSAONode *m_ssao;
+    unsigned int m_pagerRevision; // merges the G-buffer was dirtied for
 };
 
 #endif // OSG3DVIEWWITHSSAO_H
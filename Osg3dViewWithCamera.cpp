@@ -81,6 +81,13 @@ void Osg3dViewWithCamera::paintGL()
     // Invoke the OSG traversal pipeline
     frame();
 
+    // Keep drawing until the tiles around the view are in
+    if (m_pager.valid()) {
+        m_pager->prefetch(this, m_scene.get());
+        if (m_pager->isLoading())
+            update();
+    }
+
     emit updated();
 }
 
@@ -93,6 +100,13 @@ void Osg3dViewWithCamera::setCameraModel(osg::ref_ptr<CameraModel> cameraControl
     update();
 }
 
+void Osg3dViewWithCamera::setScenePager(ScenePager* pager)
+{
+    m_pager = pager;
+    m_pager->attach(this);
+    update();
+}
+
 void Osg3dViewWithCamera::resizeGL(int width, int height)
 {
     m_osgGraphicsWindow->resized(0,0,width,height);
@@ -12,6 +12,7 @@
 #include <osgUtil/LineSegmentIntersector>
 
 #include "CameraModel.h"
+#include "ScenePager.h"
 
 
 ///
@@ -40,6 +41,8 @@ public:
 
     osg::ref_ptr<CameraModel> cameraModel() const { return m_cameraModel; }
     void setCameraModel(osg::ref_ptr<CameraModel> cameraModel);
+    /// Page PagedLODs with a pager of this view's own
+    void setScenePager(ScenePager* pager);
     osg::ref_ptr<osgUtil::LineSegmentIntersector>
         intersectUnderCursor(const int x, const int y, unsigned mask=~0);
 public slots:
@@ -104,6 +107,9 @@ protected: // These are from QOpenGLWidget.  There are implementations here,
     /// CameraModel --> controls the camera of the osgViewer
     osg::ref_ptr< CameraModel > m_cameraModel;
 
+    /// Null unless the scene is paged, see setScenePager()
+    osg::ref_ptr<ScenePager> m_pager;
+
     QString m_glInfo;
     QList<QMenu *> m_menus;
 
@@ -0,0 +1,192 @@
+#include "PassTimer.h"
+#include <osg/GLExtensions>
+#include <osg/FrameStamp>
+#include <osg/OcclusionQueryNode>
+#include <osg/State>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+struct PassTimer::Callback : public osg::Camera::DrawCallback
+{
+    Callback(PassTimer* timer, int pass, bool begin)
+        : timer(timer), pass(pass), begin(begin) {}
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        if (begin)
+            timer->begin(renderInfo, pass);
+        else
+            timer->end(renderInfo, pass);
+    }
+
+    osg::ref_ptr<PassTimer> timer;
+    int pass;
+    bool begin;
+};
+
+PassTimer::PassTimer(int passCount)
+    : m_passCount(passCount)
+    , m_supported(true)
+    , m_initialized(false)
+    , m_contextID(0)
+    , m_extensions(nullptr)
+    , m_samples(passCount)
+    , m_samplesTaken(0)
+{
+    for (auto& samples : m_samples) {
+        samples.count = 0;
+        samples.next = 0;
+        samples.last = 0.0;
+    }
+}
+
+PassTimer::~PassTimer()
+{
+    releaseGLObjects();
+}
+
+void PassTimer::releaseGLObjects(osg::State* state)
+{
+    if (!m_initialized || (state && state->getContextID() != m_contextID))
+        return;
+
+    // Deleted by OSG the next time the context flushes deleted objects
+    for (const QuerySlot& s : m_slots) {
+        osg::QueryGeometry::deleteQueryObject(m_contextID, s.begin);
+        osg::QueryGeometry::deleteQueryObject(m_contextID, s.end);
+    }
+    m_slots.clear();
+    m_initialized = false;
+}
+
+osg::Camera::DrawCallback* PassTimer::beginCallback(int pass)
+{
+    return new Callback(this, pass, true);
+}
+
+osg::Camera::DrawCallback* PassTimer::endCallback(int pass)
+{
+    return new Callback(this, pass, false);
+}
+
+bool PassTimer::initialize(osg::RenderInfo& renderInfo)
+{
+    if (m_initialized)
+        return m_supported && renderInfo.getContextID() == m_contextID;
+
+    // Queries belong to one context, the first one to draw
+    m_initialized = true;
+    m_contextID = renderInfo.getContextID();
+    m_extensions = osg::GLExtensions::Get(m_contextID, true);
+    m_supported = m_extensions && m_extensions->isARBTimerQuerySupported;
+    if (!m_supported)
+        return false;
+
+    std::vector<GLuint> names(m_passCount * QueryFrames * 2);
+    m_extensions->glGenQueries(GLsizei(names.size()), &names[0]);
+
+    m_slots.resize(m_passCount * QueryFrames);
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        m_slots[i].begin = names[i * 2];
+        m_slots[i].end = names[i * 2 + 1];
+        m_slots[i].frame = 0;
+        m_slots[i].started = false;
+        m_slots[i].pending = false;
+    }
+    return true;
+}
+
+PassTimer::QuerySlot& PassTimer::slot(int pass, unsigned int frame)
+{
+    return m_slots[pass * QueryFrames + frame % QueryFrames];
+}
+
+void PassTimer::begin(osg::RenderInfo& renderInfo, int pass)
+{
+    if (!initialize(renderInfo) || !renderInfo.getState()->getFrameStamp())
+        return;
+
+    collect(pass);
+
+    // A result still missing after QueryFrames frames is dropped rather
+    // than waited for
+    unsigned int frame = renderInfo.getState()->getFrameStamp()->getFrameNumber();
+    QuerySlot& s = slot(pass, frame);
+    m_extensions->glQueryCounter(s.begin, GL_TIMESTAMP);
+    s.frame = frame;
+    s.started = true;
+    s.pending = false;
+}
+
+void PassTimer::end(osg::RenderInfo& renderInfo, int pass)
+{
+    if (!initialize(renderInfo) || !renderInfo.getState()->getFrameStamp())
+        return;
+
+    unsigned int frame = renderInfo.getState()->getFrameStamp()->getFrameNumber();
+    QuerySlot& s = slot(pass, frame);
+    if (!s.started || s.frame != frame)
+        return;
+
+    m_extensions->glQueryCounter(s.end, GL_TIMESTAMP);
+    s.started = false;
+    s.pending = true;
+}
+
+void PassTimer::collect(int pass)
+{
+    for (int i = 0; i < QueryFrames; i++) {
+        QuerySlot& s = m_slots[pass * QueryFrames + i];
+        if (!s.pending)
+            continue;
+
+        // The end timestamp is written last, once it is there both are
+        GLint available = 0;
+        m_extensions->glGetQueryObjectiv(s.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        m_extensions->glGetQueryObjectui64v(s.begin, GL_QUERY_RESULT, &begin);
+        m_extensions->glGetQueryObjectui64v(s.end, GL_QUERY_RESULT, &end);
+        s.pending = false;
+
+        double ms = end > begin ? double(end - begin) * 1.0e-6 : 0.0;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+        Samples& samples = m_samples[pass];
+        samples.times[samples.next] = ms;
+        samples.next = (samples.next + 1) % SampleWindow;
+        samples.count = std::min(samples.count + 1, int(SampleWindow));
+        samples.last = ms;
+        m_samplesTaken++;
+    }
+}
+
+bool PassTimer::getTime(int pass, double& lastMs, double& meanMs, double& maxMs) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    const Samples& samples = m_samples[pass];
+    if (samples.count == 0)
+        return false;
+
+    double sum = 0.0;
+    maxMs = 0.0;
+    for (int i = 0; i < samples.count; i++) {
+        sum += samples.times[i];
+        maxMs = std::max(maxMs, samples.times[i]);
+    }
+    lastMs = samples.last;
+    meanMs = sum / samples.count;
+    return true;
+}
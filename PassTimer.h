@@ -0,0 +1,82 @@
+#ifndef PASSTIMER_H
+#define PASSTIMER_H
+
+#include <osg/Camera>
+#include <osg/GL>
+#include <OpenThreads/Mutex>
+#include <vector>
+
+namespace osg {
+class GLExtensions;
+}
+
+// GPU time of render passes, measured with GL_TIMESTAMP queries written
+// by camera draw callbacks.  A pass may span several cameras: the begin
+// callback goes on the first, the end callback on the last.  Results are
+// read back once available, up to QueryFrames frames later, so the draw
+// never waits on the GPU.
+class PassTimer : public osg::Referenced
+{
+public:
+    explicit PassTimer(int passCount);
+
+    osg::Camera::DrawCallback* beginCallback(int pass);
+    osg::Camera::DrawCallback* endCallback(int pass);
+
+    // False once the context turned out to lack GL_ARB_timer_query
+    bool isSupported() const { return m_supported; }
+
+    // Milliseconds over the last SampleWindow frames the pass ran.
+    // False until the pass has been timed at least once.
+    bool getTime(int pass, double& lastMs, double& meanMs, double& maxMs) const;
+
+    // Grows by one for every result read back
+    unsigned int samplesTaken() const { return m_samplesTaken; }
+
+    // Hands the queries of the context of state, or of any context
+    // without one, to OSG's deleted object lists of that context
+    void releaseGLObjects(osg::State* state = nullptr);
+
+    static const int QueryFrames = 4;
+    static const int SampleWindow = 60;
+
+protected:
+    virtual ~PassTimer();
+
+private:
+    struct Callback;
+
+    struct QuerySlot {
+        GLuint begin;
+        GLuint end;
+        unsigned int frame;
+        bool started;  // begin written, end not yet
+        bool pending;  // both written, result not read back
+    };
+
+    struct Samples {
+        double times[SampleWindow];
+        int count;
+        int next;
+        double last;
+    };
+
+    void begin(osg::RenderInfo& renderInfo, int pass);
+    void end(osg::RenderInfo& renderInfo, int pass);
+    bool initialize(osg::RenderInfo& renderInfo);
+    void collect(int pass);
+    QuerySlot& slot(int pass, unsigned int frame);
+
+    int m_passCount;
+    bool m_supported;
+    bool m_initialized;
+    unsigned int m_contextID;
+    osg::GLExtensions* m_extensions;
+    std::vector<QuerySlot> m_slots;   // QueryFrames per pass
+
+    mutable OpenThreads::Mutex m_mutex; // guards the samples
+    std::vector<Samples> m_samples;
+    unsigned int m_samplesTaken;
+};
+
+#endif // PASSTIMER_H
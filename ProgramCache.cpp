@@ -0,0 +1,210 @@
+#include "ProgramCache.h"
+#include <osg/GL>
+#include <osg/GLExtensions>
+#include <osg/State>
+#include <OpenThreads/ScopedLock>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <map>
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+namespace {
+
+// Bump when the file layout changes
+const quint32 BinaryMagic = 0x53534142; // "SSAB"
+const quint32 BinaryVersion = 1;
+
+OpenThreads::Mutex s_mutex;
+std::map<std::string, std::string> s_sources;
+bool s_binaryCacheEnabled = true;
+
+quint64 fnv1a(const std::string& s, quint64 hash = 14695981039346656037ULL)
+{
+    for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// One file per driver and set of sources
+QString binaryPath(const std::string& driver, const std::string& sources)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (dir.isEmpty())
+        return QString();
+    quint64 key = fnv1a(sources, fnv1a(driver));
+    return QDir(dir).filePath(QString("programs/%1.bin").arg(key, 16, 16, QChar('0')));
+}
+
+std::string driverString()
+{
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    return std::string(vendor ? vendor : "") + "|" +
+            (renderer ? renderer : "") + "|" +
+            (version ? version : "");
+}
+
+} // namespace
+
+bool ProgramCache::resourceSource(const std::string& resourceName,
+                                  std::string& source)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_mutex);
+    auto cached = s_sources.find(resourceName);
+    if (cached != s_sources.end()) {
+        source = cached->second;
+        return true;
+    }
+
+    QFile file(QString::fromStdString(resourceName));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    source = file.readAll().toStdString();
+    s_sources[resourceName] = source;
+    return true;
+}
+
+void ProgramCache::setBinaryCacheEnabled(bool tf)
+{
+    s_binaryCacheEnabled = tf;
+}
+
+bool ProgramCache::isBinaryCacheEnabled()
+{
+    return s_binaryCacheEnabled;
+}
+
+osg::Program::ProgramBinary* ProgramCache::loadBinary(const std::string& driver,
+                                                      const std::string& sources)
+{
+    QString path = binaryPath(driver, sources);
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    QDataStream in(&file);
+    quint32 magic, version, format;
+    QByteArray storedDriver, data;
+    quint64 sourcesHash;
+    in >> magic >> version >> storedDriver >> sourcesHash >> format >> data;
+
+    // A hash collision or a file from another build, ignore it
+    if (in.status() != QDataStream::Ok || magic != BinaryMagic ||
+            version != BinaryVersion || storedDriver.toStdString() != driver ||
+            sourcesHash != fnv1a(sources) || data.isEmpty())
+        return nullptr;
+
+    osg::Program::ProgramBinary* binary = new osg::Program::ProgramBinary;
+    binary->assign(data.size(), (const unsigned char*)data.constData());
+    binary->setFormat(format);
+    return binary;
+}
+
+void ProgramCache::storeBinary(const std::string& driver,
+                               const std::string& sources,
+                               const osg::Program::ProgramBinary* binary)
+{
+    QString path = binaryPath(driver, sources);
+    if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).path()))
+        return;
+
+    // QSaveFile renames into place, so a crash never leaves half a file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    QDataStream out(&file);
+    out << BinaryMagic << BinaryVersion
+        << QByteArray::fromStdString(driver) << quint64(fnv1a(sources))
+        << quint32(binary->getFormat())
+        << QByteArray((const char*)binary->getData(), int(binary->getSize()));
+    file.commit();
+}
+
+void ProgramCache::removeBinary(const std::string& driver,
+                                const std::string& sources)
+{
+    QString path = binaryPath(driver, sources);
+    if (!path.isEmpty())
+        QFile::remove(path);
+}
+
+std::string CachedProgram::sources() const
+{
+    std::string sources;
+    for (unsigned int i = 0; i < getNumShaders(); i++) {
+        sources += getShader(i)->getShaderSource();
+        sources += '\0';
+    }
+    return sources;
+}
+
+void CachedProgram::apply(osg::State& state) const
+{
+    unsigned int contextID = state.getContextID();
+    if (m_linked[contextID]) {
+        osg::Program::apply(state);
+        return;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    CachedProgram* self = const_cast<CachedProgram*>(this);
+    osg::GLExtensions* extensions = osg::GLExtensions::Get(contextID, true);
+    bool enabled = ProgramCache::isBinaryCacheEnabled() && extensions &&
+            extensions->glProgramBinary && extensions->glGetProgramBinary;
+    std::string driver = enabled ? driverString() : std::string();
+    std::string src = enabled ? sources() : std::string();
+
+    // Another context may have attached a binary already
+    if (enabled && !getProgramBinary()) {
+        osg::ref_ptr<ProgramBinary> binary = ProgramCache::loadBinary(driver, src);
+        if (binary.valid())
+            self->setProgramBinary(binary.get());
+    }
+
+    osg::Program::apply(state);
+    m_linked[contextID] = 1;
+
+    PerContextProgram* pcp = getPCP(state);
+    if (!enabled || !pcp)
+        return;
+
+    if (getProgramBinary()) {
+        if (pcp->isLinked())
+            return;
+
+        // Rejected, e.g. after a driver update: link from source and
+        // replace the stale file
+        self->setProgramBinary(nullptr);
+        self->dirtyProgram();
+        ProgramCache::removeBinary(driver, src);
+        osg::Program::apply(state);
+        pcp = getPCP(state);
+        if (!pcp || !pcp->isLinked())
+            return;
+    }
+
+    GLint length = 0;
+    extensions->glGetProgramiv(pcp->getHandle(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    osg::ref_ptr<ProgramBinary> binary = new ProgramBinary;
+    binary->allocate(length);
+    GLenum format = 0;
+    extensions->glGetProgramBinary(pcp->getHandle(), length, nullptr, &format,
+                                   binary->getData());
+    binary->setFormat(format);
+    ProgramCache::storeBinary(driver, src, binary.get());
+}
@@ -0,0 +1,57 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <osg/Program>
+#include <osg/buffered_value>
+#include <OpenThreads/Mutex>
+#include <string>
+
+// Shader sources and linked program binaries shared by every SSAONode.
+// Sources are read from the Qt resources once per process.  Binaries
+// (GL_ARB_get_program_binary) are kept on disk under the user's cache
+// directory, keyed by GL vendor/renderer/version and by the sources with
+// their variant defines, so a warm start links without compiling.
+class ProgramCache
+{
+    ProgramCache() {}
+public:
+    // Contents of a Qt resource, false when it does not exist
+    static bool resourceSource(const std::string& resourceName,
+                               std::string& source);
+
+    // On by default, off makes every start a cold start
+    static void setBinaryCacheEnabled(bool tf);
+    static bool isBinaryCacheEnabled();
+
+    // Nullptr when there is no binary for this driver and these sources
+    static osg::Program::ProgramBinary* loadBinary(const std::string& driver,
+                                                   const std::string& sources);
+    static void storeBinary(const std::string& driver,
+                            const std::string& sources,
+                            const osg::Program::ProgramBinary* binary);
+    static void removeBinary(const std::string& driver,
+                             const std::string& sources);
+};
+
+// A Program that links from a cached binary when there is one and
+// stores its binary after linking from source.  A binary the driver
+// rejects is dropped and the program builds from source instead.
+class CachedProgram : public osg::Program
+{
+public:
+    CachedProgram() {}
+
+    virtual void apply(osg::State& state) const;
+
+protected:
+    virtual ~CachedProgram() {}
+
+private:
+    std::string sources() const;
+
+    // Per context, set once the first apply() linked one way or the other
+    mutable osg::buffered_value<int> m_linked;
+    mutable OpenThreads::Mutex m_mutex;
+};
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,116 @@
+#include "RenderTargetPool.h"
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+
+namespace {
+
+// What drivers typically store per texel, RGB is padded to four bytes
+size_t bytesPerTexel(GLint internalFormat)
+{
+    switch (internalFormat) {
+    case GL_R8:
+        return 1;
+    case GL_RG8:
+        return 2;
+    case GL_RGBA16F_ARB:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+} // namespace
+
+osg::Texture2D* RenderTargetPool::lease(const void* user, int width, int height,
+                                        GLint internalFormat, GLenum sourceFormat,
+                                        GLenum sourceType, int mipLevels)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    for (Target& target : m_targets) {
+        if (target.width == width && target.height == height &&
+                target.internalFormat == internalFormat &&
+                target.mipLevels == mipLevels &&
+                target.users.count(user) == 0) {
+            target.users.insert(user);
+            return target.texture.get();
+        }
+    }
+
+    osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D;
+    texture->setTextureSize(width, height);
+    texture->setInternalFormat(internalFormat);
+    texture->setSourceFormat(sourceFormat);
+    texture->setSourceType(sourceType);
+    if (mipLevels > 0) {
+        // Levels are picked explicitly with texelFetch, never filtered
+        texture->setNumMipmapLevels(mipLevels + 1);
+        texture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::NEAREST_MIPMAP_NEAREST);
+        texture->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::NEAREST);
+        texture->allocateMipmapLevels();
+    } else {
+        texture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR);
+        texture->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR);
+    }
+
+    Target target;
+    target.width = width;
+    target.height = height;
+    target.internalFormat = internalFormat;
+    target.mipLevels = mipLevels;
+    target.texture = texture;
+    target.users.insert(user);
+    target.lastUser = nullptr;
+    m_targets.push_back(target);
+    return texture.get();
+}
+
+void RenderTargetPool::release(const void* user)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    for (Target& target : m_targets)
+        target.users.erase(user);
+}
+
+void RenderTargetPool::trim()
+{
+    // The GL textures go once the last camera and state set let go
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    m_targets.erase(std::remove_if(m_targets.begin(), m_targets.end(),
+                                   [](const Target& target) {
+                                       return target.users.empty();
+                                   }),
+                    m_targets.end());
+}
+
+bool RenderTargetPool::claim(const void* user)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    bool intact = true;
+    for (Target& target : m_targets) {
+        if (target.users.count(user) == 0)
+            continue;
+        if (target.lastUser != nullptr && target.lastUser != user)
+            intact = false;
+        target.lastUser = user;
+    }
+    return intact;
+}
+
+unsigned int RenderTargetPool::targetCount() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    return (unsigned int)m_targets.size();
+}
+
+size_t RenderTargetPool::allocatedBytes() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    size_t bytes = 0;
+    for (const Target& target : m_targets) {
+        for (int level = 0; level <= target.mipLevels; level++)
+            bytes += size_t(std::max(1, target.width >> level)) *
+                     size_t(std::max(1, target.height >> level)) *
+                     bytesPerTexel(target.internalFormat);
+    }
+    return bytes;
+}
@@ -0,0 +1,58 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+#include <osg/GL>
+#include <osg/Texture2D>
+#include <OpenThreads/Mutex>
+#include <set>
+#include <vector>
+
+// Render targets leased by size and format.  Every SSAONode has a pool of
+// its own unless it is given a shared one.  Nodes sharing a pool get the
+// same textures for the same sizes and formats, which is only safe when
+// they render one after another on the same context (e.g. the views of a
+// CompositeViewer).  The contents of a shared target last until another
+// user renders into it, claim() tells whether that happened.
+class RenderTargetPool : public osg::Referenced
+{
+public:
+    RenderTargetPool() {}
+
+    // A target no other lease of this user holds.  mipLevels levels below
+    // the base level are allocated up front, so they can be rendered to.
+    osg::Texture2D* lease(const void* user, int width, int height,
+                          GLint internalFormat, GLenum sourceFormat,
+                          GLenum sourceType, int mipLevels = 0);
+
+    // Returns every lease of the user.  Targets nobody leases are kept
+    // until trim(), so leasing the same again gets the same textures.
+    void release(const void* user);
+    void trim();
+
+    // Makes the user the last to render into its targets.  False when
+    // another user rendered into one of them since this user's last claim.
+    bool claim(const void* user);
+
+    unsigned int targetCount() const;
+    // Approximate GPU memory of all targets, mipmaps included
+    size_t allocatedBytes() const;
+
+protected:
+    virtual ~RenderTargetPool() {}
+
+private:
+    struct Target {
+        int width;
+        int height;
+        GLint internalFormat;
+        int mipLevels;
+        osg::ref_ptr<osg::Texture2D> texture;
+        std::set<const void*> users;
+        const void* lastUser;
+    };
+
+    mutable OpenThreads::Mutex m_mutex;
+    std::vector<Target> m_targets;
+};
+
+#endif // RENDERTARGETPOOL_H
@@ -0,0 +1,118 @@
+#include "SSAOKernels.h"
+
+// The tables are filled by constexpr functions, which needs C++14 loops
+// and, since <cmath> is not constexpr, the few math functions below.
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+
+// Taps stay this far above the tangent plane.  Grazing taps mostly hit
+// the surface itself and only add self occlusion.
+constexpr double MinCosine = 0.2;
+
+// Nearest tap distance, as a fraction of the radius
+constexpr double MinScale = 0.1;
+
+constexpr double constSqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    // Newton from above converges monotonically
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0 ; i < 64 ; i++)
+        r = 0.5 * (r + x / r);
+    return r;
+}
+
+constexpr double constSin(double x)
+{
+    // Reduce to [-pi, pi], then Taylor series
+    long turns = long(x / (2.0 * Pi) + (x < 0.0 ? -0.5 : 0.5));
+    x -= double(turns) * 2.0 * Pi;
+    double term = x;
+    double sum = x;
+    for (int n = 1 ; n < 16 ; n++) {
+        term *= -x * x / double((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constCos(double x)
+{
+    return constSin(x + 0.5 * Pi);
+}
+
+// Digits of i mirrored around the radix point
+constexpr double radicalInverse(int i, int base)
+{
+    double digit = 1.0;
+    double r = 0.0;
+    while (i > 0) {
+        digit /= base;
+        r += digit * (i % base);
+        i /= base;
+    }
+    return r;
+}
+
+template <int N>
+struct KernelTable {
+    float xyz[3 * N];
+};
+
+// 3D Hammersley points (i/N, base 2, base 3).  The first two place the
+// direction cosine weighted on the cone (Malley's method: uniform on the
+// disk, projected up), so every tap weighs the same in the occlusion
+// integral.  The third sets the distance, lerp(MinScale, 1, t^2) puts
+// more taps near the center where occluders matter most.
+//
+// ssao.fp strides through the kernel in temporal mode.  Any stride of
+// these points is itself spread over the whole cone.
+template <int N>
+constexpr KernelTable<N> makeKernel()
+{
+    KernelTable<N> table{};
+    for (int i = 0 ; i < N ; i++) {
+        double u = (i + 0.5) / N * (1.0 - MinCosine * MinCosine);
+        double phi = 2.0 * Pi * radicalInverse(i, 2);
+        double t = radicalInverse(i, 3);
+        double scale = MinScale + (1.0 - MinScale) * t * t;
+
+        double r = constSqrt(u);
+        table.xyz[3 * i + 0] = float(r * constCos(phi) * scale);
+        table.xyz[3 * i + 1] = float(r * constSin(phi) * scale);
+        table.xyz[3 * i + 2] = float(constSqrt(1.0 - u) * scale);
+    }
+    return table;
+}
+
+template <int K>
+constexpr KernelTable<K * K> kernelTable = makeKernel<K * K>();
+
+// Catch a broken table at compile time
+static_assert(kernelTable<8>.xyz[2] > 0.0f, "kernel tap below the surface");
+static_assert(kernelTable<8>.xyz[0] * kernelTable<8>.xyz[0] +
+              kernelTable<8>.xyz[1] * kernelTable<8>.xyz[1] +
+              kernelTable<8>.xyz[2] * kernelTable<8>.xyz[2] < 1.0001f,
+              "kernel tap outside the radius");
+
+} // namespace
+
+const float* SSAOKernels::kernel(int kernelSize)
+{
+    switch (kernelSize) {
+    case 1: return kernelTable<1>.xyz;
+    case 2: return kernelTable<2>.xyz;
+    case 3: return kernelTable<3>.xyz;
+    case 4: return kernelTable<4>.xyz;
+    case 5: return kernelTable<5>.xyz;
+    case 6: return kernelTable<6>.xyz;
+    case 7: return kernelTable<7>.xyz;
+    case 8: return kernelTable<8>.xyz;
+    case 9: return kernelTable<9>.xyz;
+    case 10: return kernelTable<10>.xyz;
+    case 11: return kernelTable<11>.xyz;
+    }
+    return nullptr;
+}
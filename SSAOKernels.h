@@ -0,0 +1,21 @@
+#ifndef SSAOKERNELS_H
+#define SSAOKERNELS_H
+
+// Sample kernels of the hemisphere occlusion pass, one per supported
+// kernel size.  The tables are computed by the compiler, so building a
+// kernel costs neither a random number generator nor a file write, and
+// every SSAONode with the same kernel size samples the same points.
+class SSAOKernels
+{
+    SSAOKernels() {}
+public:
+    // kernelSize^2 taps must fit MAX_KERNEL_SIZE of ssao.fp
+    static const int MinKernelSize = 1;
+    static const int MaxKernelSize = 11;
+
+    // kernelSize^2 xyz triples in tangent space, z along the normal.
+    // nullptr when the size is not supported.
+    static const float* kernel(int kernelSize);
+};
+
+#endif // SSAOKERNELS_H
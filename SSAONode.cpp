@@ -1,11 +1,143 @@
 #include "SSAONode.h"
 #include <osg/Texture2D>
 #include <osg/Texture>
+#include <osg/GLExtensions>
 #include <osgDB/ReadFile> 
 #include <osgDB/FileUtils>
 #include <osgViewer/View>
-#include <QTextStream>
-#include <QFile>
+#include <osgUtil/CullVisitor>
+#include <sstream>
+#include "SSAOKernels.h"
+#include "BlueNoise.h"
+#include "ProgramCache.h"
+
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+// PRE_RENDER order of the passes
+enum {
+    GBufferOrder = 0,
+    LinearizeOrder,
+    HiZOrder,
+    DepthMipOrder, // one per pyramid level
+    DownsampleOrder = DepthMipOrder + SSAONode::DepthMipLevels,
+    DeinterleaveOrder,
+    SSAOOrder,
+    ReinterleaveOrder,
+    TemporalOrder,
+    BlurHorizontalOrder,
+    BlurVerticalOrder
+};
+
+// Records which render target formats the context supports.  Runs as a
+// pre draw callback, i.e. with the context current, and leaves the
+// result for the next updateViewMatrix() to apply.
+struct SSAONode::FormatDetectCallback : public osg::Camera::DrawCallback
+{
+    FormatDetectCallback(SSAONode* node) : node(node) {}
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        if (node->m_formatsDetected) return;
+
+        unsigned int contextID = renderInfo.getContextID();
+        node->m_textureRGSupported =
+                osg::isGLExtensionOrVersionSupported(contextID, "GL_ARB_texture_rg", 3.0f);
+        node->m_halfFloatSupported =
+                osg::isGLExtensionOrVersionSupported(contextID, "GL_ARB_texture_float", 3.0f) &&
+                osg::isGLExtensionOrVersionSupported(contextID, "GL_ARB_half_float_pixel", 3.0f);
+        node->m_formatsDetected = true;
+        node->m_formatsPending = true;
+    }
+
+    SSAONode* node; // owns the camera this is attached to
+};
+
+// Limits the levels of the depth pyramid texture that can be sampled.  A
+// pyramid camera renders into one level and reads the one above, with the
+// whole texture bound that would be a feedback loop, which GL leaves
+// undefined.  Its pre draw callback narrows the range to the level it
+// reads, its post draw callback restores the full pyramid.
+struct SSAONode::MipRangeCallback : public osg::Camera::DrawCallback
+{
+    MipRangeCallback(SSAONode* node, int baseLevel, int maxLevel)
+        : node(node), baseLevel(baseLevel), maxLevel(maxLevel) {}
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        osg::Texture2D* texture = node->linearZTex.get();
+        if (!texture) return;
+
+        renderInfo.getState()->applyTextureAttribute(0, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    }
+
+    SSAONode* node; // owns the camera this is attached to
+    int baseLevel;
+    int maxLevel;
+};
+
+struct SSAONode::InstancedCullCallback : public osg::NodeCallback
+{
+    InstancedCullCallback()
+    {
+        // Outside an SSAONode the instances are lit like the G-buffer
+        // color, without any render target
+        osg::ref_ptr<SSAOResources> resources = SSAOResources::shared();
+        const std::string key = "forward|:/shaders/phong.vp|:/shaders/phong.fp|INSTANCED";
+        osg::ref_ptr<osg::Program> program = resources->program(key);
+        if (!program.valid()) {
+            std::string vertexSource, fragmentSource;
+            ProgramCache::resourceSource(":/shaders/phong.vp", vertexSource);
+            ProgramCache::resourceSource(":/shaders/phong.fp", fragmentSource);
+            program = new osg::Program;
+            program->addShader(new osg::Shader(osg::Shader::VERTEX,
+                    injectDefines(vertexSource, "#define INSTANCED\n")));
+            program->addShader(new osg::Shader(osg::Shader::FRAGMENT, fragmentSource));
+            program->addBindAttribLocation("instancePosition", InstancePositionAttrib);
+            program->addBindAttribLocation("instanceColor", InstanceColorAttrib);
+            resources->addProgram(key, program.get());
+        }
+        forwardState = new osg::StateSet;
+        forwardState->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    }
+
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        if (!cv) {
+            traverse(node, nv);
+            return;
+        }
+
+        // The innermost SSAONode decides, a G-buffer camera is its child
+        osg::StateSet* state = forwardState.get();
+        const osg::NodePath& path = nv->getNodePath();
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            SSAONode* ssao = dynamic_cast<SSAONode*>(*it);
+            if (ssao && ssao->m_instancedState.valid()) {
+                state = ssao->m_instancedState.get();
+                break;
+            }
+        }
+
+        cv->pushStateSet(state);
+        traverse(node, nv);
+        cv->popStateSet();
+    }
+
+    osg::ref_ptr<osg::StateSet> forwardState;
+};
+
+osg::NodeCallback* SSAONode::createInstancedCullCallback()
+{
+    return new InstancedCullCallback;
+}
 
 // Default settings constructor
 SSAONode::SSAONode(int width,
@@ -15,7 +147,8 @@ SSAONode::SSAONode(int width,
      int blurSize,
      float radius,
      float power)
-     : m_kernelSize(kernelSize),
+     : m_kernelSize(std::min(std::max(kernelSize, SSAOKernels::MinKernelSize),
+                             SSAOKernels::MaxKernelSize)),
        m_noiseSize(noiseSize),
        m_blurSize(blurSize),
        m_ssaoRadius(radius),
@@ -25,16 +158,48 @@ SSAONode::SSAONode(int width,
        m_haloTreshold(radius),
        m_width(width),
        m_height(height),
+       m_aoResolution(AO_FullRes),
+       m_aoAlgorithm(AO_HemisphereKernel),
+       m_temporalEnabled(false),
+       m_historyIndex(0),
+       m_frameNumber(0),
+       m_historyFrames(0),
+       m_stillFrames(0),
+       m_deinterleaved(false),
+       m_occlusionCulling(false),
+       m_attachFrames(0),
+       m_skipAO(false),
+       m_sceneRevision(0),
+       m_drawnSceneRevision(0),
+       m_gbufferLayout(GBuffer_Compact),
+       m_formatsDetected(false),
+       m_formatsPending(false),
+       m_textureRGSupported(false),
+       m_halfFloatSupported(false),
+       m_allocatedWidth(0),
+       m_allocatedHeight(0),
+       m_passTimer(new PassTimer(PassCount)),
 
        m_kernelData(nullptr),
        m_noiseData(nullptr),
-
-       displayType(SSAO_ColorAndAO)
+       m_randomState(0),
+       m_blueNoiseEnabled(false),
+       m_noiseOffsetEnabled(false),
+       m_noiseOffset(0, 0),
+
+       displayType(SSAO_ColorAndAO),
+       m_resources(SSAOResources::shared()),
+       m_renderTargets(new RenderTargetPool),
+       m_culler(new OcclusionCuller)
 {
+    // Builds cameras, programs and uniforms once.  Render targets are only
+    // allocated when there is a real size (here or in the first Resize())
     Initialize();
 }
 
 SSAONode::~SSAONode() {
+    m_renderTargets->release(this);
+    m_renderTargets->trim();
     if (m_kernelData != NULL) {
         delete[] m_kernelData;
         m_kernelData = NULL;
@@ -46,25 +211,24 @@ SSAONode::~SSAONode() {
 }
 
 
-void SSAONode::addKernelUniformToStateSet(osg::StateSet *stateset, int kernelLength)
+void SSAONode::setKernel(int kernelLength)
 {
-    // Set ssao sampling kernel as uniform
-    osg::Uniform *ssaoKernelUniform =
-            new osg::Uniform(osg::Uniform::FLOAT_VEC3,
-                             "ssaoKernel",
-                             kernelLength);
+    static_assert(SSAOKernels::MaxKernelSize * SSAOKernels::MaxKernelSize <= MaxKernelLength,
+                  "the largest kernel has to fit the parameter block");
 
-    // Create hemisphere kernel and noise texture
+    // The kernel tables are built at compile time
     if (m_kernelData == nullptr) {
+        const float* kernel = SSAOKernels::kernel(m_kernelSize);
         m_kernelData = new osg::Vec3f[kernelLength];
-        generateHemisphereSamples(m_kernelData, kernelLength);
+        for (int i = 0; i < kernelLength; i++)
+            m_kernelData[i].set(kernel[3*i], kernel[3*i+1], kernel[3*i+2]);
     }
 
+    // std140 pads every array element to a vec4
     for (int i = 0; i < kernelLength; i++) {
-        ssaoKernelUniform->setElement(i, m_kernelData[i]);
+        m_parameterBlock->set(Param_Kernel + 16 * i, osg::Vec4f(m_kernelData[i], 0.0f));
     }
-
-    stateset->addUniform(ssaoKernelUniform);
+    m_parameterBlock->set(Param_KernelSize, kernelLength);
 }
 
 void SSAONode::removeAttachedCameras()
@@ -88,115 +252,245 @@ void SSAONode::createFirstPassCamera()
 
     // -------------------------------------------------------------------------
 
-    // Create texture for deferred rendering (1st pass) - G-Buffer: Color
-    colorTex = new osg::Texture2D();
-    colorTex->setTextureSize(m_width, m_height);
-    colorTex->setInternalFormat(GL_RGB);
-
-    // Create texture for deferred rendering (1st pass) - G-Buffer: Depth
-    linearDepthTex = new osg::Texture2D();
-    linearDepthTex->setTextureSize(m_width, m_height);
-    linearDepthTex->setInternalFormat(GL_DEPTH_COMPONENT24);
-    linearDepthTex->setSourceFormat(GL_DEPTH_COMPONENT);
-    linearDepthTex->setSourceType(GL_FLOAT);
-
-    // Create texture for deferred rendering (1st pass) - G-Buffer: Normal
-    normalTex = new osg::Texture2D;
-    normalTex->setTextureSize(m_width, m_height);
-    normalTex->setInternalFormat(GL_RGB);
-
-    // Create camera for rendering to texture (to G-buffer)
+    // Create camera for rendering to texture (to G-buffer).  Its color,
+    // depth and normal targets are leased by updateRenderTargets()
     rttCamera = createRTTCameraGBuffer(osg::Camera::DEPTH_BUFFER,
-                                       linearDepthTex.get(),
+                                       nullptr,
                                        osg::Camera::COLOR_BUFFER0,
-                                       colorTex.get(),
+                                       nullptr,
                                        osg::Camera::COLOR_BUFFER1,
-                                       normalTex.get(),
+                                       nullptr,
                                        false);
 
-    // Load deferred phong shader for rendering scene into G-buffer
-    // (color + view space normal + linear depth)
-    osg::StateSet* phongState = rttCamera->getOrCreateStateSet();
+    // The deferred phong shader for rendering scene into G-buffer
+    // (color + view space normal + linear depth) is set by
+    // updateShaderVariants(), it depends on the normal encoding
 
-    osg::Program* phongProgramObject = new osg::Program;
-    osg::Shader* phongVertexObject = new osg::Shader(osg::Shader::VERTEX);
-    osg::Shader* phongFragmentObject = new osg::Shader(osg::Shader::FRAGMENT);
-    phongProgramObject->addShader(phongFragmentObject);
-    phongProgramObject->addShader(phongVertexObject);
+    rttCamera->setRenderOrder(osg::Camera::PRE_RENDER, GBufferOrder);
+    this->addChild(rttCamera.get());
 
-    setShaderStringFromResource(phongVertexObject, ":/shaders/phong.vp");
-    setShaderStringFromResource(phongFragmentObject, ":/shaders/phong.fp");
+}
 
-    phongState->setAttributeAndModes(phongProgramObject,
-                                     osg::StateAttribute::ON);
+void SSAONode::createDepthPyramidCameras()
+{
+    // View space z with a mip chain.  Single channel float, so a tap costs
+    // a quarter of the bandwidth of the depth/normal G-buffer and far taps
+    // read from small levels.  Leased by updateRenderTargets()
+    linearizeCamera = createRTTCamera(osg::Camera::COLOR_BUFFER,
+                                      nullptr,
+                                      true);
+
+    osg::StateSet* stateset = linearizeCamera->getOrCreateStateSet();
+    stateset->setAttributeAndModes(getOrCreateProgram(":/shaders/ssao.vp",
+                                                      ":/shaders/linearize.fp"));
+    stateset->addUniform(new osg::Uniform("linearDepthTexture", 0));
+
+    linearizeCamera->setRenderOrder(osg::Camera::PRE_RENDER, LinearizeOrder);
+    this->addChild(linearizeCamera.get());
+
+    // Each level is built from the one above it by its own camera
+    osg::Program* mipProgram = getOrCreateProgram(":/shaders/ssao.vp",
+                                                  ":/shaders/depthmip.fp");
+    depthMipCameras.clear();
+    depthMipSizeUniforms.clear();
+    for (int level = 1; level <= DepthMipLevels; level++) {
+        osg::Camera* camera = createRTTCamera(osg::Camera::COLOR_BUFFER,
+                                              nullptr,
+                                              true);
+
+        stateset = camera->getOrCreateStateSet();
+        stateset->setAttributeAndModes(mipProgram);
+        stateset->addUniform(new osg::Uniform("linearZTexture", 0));
+        camera->setPreDrawCallback(new MipRangeCallback(this, level - 1, level - 1));
+        camera->setPostDrawCallback(new MipRangeCallback(this, 0, DepthMipLevels));
+
+        osg::Uniform* sizeUniform = new osg::Uniform("previousMIPSize", osg::Vec2f(1.0f, 1.0f));
+        stateset->addUniform(sizeUniform);
+        depthMipSizeUniforms.push_back(sizeUniform);
+
+        camera->setRenderOrder(osg::Camera::PRE_RENDER, DepthMipOrder + level - 1);
+        this->addChild(camera);
+        depthMipCameras.push_back(camera);
+    }
+}
 
-    rttCamera->setRenderOrder(osg::Camera::PRE_RENDER, 0);
-    this->addChild(rttCamera.get());
+void SSAONode::createHiZCamera()
+{
+    // The farthest distance per OcclusionCuller::HiZTile square of the
+    // pyramid base, read back by the culler after it is drawn
+    hizCamera = createRTTCamera(osg::Camera::COLOR_BUFFER,
+                                nullptr,
+                                true);
+
+    osg::StateSet* stateset = hizCamera->getOrCreateStateSet();
+    stateset->setAttributeAndModes(getOrCreateProgram(":/shaders/ssao.vp",
+                                                      ":/shaders/hiz.fp"));
+    stateset->addUniform(new osg::Uniform("linearZTexture", 0));
+    hizCamera->setPostDrawCallback(m_culler->readbackCallback());
+
+    hizCamera->setRenderOrder(osg::Camera::PRE_RENDER, HiZOrder);
+    this->addChild(hizCamera.get());
+
+    // The query boxes only need a position, the G-buffer shading would be
+    // wasted on them
+    m_culler->queryState()->setAttributeAndModes(
+                getOrCreateProgram(":/shaders/ssao.vp", ":/shaders/query.fp"));
+}
 
+void SSAONode::createDownsampleCamera()
+{
+    // Renders normal and view space z at occlusion resolution into
+    // targets leased by updateRenderTargets()
+    downsampleCamera = createRTTCameraGBuffer(osg::Camera::DEPTH_BUFFER,
+                                              nullptr,
+                                              osg::Camera::COLOR_BUFFER0,
+                                              nullptr,
+                                              osg::Camera::COLOR_BUFFER1,
+                                              nullptr,
+                                              true);
+
+    // Load downsample shader.  It picks one G-buffer sample per low
+    // resolution texel
+    osg::StateSet* stateset = downsampleCamera->getOrCreateStateSet();
+    stateset->setAttributeAndModes(getOrCreateProgram(":/shaders/ssao.vp",
+                                                      ":/shaders/downsample.fp"));
+
+    stateset->addUniform(new osg::Uniform("linearDepthTexture", 0));
+    stateset->addUniform(new osg::Uniform("normalTexture", 1));
+    stateset->addUniform(new osg::Uniform("linearZTexture", 2));
+
+    downsampleCamera->setRenderOrder(osg::Camera::PRE_RENDER, DownsampleOrder);
+    this->addChild(downsampleCamera.get());
 }
 
 void SSAONode::createSecondPassCamera(int kernelLength)
 {
-    // Create texture for deferred rendering (2nd pass - blur)
-    secondPassTex = new osg::Texture2D;
-    secondPassTex->setTextureSize(m_width, m_height);
-    secondPassTex->setInternalFormat(GL_RGBA);
-
-    // Create ssao camera for deffered rendering (first pass)
+    // Create ssao camera for deffered rendering (first pass).  It renders
+    // into secondPassTex, or the atlas when deinterleaved.
     ssaoCamera = createRTTCamera(osg::Camera::COLOR_BUFFER,
-                                 secondPassTex.get(),
+                                 nullptr,
                                  true);
 
-    // Load ssao shader
-    osg::ref_ptr<osg::Program> ssaoProgram = new osg::Program;
-    osg::Shader* ssaoVertexObject = new osg::Shader(osg::Shader::VERTEX);
-    osg::Shader* ssaoFragmentObject = new osg::Shader(osg::Shader::FRAGMENT);
-    ssaoProgram->addShader(ssaoFragmentObject);
-    ssaoProgram->addShader(ssaoVertexObject);
-    setShaderStringFromResource(ssaoVertexObject, ":/shaders/ssao.vp");
-    setShaderStringFromResource(ssaoFragmentObject, ":/shaders/ssao.fp");
-
     osg::StateSet* stateset = ssaoCamera->getOrCreateStateSet();
 
-    stateset->setTextureAttributeAndModes(0, colorTex.get());
-    stateset->setTextureAttributeAndModes(1, createTexture2D(m_noiseSize,
-                                                             m_noiseSize,
-                                                             m_noiseData));
-    stateset->setTextureAttributeAndModes(2, linearDepthTex.get());
-    stateset->setTextureAttributeAndModes(3, normalTex.get());
-
-    stateset->setAttributeAndModes(ssaoProgram.get());
-    stateset->addUniform(new osg::Uniform("colorTexture", 0));
+    // Depth and normal (units 2 and 3) are bound by bindRenderTargets(),
+    // the program for the current algorithm by updateShaderVariants(),
+    // the noise (unit 1) by updateNoiseTexture()
     stateset->addUniform(new osg::Uniform("noiseTexture", 1));
-    stateset->addUniform(new osg::Uniform("linearDepthTexture", 2));
+    stateset->addUniform(new osg::Uniform("linearZTexture", 2));
     stateset->addUniform(new osg::Uniform("normalTexture", 3));
 
-    radiusUniform = new osg::Uniform("ssaoRadius", m_ssaoRadius);
-    stateset->addUniform(radiusUniform);
+    setKernel(kernelLength);
 
-    powerUniform = new osg::Uniform("ssaoPower", m_ssaoPower);
-    stateset->addUniform(powerUniform);
+    ssaoCamera->setRenderOrder(osg::Camera::PRE_RENDER, SSAOOrder);
+    this->addChild(ssaoCamera.get());
 
+}
 
-    stateset->addUniform(new osg::Uniform("kernelSize", kernelLength));
+void SSAONode::createDeinterleaveCameras()
+{
+    // Atlases of m_noiseSize^2 layers, only leased while deinterleaved
+    std::stringstream defines;
+    defines << "#define DEINTERLEAVE " << m_noiseSize << "\n";
+
+    deinterleaveCamera = createRTTCameraGBuffer(osg::Camera::COLOR_BUFFER0,
+                                                nullptr,
+                                                osg::Camera::COLOR_BUFFER1,
+                                                nullptr,
+                                                osg::Camera::COLOR_BUFFER2,
+                                                nullptr,
+                                                true);
+    deinterleaveCamera->setImplicitBufferAttachmentMask(0, 0);
+
+    osg::StateSet* stateset = deinterleaveCamera->getOrCreateStateSet();
+    stateset->setAttributeAndModes(getOrCreateProgram(":/shaders/ssao.vp",
+                                                      ":/shaders/deinterleave.fp",
+                                                      defines.str()));
+    stateset->addUniform(new osg::Uniform("linearZTexture", 0));
+    stateset->addUniform(new osg::Uniform("normalTexture", 1));
+
+    deinterleaveCamera->setRenderOrder(osg::Camera::PRE_RENDER, DeinterleaveOrder);
+    this->addChild(deinterleaveCamera.get());
+
+    reinterleaveCamera = createRTTCamera(osg::Camera::COLOR_BUFFER,
+                                         nullptr,
+                                         true);
+
+    stateset = reinterleaveCamera->getOrCreateStateSet();
+    stateset->setAttributeAndModes(getOrCreateProgram(":/shaders/ssao.vp",
+                                                      ":/shaders/reinterleave.fp",
+                                                      defines.str()));
+    stateset->addUniform(new osg::Uniform("aoTexture", 0));
+
+    reinterleaveCamera->setRenderOrder(osg::Camera::PRE_RENDER, ReinterleaveOrder);
+    this->addChild(reinterleaveCamera.get());
+}
+
+void SSAONode::createTemporalCameras()
+{
+    // Each camera blends this frame's occlusion into one history target
+    // and reads the other, updateViewMatrix() alternates between them.
+    // Half floats, the targets also carry view z for the rejection test.
+    // The history has to survive until the next frame, so unlike the
+    // other targets it is never shared through the pool.
+
+    for (int i = 0; i < 2; i++) {
+        historyTex[i] = new osg::Texture2D;
+        historyTex[i]->setInternalFormat(GL_RGBA16F_ARB);
+        historyTex[i]->setSourceFormat(GL_RGBA);
+        historyTex[i]->setSourceType(GL_FLOAT);
+    }
 
-    noiseTextureRcpUniform =
-            new osg::Uniform("noiseTextureRcp",
-                             osg::Vec2f(float(m_width) / float(m_noiseSize),
-                                        (float(m_height)/float(m_noiseSize))));
-    stateset->addUniform(noiseTextureRcpUniform);
+    for (int i = 0; i < 2; i++) {
+        temporalCameras[i] = createRTTCamera(osg::Camera::COLOR_BUFFER,
+                                             historyTex[i].get(),
+                                             true);
 
-    projMatUniform = new osg::Uniform(osg::Uniform::FLOAT_MAT4, "projMatrix", 1);
-    stateset->addUniform(projMatUniform);
+        osg::StateSet* stateset = temporalCameras[i]->getOrCreateStateSet();
+        stateset->setTextureAttributeAndModes(1, historyTex[1 - i].get());
+        stateset->setAttributeAndModes(getOrCreateProgram(":/shaders/ssao.vp",
+                                                          ":/shaders/temporal.fp",
+                                                          temporalDefines()));
 
-    invProjMatrixUniform = new osg::Uniform(osg::Uniform::FLOAT_MAT4, "invProjMatrix", 1);
-    stateset->addUniform(invProjMatrixUniform);
+        stateset->addUniform(new osg::Uniform("aoTexture", 0));
+        stateset->addUniform(new osg::Uniform("historyTexture", 1));
+        stateset->addUniform(new osg::Uniform("linearZTexture", 2));
 
-    addKernelUniformToStateSet(stateset, kernelLength);
+        temporalCameras[i]->setRenderOrder(osg::Camera::PRE_RENDER, TemporalOrder);
+        this->addChild(temporalCameras[i].get());
+    }
+}
 
-    ssaoCamera->setRenderOrder(osg::Camera::PRE_RENDER, 1);
-    this->addChild(ssaoCamera.get());
+osg::Camera* SSAONode::createBlurPassCamera(const osg::Vec2f& direction)
+{
+    osg::Camera* camera = createRTTCamera(osg::Camera::COLOR_BUFFER,
+                                          nullptr,
+                                          true);
+
+    // Input, output, depth and normal are bound by bindRenderTargets(),
+    // the program variant by updateShaderVariants().  The horizontal
+    // pass input is rerouted by updateCameraMasks() in temporal mode.
+    osg::StateSet* stateset = camera->getOrCreateStateSet();
+    stateset->addUniform(new osg::Uniform("aoTexture", 0));
+    stateset->addUniform(new osg::Uniform("aoZTexture", 1));
+    stateset->addUniform(new osg::Uniform("aoNormalTexture", 2));
+    stateset->addUniform(new osg::Uniform("blurDirection", direction));
+
+    return camera;
+}
 
+void SSAONode::createBlurCameras()
+{
+    // The blur is separable: a horizontal pass into blurTempTex followed by
+    // a vertical pass back into secondPassTex.  Both run at occlusion
+    // resolution, so the cost per pixel is 2 * (2 * radius + 1) taps
+    blurHorizontalCamera = createBlurPassCamera(osg::Vec2f(1.0f, 0.0f));
+    blurHorizontalCamera->setRenderOrder(osg::Camera::PRE_RENDER, BlurHorizontalOrder);
+    this->addChild(blurHorizontalCamera.get());
+
+    blurVerticalCamera = createBlurPassCamera(osg::Vec2f(0.0f, 1.0f));
+    blurVerticalCamera->setRenderOrder(osg::Camera::PRE_RENDER, BlurVerticalOrder);
+    this->addChild(blurVerticalCamera.get());
 }
 
 void SSAONode::createThirdPassCamera()
@@ -205,41 +499,14 @@ void SSAONode::createThirdPassCamera()
     blurCamera = createHUDCamera(0.0, 1.0, 0.0, 1.0);
     blurCamera->addChild(createScreenQuad(1.0f, 1.0f));
 
-    // Load blur shader
-    osg::ref_ptr<osg::Program> blurProgram = new osg::Program;
-    osg::Shader* blurVertexObject = new osg::Shader(osg::Shader::VERTEX);
-    osg::Shader* blurFragmentObject = new osg::Shader(osg::Shader::FRAGMENT);
-    blurProgram->addShader(blurFragmentObject);
-    blurProgram->addShader(blurVertexObject);
-    setShaderStringFromResource(blurVertexObject, ":/shaders/blur.vp");
-    setShaderStringFromResource(blurFragmentObject, ":/shaders/blur.fp");
-
-    // Set blur shader to blur camera
+    // The occlusion (unit 0) is routed by updateCameraMasks(), the
+    // G-buffer (units 1 to 3) bound by bindRenderTargets() and the
+    // program variant set by updateShaderVariants()
     osg::StateSet* statesetBlur = blurCamera->getOrCreateStateSet();
-    statesetBlur->setTextureAttributeAndModes(0, secondPassTex.get()); // Set screen texture from first pass to texture channel 0
-    statesetBlur->setTextureAttributeAndModes(1, linearDepthTex.get());
-    statesetBlur->setAttributeAndModes(blurProgram.get());
-
     statesetBlur->addUniform(new osg::Uniform("sceneTex", 0));
-    statesetBlur->addUniform(new osg::Uniform("linearDepthTexture", 1));
-    statesetBlur->addUniform(new osg::Uniform("uBlurSize", int(m_blurSize)));
-
-    haloRemovalUniform = new osg::Uniform("haloRemoval", m_haloRemovalEnabled ? 1 : 0);
-    haloTresholdUniform = new osg::Uniform("haloTreshold", m_haloTreshold);
-    blurAOUniform = new osg::Uniform("blurAOEnable", m_blurAOEnabled ? 1 : 0);
-
-    statesetBlur->addUniform(haloRemovalUniform);
-    statesetBlur->addUniform(haloTresholdUniform);
-    statesetBlur->addUniform(blurAOUniform);
-
-    blurProjMatrixUniform = new osg::Uniform(osg::Uniform::FLOAT_MAT4, "projMatrix", 1);
-    statesetBlur->addUniform(blurProjMatrixUniform);
-
-    sceneSizeUniform = new osg::Uniform("sceneSize", osg::Vec2f(m_width, m_height));
-    statesetBlur->addUniform(sceneSizeUniform);
-
-    displayTypeUniform = new osg::Uniform("displayType", displayType);
-    statesetBlur->addUniform(displayTypeUniform);
+    statesetBlur->addUniform(new osg::Uniform("linearZTexture", 1));
+    statesetBlur->addUniform(new osg::Uniform("colorTexture", 2));
+    statesetBlur->addUniform(new osg::Uniform("aoZTexture", 3));
 
     // Ensure rendering order
     blurCamera->setRenderOrder(osg::Camera::POST_RENDER, 0);
@@ -255,24 +522,72 @@ void SSAONode::Initialize()
     {
         long nsquared = m_noiseSize * m_noiseSize;
         m_noiseData = new osg::Vec3f[nsquared];
-        generateNoise(m_noiseData, nsquared);
+        updateNoise();
     }
 
     removeAttachedCameras();
 
+    // One buffer per block serves every pass.  The sizes are filled in by
+    // updateRenderTargets(), the camera and frame sequence by
+    // updateProjectionMatrix() and updateViewMatrix().
+    m_parameterBlock = new UniformBlock("SSAOParameters", 0, ParameterBlockSize);
+    m_frameBlock = new UniformBlock("SSAOFrame", 1, FrameBlockSize);
+    m_parameterBlock->bind(this->getOrCreateStateSet());
+    m_frameBlock->bind(this->getOrCreateStateSet());
+    m_frameBlock->set(Frame_Rotation, osg::Vec2f(1.0f, 0.0f));
+    m_allocatedWidth = 0;
+    m_allocatedHeight = 0;
+    m_instancedState = new osg::StateSet;
+
     createFirstPassCamera();
 
+    createDepthPyramidCameras();
+
+    createHiZCamera();
+
+    createDownsampleCamera();
+
     createSecondPassCamera(kernelLength);
 
+    createDeinterleaveCameras();
+
+    createTemporalCameras();
+
+    createBlurCameras();
+
     createThirdPassCamera();
-	// ------------------------------------------------------------------------------------------------------------------------
 
-	// ------------------------------------------------------------------------------------------------------------------------
-		
+    // Formats the context supports are only known once it has drawn
+    blurCamera->setPreDrawCallback(new FormatDetectCallback(this));
+
+    timePass(rttCamera, rttCamera, Pass_GBuffer);
+    timePass(linearizeCamera, linearizeCamera, Pass_Linearize);
+    timePass(hizCamera, hizCamera, Pass_HiZ);
+    timePass(depthMipCameras.front(), depthMipCameras.back(), Pass_DepthPyramid);
+    timePass(downsampleCamera, downsampleCamera, Pass_Downsample);
+    timePass(deinterleaveCamera, deinterleaveCamera, Pass_Deinterleave);
+    timePass(ssaoCamera, ssaoCamera, Pass_SSAO);
+    timePass(reinterleaveCamera, reinterleaveCamera, Pass_Reinterleave);
+    for (int i = 0; i < 2; i++)
+        timePass(temporalCameras[i], temporalCameras[i], Pass_Temporal);
+    timePass(blurHorizontalCamera, blurVerticalCamera, Pass_Blur);
+    timePass(blurCamera, blurCamera, Pass_Composite);
+
+    updateOcclusionCulling();
+    updateRenderTargets();
+
 	// Set user definable uniforms
 	setUniforms();
+}
+
+void SSAONode::setHaloRemovalEnabled(bool tf) {
+    this->m_haloRemovalEnabled = tf;
+    setUniforms();
+}
 
-	// Create ssao group
+void SSAONode::setAOBlurEnabled(bool tf) {
+    this->m_blurAOEnabled = tf;
+    setUniforms();
 }
 
 bool SSAONode::IsHaloRemovalEnabled() {
@@ -285,6 +600,7 @@ bool SSAONode::IsAOBlurEnabled() {
 
 void SSAONode::SetHaloTreshold(float treshold) {
     this->m_haloTreshold = treshold;
+    setUniforms();
 }
 
 float SSAONode::GetHaloTreshold() {
@@ -294,6 +610,7 @@ float SSAONode::GetHaloTreshold() {
 void SSAONode::addNode(osg::Node* node)
 {
     rttCamera->addChild(node);
+    DirtyScene();
 }
 
 void SSAONode::Resize(int width, int height)
@@ -303,25 +620,632 @@ void SSAONode::Resize(int width, int height)
     m_width = width;
     m_height = height;
 
-    // Remember nodes attached to ssao
-    unsigned int nodeNum = rttCamera->getNumChildren();
+    // Cameras, programs and uniforms stay, only the attachments may change
+    updateRenderTargets();
+}
+
+void SSAONode::releaseGLObjects(osg::State* state) const
+{
+    osg::Group::releaseGLObjects(state);
+    m_passTimer->releaseGLObjects(state);
+    m_culler->releaseGLObjects(state);
+}
+
+void SSAONode::SetAOResolution(SSAONode::AOResolution resolution)
+{
+    if (resolution == m_aoResolution) return;
+
+    m_aoResolution = resolution;
+    updateRenderTargets();
+}
+
+SSAONode::AOResolution SSAONode::GetAOResolution() {
+    return this->m_aoResolution;
+}
+
+void SSAONode::SetAOAlgorithm(SSAONode::AOAlgorithm algorithm)
+{
+    if (algorithm == m_aoAlgorithm) return;
+
+    m_aoAlgorithm = algorithm;
+    m_stillFrames = 0;
+    updateNoise();
+    updateShaderVariants();
+}
+
+SSAONode::AOAlgorithm SSAONode::GetAOAlgorithm() {
+    return this->m_aoAlgorithm;
+}
 
-    std::vector<osg::Node*> nodes;
+void SSAONode::SetTemporalEnabled(bool tf)
+{
+    if (tf == m_temporalEnabled) return;
 
-    for (unsigned int i = 0; i < nodeNum; ++i){
-        nodes.push_back(rttCamera->getChild(i));
+    m_temporalEnabled = tf;
+    m_historyFrames = 0;
+    setUniforms();
+}
+
+bool SSAONode::IsTemporalEnabled() {
+    return this->m_temporalEnabled;
+}
+
+void SSAONode::SetDeinterleavedEnabled(bool tf)
+{
+    if (tf == m_deinterleaved) return;
+
+    m_deinterleaved = tf;
+    updateRenderTargets();
+}
+
+bool SSAONode::IsDeinterleavedEnabled() {
+    return this->m_deinterleaved;
+}
+
+void SSAONode::SetBlueNoiseEnabled(bool tf)
+{
+    if (tf == m_blueNoiseEnabled) return;
+
+    m_blueNoiseEnabled = tf;
+    m_stillFrames = 0;
+    updateShaderVariants();
+}
+
+bool SSAONode::IsBlueNoiseEnabled() {
+    return this->m_blueNoiseEnabled;
+}
+
+void SSAONode::SetNoiseOffsetEnabled(bool tf)
+{
+    if (tf == m_noiseOffsetEnabled) return;
+
+    m_noiseOffsetEnabled = tf;
+    m_noiseOffset.set(0, 0);
+    m_frameBlock->set(Frame_NoiseOffset, m_noiseOffset);
+    m_stillFrames = 0;
+}
+
+bool SSAONode::IsNoiseOffsetEnabled() {
+    return this->m_noiseOffsetEnabled;
+}
+
+void SSAONode::SetOcclusionCullingEnabled(bool tf)
+{
+    if (tf == m_occlusionCulling) return;
+
+    m_occlusionCulling = tf;
+    m_stillFrames = 0;
+    updateOcclusionCulling();
+    updateRenderTargets();
+}
+
+bool SSAONode::IsOcclusionCullingEnabled() {
+    return this->m_occlusionCulling;
+}
+
+void SSAONode::GetOcclusionStatistics(unsigned int& tested, unsigned int& occluded) const
+{
+    tested = occluded = 0;
+    if (m_occlusionCulling)
+        m_culler->statistics(tested, occluded);
+}
+
+void SSAONode::updateOcclusionCulling()
+{
+    // The G-buffer camera starts the culler's frames and collects the
+    // query results before it draws
+    rttCamera->setCullCallback(m_occlusionCulling ? m_culler->cameraCullCallback() : nullptr);
+    rttCamera->setPreDrawCallback(m_occlusionCulling ? m_culler->collectCallback() : nullptr);
+    if (m_occlusionCulling)
+        attachCuller();
+    else
+        m_culler->reset();
+}
+
+void SSAONode::attachCuller()
+{
+    for (unsigned int i = 0; i < rttCamera->getNumChildren(); i++)
+        OcclusionCuller::attach(rttCamera->getChild(i));
+}
+
+void SSAONode::SetRenderTargetPool(RenderTargetPool* pool)
+{
+    if (pool == m_renderTargets.get() || !pool) return;
+
+    m_renderTargets->release(this);
+    m_renderTargets->trim();
+    m_renderTargets = pool;
+    updateRenderTargets();
+}
+
+RenderTargetPool* SSAONode::GetRenderTargetPool() const
+{
+    return m_renderTargets.get();
+}
+
+void SSAONode::DirtyScene()
+{
+    m_sceneRevision++;
+}
+
+bool SSAONode::IsTemporalConverging() const
+{
+    bool aoNeeded = m_allocatedWidth > 0 && displayType != SSAO_ColorOnly;
+    return m_temporalEnabled && aoNeeded && m_stillFrames < TemporalFrames;
+}
+
+void SSAONode::updateNoise()
+{
+    // The kernel wants random tangents, the horizon march a rotation of
+    // its directions and a jitter of the first step
+    long nsquared = m_noiseSize * m_noiseSize;
+    m_randomState = 1424447641; // same noise in every instance
+    if (m_aoAlgorithm == AO_HorizonBased)
+        generateRotationNoise(m_noiseData, nsquared);
+    else
+        generateNoise(m_noiseData, nsquared);
+}
+
+void SSAONode::updateNoiseTexture()
+{
+    // The noise only depends on the algorithm and its size, so every node
+    // uses the same texture
+    std::stringstream key;
+    key << (m_aoAlgorithm == AO_HorizonBased ? "rotation" : "tangent") << m_noiseSize;
+    osg::Texture2D* noise = UsesBlueNoise() ?
+                m_resources->blueNoiseTexture() :
+                m_resources->noiseTexture(key.str(), m_noiseSize, m_noiseData);
+    ssaoCamera->getOrCreateStateSet()->setTextureAttributeAndModes(1, noise);
+}
+
+int SSAONode::bucketedSize(int requested, int allocated)
+{
+    // Grow to the next bucket when the request does not fit, shrink only
+    // when more than a whole bucket would be wasted.  A window edge being
+    // dragged back and forth therefore does not reallocate on every event.
+    static const int bucket = 128;
+    int wanted = ((requested + bucket - 1) / bucket) * bucket;
+
+    if (allocated >= requested && allocated - wanted <= bucket)
+        return allocated;
+
+    return wanted;
+}
+
+static bool resizeTexture(osg::Texture2D* tex, int width, int height)
+{
+    if (tex->getTextureWidth() == width && tex->getTextureHeight() == height)
+        return false;
+
+    tex->setTextureSize(width, height);
+    tex->dirtyTextureObject();
+    return true;
+}
+
+// Points a camera buffer at a render target.  The FBO is only rebuilt
+// when the target is a different one.
+static void attachTarget(osg::Camera* camera, osg::Camera::BufferComponent buffer,
+                         osg::Texture2D* tex, unsigned int level = 0)
+{
+    osg::Camera::BufferAttachmentMap& attachments = camera->getBufferAttachmentMap();
+    auto attached = attachments.find(buffer);
+    if (attached != attachments.end() && attached->second._texture.get() == tex &&
+            attached->second._level == level)
+        return;
+    if (attached == attachments.end() && !tex)
+        return;
+
+    camera->detach(buffer);
+    if (tex)
+        camera->attach(buffer, tex, level);
+    camera->dirtyAttachmentMap();
+}
+
+// Unbinds the unit when there is no target, a stale binding would keep a
+// released target alive
+static void bindTexture(osg::Camera* camera, unsigned int unit, osg::Texture2D* tex)
+{
+    osg::StateSet* stateset = camera->getOrCreateStateSet();
+    if (tex)
+        stateset->setTextureAttributeAndModes(unit, tex);
+    else
+        stateset->removeTextureAttribute(unit, osg::StateAttribute::TEXTURE);
+}
+
+bool SSAONode::compactFormats() const
+{
+    return m_gbufferLayout == GBuffer_Compact && m_textureRGSupported;
+}
+
+void SSAONode::SetGBufferLayout(SSAONode::GBufferLayout layout)
+{
+    if (layout == m_gbufferLayout) return;
+
+    m_gbufferLayout = layout;
+    updateRenderTargets();
+}
+
+SSAONode::GBufferLayout SSAONode::GetGBufferLayout() {
+    return this->m_gbufferLayout;
+}
+
+bool SSAONode::NeedsRedraw() const
+{
+    return m_formatsPending || IsTemporalConverging() ||
+            (m_occlusionCulling && m_culler->isSettling());
+}
+
+void SSAONode::timePass(osg::Camera* first, osg::Camera* last, RenderPass pass)
+{
+    first->setInitialDrawCallback(m_passTimer->beginCallback(pass));
+    last->setFinalDrawCallback(m_passTimer->endCallback(pass));
+}
+
+bool SSAONode::GetPassTime(RenderPass pass, double& lastMs, double& meanMs,
+                           double& maxMs) const
+{
+    return m_passTimer->getTime(pass, lastMs, meanMs, maxMs);
+}
+
+unsigned int SSAONode::GetPassTimeSamples() const
+{
+    return m_passTimer->samplesTaken();
+}
+
+const char* SSAONode::PassName(RenderPass pass)
+{
+    static const char* names[PassCount] = {
+        "G-buffer", "Linearize", "HiZ", "Depth pyramid", "Downsample",
+        "Deinterleave", "SSAO", "Reinterleave", "Temporal", "Blur",
+        "Composite"
+    };
+    return pass >= 0 && pass < PassCount ? names[pass] : "";
+}
+
+void SSAONode::updateRenderTargets()
+{
+    // Nothing to allocate until the window has a real size
+    if (m_width <= 0 || m_height <= 0) {
+        updateCameraMasks();
+        return;
     }
 
-    // Initialize again
-    Initialize();
+    m_allocatedWidth = bucketedSize(m_width, m_allocatedWidth);
+    m_allocatedHeight = bucketedSize(m_height, m_allocatedHeight);
+
+    // Buckets are a multiple of every AOResolution, so these are exact
+    int aoAllocatedWidth = m_allocatedWidth / int(m_aoResolution);
+    int aoAllocatedHeight = m_allocatedHeight / int(m_aoResolution);
+
+    // Compact: octahedral normals in RG16F (RG8 without half floats) and
+    // occlusion in R8, a third of the classic RGB8 / RGBA8 footprint
+    bool compact = compactFormats();
+    GLint normalFormat = GL_RGB;
+    GLenum normalSource = GL_RGB;
+    GLenum normalType = GL_UNSIGNED_BYTE;
+    if (compact) {
+        normalFormat = m_halfFloatSupported ? GL_RG16F : GL_RG8;
+        normalSource = GL_RG;
+        normalType = m_halfFloatSupported ? GL_FLOAT : GL_UNSIGNED_BYTE;
+    }
+    GLint aoFormat = compact ? GL_R8 : GL_RGBA;
+    GLenum aoSource = compact ? GL_RED : GL_RGBA;
+
+    // Lease everything again.  Targets whose size and format did not
+    // change come back as they were, the others are replaced, and targets
+    // of switched off passes are returned to the pool.
+    bool lowRes = m_aoResolution != AO_FullRes;
+    int layers = m_noiseSize;
+    int atlasWidth = ((aoAllocatedWidth + layers - 1) / layers) * layers;
+    int atlasHeight = ((aoAllocatedHeight + layers - 1) / layers) * layers;
+    RenderTargetPool* pool = m_renderTargets.get();
+    pool->release(this);
+
+    colorTex = pool->lease(this, m_allocatedWidth, m_allocatedHeight,
+                           GL_RGB, GL_RGB, GL_UNSIGNED_BYTE);
+    linearDepthTex = pool->lease(this, m_allocatedWidth, m_allocatedHeight,
+                                 GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    normalTex = pool->lease(this, m_allocatedWidth, m_allocatedHeight,
+                            normalFormat, normalSource, normalType);
+    linearZTex = pool->lease(this, m_allocatedWidth, m_allocatedHeight,
+                             GL_R32F, GL_RED, GL_FLOAT, DepthMipLevels);
+    // Buckets are a multiple of the tile, so is this
+    hizTex = m_occlusionCulling ? pool->lease(this,
+                                              m_allocatedWidth / OcclusionCuller::HiZTile,
+                                              m_allocatedHeight / OcclusionCuller::HiZTile,
+                                              GL_R32F, GL_RED, GL_FLOAT) : nullptr;
+
+    secondPassTex = pool->lease(this, aoAllocatedWidth, aoAllocatedHeight,
+                                aoFormat, aoSource, GL_UNSIGNED_BYTE);
+    blurTempTex = pool->lease(this, aoAllocatedWidth, aoAllocatedHeight,
+                              aoFormat, aoSource, GL_UNSIGNED_BYTE);
+    lowResNormalTex = lowRes ? pool->lease(this, aoAllocatedWidth, aoAllocatedHeight,
+                                           normalFormat, normalSource,
+                                           normalType) : nullptr;
+    lowResZTex = lowRes ? pool->lease(this, aoAllocatedWidth, aoAllocatedHeight,
+                                      GL_R32F, GL_RED, GL_FLOAT) : nullptr;
+
+    zAtlasTex = m_deinterleaved ? pool->lease(this, atlasWidth, atlasHeight,
+                                              GL_R32F, GL_RED, GL_FLOAT) : nullptr;
+    normalAtlasTex = m_deinterleaved ? pool->lease(this, atlasWidth, atlasHeight,
+                                                   normalFormat, normalSource,
+                                                   normalType) : nullptr;
+    aoAtlasTex = m_deinterleaved ? pool->lease(this, atlasWidth, atlasHeight,
+                                               aoFormat, aoSource,
+                                               GL_UNSIGNED_BYTE) : nullptr;
+    pool->trim();
+
+    bool historyResized = false;
+    for (auto& tex : historyTex)
+        historyResized |= resizeTexture(tex.get(), aoAllocatedWidth, aoAllocatedHeight);
+
+    // Deinterleaved layers, padded to whole tiles
+    int tileWidth = (aoWidth() + layers - 1) / layers;
+    int tileHeight = (aoHeight() + layers - 1) / layers;
+
+    // Reallocated history holds garbage, the viewport moved within it anyway
+    m_historyFrames = 0;
+    m_stillFrames = 0;
+
+    // Viewports follow the window, FBOs are only rebuilt for new targets
+    rttCamera->setViewport(0, 0, m_width, m_height);
+    linearizeCamera->setViewport(0, 0, m_width, m_height);
+    hizCamera->setViewport(0, 0,
+                           (m_width + OcclusionCuller::HiZTile - 1) / OcclusionCuller::HiZTile,
+                           (m_height + OcclusionCuller::HiZTile - 1) / OcclusionCuller::HiZTile);
+
+    for (int level = 1; level <= DepthMipLevels; level++) {
+        osg::Camera* camera = depthMipCameras[level - 1].get();
+        camera->setViewport(0, 0, std::max(1, m_width >> level),
+                            std::max(1, m_height >> level));
+
+        depthMipSizeUniforms[level - 1]->set(
+                    osg::Vec2f(std::max(1, m_width >> (level - 1)),
+                               std::max(1, m_height >> (level - 1))));
+    }
+
+    osg::Camera* aoCameras[] = { downsampleCamera.get(),
+                                 reinterleaveCamera.get(),
+                                 temporalCameras[0].get(),
+                                 temporalCameras[1].get(),
+                                 blurHorizontalCamera.get(),
+                                 blurVerticalCamera.get() };
+    for (osg::Camera* camera : aoCameras)
+        camera->setViewport(0, 0, aoWidth(), aoHeight());
+    if (historyResized) {
+        temporalCameras[0]->dirtyAttachmentMap();
+        temporalCameras[1]->dirtyAttachmentMap();
+    }
+
+    deinterleaveCamera->setViewport(0, 0, tileWidth * layers, tileHeight * layers);
+
+    // The ssao pass renders the atlas when deinterleaved
+    if (m_deinterleaved)
+        ssaoCamera->setViewport(0, 0, tileWidth * layers, tileHeight * layers);
+    else
+        ssaoCamera->setViewport(0, 0, aoWidth(), aoHeight());
+
+    bindRenderTargets();
+
+    // Render targets are allocated in size buckets, so the viewport only
+    // covers part of each texture.  The shaders work in viewport relative
+    // coordinates and scale them by texScale and aoTexScale to address
+    // the textures.
+    m_parameterBlock->set(Param_SceneSize, osg::Vec2f(m_width, m_height));
+    m_parameterBlock->set(Param_TexScale, osg::Vec2f(float(m_width) / float(m_allocatedWidth),
+                                                     float(m_height) / float(m_allocatedHeight)));
+    m_parameterBlock->set(Param_AOSize, osg::Vec2f(aoWidth(), aoHeight()));
+    m_parameterBlock->set(Param_TileSize, osg::Vec2f(tileWidth, tileHeight));
+    m_parameterBlock->set(Param_AOTexScale, osg::Vec2f(float(aoWidth()) / float(aoAllocatedWidth),
+                                                       float(aoHeight()) / float(aoAllocatedHeight)));
+    m_parameterBlock->set(Param_DownsampleScale, int(m_aoResolution));
+    m_parameterBlock->set(Param_NoiseTextureRcp, osg::Vec2f(float(aoWidth()) / float(m_noiseSize),
+                                                            float(aoHeight()) / float(m_noiseSize)));
+
+    updateShaderVariants();
+    updateCameraMasks();
+}
+
+void SSAONode::bindRenderTargets()
+{
+    attachTarget(rttCamera.get(), osg::Camera::DEPTH_BUFFER, linearDepthTex.get());
+    attachTarget(rttCamera.get(), osg::Camera::COLOR_BUFFER0, colorTex.get());
+    attachTarget(rttCamera.get(), osg::Camera::COLOR_BUFFER1, normalTex.get());
+
+    attachTarget(linearizeCamera.get(), osg::Camera::COLOR_BUFFER, linearZTex.get());
+    bindTexture(linearizeCamera.get(), 0, linearDepthTex.get());
+    for (int level = 1; level <= DepthMipLevels; level++) {
+        osg::Camera* camera = depthMipCameras[level - 1].get();
+        attachTarget(camera, osg::Camera::COLOR_BUFFER, linearZTex.get(), level);
+        bindTexture(camera, 0, linearZTex.get());
+    }
+    attachTarget(hizCamera.get(), osg::Camera::COLOR_BUFFER, hizTex.get());
+    bindTexture(hizCamera.get(), 0, hizTex.valid() ? linearZTex.get() : nullptr);
+    m_culler->setHiZTexture(hizTex.get());
+
+    bool lowRes = m_aoResolution != AO_FullRes;
+    attachTarget(downsampleCamera.get(), osg::Camera::COLOR_BUFFER0, lowResNormalTex.get());
+    attachTarget(downsampleCamera.get(), osg::Camera::COLOR_BUFFER1, lowResZTex.get());
+    bindTexture(downsampleCamera.get(), 0, linearDepthTex.get());
+    bindTexture(downsampleCamera.get(), 1, normalTex.get());
+    bindTexture(downsampleCamera.get(), 2, lowRes ? linearZTex.get() : nullptr);
+
+    attachTarget(deinterleaveCamera.get(), osg::Camera::COLOR_BUFFER0, zAtlasTex.get());
+    attachTarget(deinterleaveCamera.get(), osg::Camera::COLOR_BUFFER1, normalAtlasTex.get());
+    bindTexture(deinterleaveCamera.get(), 0, linearZTex.get());
+    bindTexture(deinterleaveCamera.get(), 1, normalTex.get());
+
+    attachTarget(reinterleaveCamera.get(), osg::Camera::COLOR_BUFFER, secondPassTex.get());
+    bindTexture(reinterleaveCamera.get(), 0, aoAtlasTex.get());
+
+    // Feed the ssao pass, the blur and the upsample with normal and view
+    // space z at occlusion resolution
+    osg::Texture2D* aoNormalTex = lowRes ? lowResNormalTex.get() : normalTex.get();
+    osg::Texture2D* aoZTex = lowRes ? lowResZTex.get() : linearZTex.get();
+
+    attachTarget(ssaoCamera.get(), osg::Camera::COLOR_BUFFER,
+                 m_deinterleaved ? aoAtlasTex.get() : secondPassTex.get());
+    bindTexture(ssaoCamera.get(), 2, m_deinterleaved ? zAtlasTex.get() : linearZTex.get());
+    bindTexture(ssaoCamera.get(), 3, m_deinterleaved ? normalAtlasTex.get() : aoNormalTex);
+
+    for (int i = 0; i < 2; i++) {
+        bindTexture(temporalCameras[i].get(), 0, secondPassTex.get());
+        bindTexture(temporalCameras[i].get(), 2, linearZTex.get());
+    }
+
+    attachTarget(blurHorizontalCamera.get(), osg::Camera::COLOR_BUFFER, blurTempTex.get());
+    attachTarget(blurVerticalCamera.get(), osg::Camera::COLOR_BUFFER, secondPassTex.get());
+    bindTexture(blurVerticalCamera.get(), 0, blurTempTex.get());
+    osg::Camera* blurCameras[] = { blurHorizontalCamera.get(),
+                                   blurVerticalCamera.get() };
+    for (osg::Camera* camera : blurCameras) {
+        bindTexture(camera, 1, aoZTex);
+        bindTexture(camera, 2, aoNormalTex);
+    }
+
+    bindTexture(blurCamera.get(), 1, linearZTex.get());
+    bindTexture(blurCamera.get(), 2, colorTex.get());
+    bindTexture(blurCamera.get(), 3, aoZTex);
+}
+
+void SSAONode::updateCameraMasks()
+{
+    // Nothing is drawn until the render targets have been allocated.  The
+    // composite always runs, the rest only when their results are stale.
+    bool allocated = m_allocatedWidth > 0 && m_allocatedHeight > 0;
+    bool render = allocated && !m_skipAO;
+    rttCamera->setNodeMask(render ? ~0u : 0u);
+    blurCamera->setNodeMask(allocated ? ~0u : 0u);
+
+    // ColorOnly is a plain copy of the G-buffer color, no occlusion needed
+    bool aoNeeded = render && displayType != SSAO_ColorOnly;
+    bool lowRes = m_aoResolution != AO_FullRes;
+
+    // Occlusion culling needs the view space z as well, for the HiZ
+    bool culling = render && m_occlusionCulling;
+    linearizeCamera->setNodeMask(aoNeeded || culling ? ~0u : 0u);
+    hizCamera->setNodeMask(culling ? ~0u : 0u);
+
+    // The atlas has no mips, deinterleaving keeps taps cache friendly instead
+    for (auto& camera : depthMipCameras)
+        camera->setNodeMask(aoNeeded && !m_deinterleaved ? ~0u : 0u);
+    downsampleCamera->setNodeMask(aoNeeded && lowRes ? ~0u : 0u);
+    deinterleaveCamera->setNodeMask(aoNeeded && m_deinterleaved ? ~0u : 0u);
+    ssaoCamera->setNodeMask(aoNeeded ? ~0u : 0u);
+    reinterleaveCamera->setNodeMask(aoNeeded && m_deinterleaved ? ~0u : 0u);
+
+    // Only the camera writing this frame's history target runs
+    for (int i = 0; i < 2; i++)
+        temporalCameras[i]->setNodeMask(aoNeeded && m_temporalEnabled &&
+                                        i == m_historyIndex ? ~0u : 0u);
+
+    // Without blur the composite reads the raw occlusion
+    blurHorizontalCamera->setNodeMask(aoNeeded && m_blurAOEnabled ? ~0u : 0u);
+    blurVerticalCamera->setNodeMask(aoNeeded && m_blurAOEnabled ? ~0u : 0u);
+
+    // Route the occlusion around the passes that are switched off.  The
+    // vertical blur writes secondPassTex, the raw occlusion is consumed by
+    // then in temporal mode.
+    osg::Texture2D* aoResult = m_temporalEnabled ?
+                historyTex[m_historyIndex].get() : secondPassTex.get();
+    bindTexture(blurHorizontalCamera.get(), 0, aoResult);
+    bindTexture(blurCamera.get(), 0, m_blurAOEnabled ? secondPassTex.get() : aoResult);
+}
+
+std::string SSAONode::compositeDefines() const
+{
+    std::stringstream defines;
+    defines << "#define DISPLAY_MODE " << int(displayType) << "\n";
+    if (m_aoResolution != AO_FullRes)
+        defines << "#define UPSAMPLE_AO\n";
+    return defines.str();
+}
+
+int SSAONode::temporalSamples() const
+{
+    return std::min(8, m_kernelSize * m_kernelSize);
+}
 
-    // Add nodes back
-    for (unsigned int i = 0; i < nodeNum; ++i){
-        addNode(nodes[i]);
+std::string SSAONode::ssaoDefines() const
+{
+    std::stringstream defines;
+    defines << "#define AO_PASS\n"; // the G-buffer fetches of common.glsl
+    defines << gbufferDefines();
+    defines << "#define DEPTH_MIP_LEVELS " << DepthMipLevels << "\n";
+    if (m_deinterleaved)
+        defines << "#define DEINTERLEAVE " << m_noiseSize << "\n";
+    if (UsesBlueNoise())
+        defines << "#define BLUE_NOISE " << BlueNoise::Size << "\n";
+    if (m_temporalEnabled) {
+        defines << "#define TEMPORAL\n";
+        defines << "#define TEMPORAL_SAMPLES " << temporalSamples() << "\n";
+    }
+    if (m_aoAlgorithm == AO_HorizonBased) {
+        // Every step of every direction is one depth fetch, 16 by default
+        // against 64 kernel taps.  Temporal mode spreads the directions
+        // over frames instead.
+        int directions = m_temporalEnabled ? 2 : std::max(2, m_kernelSize / 2);
+        defines << "#define NUM_DIRECTIONS " << directions << "\n";
+        defines << "#define NUM_STEPS 4\n";
     }
+    return defines.str();
+}
+
+std::string SSAONode::temporalDefines() const
+{
+    std::stringstream defines;
+    defines << "#define TEMPORAL_FRAMES " << TemporalFrames << "\n";
+    return defines.str();
+}
+
+std::string SSAONode::gbufferDefines() const
+{
+    return compactFormats() ? "#define OCT_NORMALS\n" : "";
+}
 
-    sceneSizeUniform->set(osg::Vec2f(width, height));
-    noiseTextureRcpUniform->set(osg::Vec2f(float(width) / float(m_noiseSize), (float(height) / float(m_noiseSize))));
+std::string SSAONode::bilateralDefines() const
+{
+    std::stringstream defines;
+    defines << gbufferDefines();
+    defines << "#define BLUR_RADIUS " << m_blurSize << "\n";
+    if (m_haloRemovalEnabled)
+        defines << "#define HALO_REMOVAL\n";
+    return defines.str();
+}
+
+void SSAONode::updateShaderVariants()
+{
+    // Swapping a StateAttribute is all it takes, every variant is compiled
+    // once and then comes out of the shared SSAOResources
+    rttCamera->getOrCreateStateSet()->setAttributeAndModes(
+                getOrCreateProgram(":/shaders/phong.vp",
+                                   ":/shaders/phong.fp",
+                                   gbufferDefines()),
+                osg::StateAttribute::ON);
+    m_instancedState->setAttributeAndModes(
+                getOrCreateProgram(":/shaders/phong.vp",
+                                   ":/shaders/phong.fp",
+                                   "#define INSTANCED\n" + gbufferDefines()),
+                osg::StateAttribute::ON);
+
+    const char* ssaoShader = m_aoAlgorithm == AO_HorizonBased ?
+                ":/shaders/hbao.fp" : ":/shaders/ssao.fp";
+    ssaoCamera->getOrCreateStateSet()->setAttributeAndModes(
+                getOrCreateProgram(":/shaders/ssao.vp",
+                                   ssaoShader,
+                                   ssaoDefines()));
+    updateNoiseTexture();
+
+    blurCamera->getOrCreateStateSet()->setAttributeAndModes(
+                getOrCreateProgram(":/shaders/blur.vp",
+                                   ":/shaders/blur.fp",
+                                   compositeDefines()));
+
+    osg::Program* bilateralProgram = getOrCreateProgram(":/shaders/blur.vp",
+                                                        ":/shaders/bilateral.fp",
+                                                        bilateralDefines());
+    blurHorizontalCamera->getOrCreateStateSet()->setAttributeAndModes(bilateralProgram);
+    blurVerticalCamera->getOrCreateStateSet()->setAttributeAndModes(bilateralProgram);
 }
 
 void SSAONode::SetSSAORadius(float radius) {
@@ -336,8 +1260,13 @@ void SSAONode::SetSSAOPower(float power) {
 
 void SSAONode::SetDisplayMode(SSAONode::DisplayMode mode)
 {
+    // Only a composite change, unless ColorOnly left the occlusion stale
+    if (this->displayType == SSAO_ColorOnly)
+        m_stillFrames = 0;
+
 	this->displayType = mode;
-    setUniforms();
+    updateShaderVariants();
+    updateCameraMasks();
 }
 
 float SSAONode::GetSSAORadius() {
@@ -354,20 +1283,21 @@ SSAONode::DisplayMode SSAONode::GetDisplayMode() {
 
 void SSAONode::setProjectionMatrixUniforms()
 {
-    projMatUniform->set(projMatrix);
-    invProjMatrixUniform->set(osg::Matrixd::inverse(projMatrix));
-    blurProjMatrixUniform->set(projMatrix);
+    m_frameBlock->set(Frame_ProjMatrix, osg::Matrixf(projMatrix));
 }
 
 void SSAONode::setUniforms()
 {
     setProjectionMatrixUniforms();
-    radiusUniform->set(m_ssaoRadius);
-    powerUniform->set(m_ssaoPower);
-    displayTypeUniform->set((int) displayType);
-    haloRemovalUniform->set(m_haloRemovalEnabled ? 1 : 0);
-    haloTresholdUniform->set(m_haloTreshold);
-    blurAOUniform->set(m_blurAOEnabled ? 1 : 0);
+    m_parameterBlock->set(Param_Radius, m_ssaoRadius);
+    m_parameterBlock->set(Param_Power, m_ssaoPower);
+    m_parameterBlock->set(Param_HaloTreshold, m_haloTreshold);
+
+    // Settings changed, occlusion has to be recomputed
+    m_stillFrames = 0;
+
+    updateShaderVariants();
+    updateCameraMasks();
 }
 
 void SSAONode::updateProjectionMatrix(osg::Matrixd projMatrix)
@@ -376,12 +1306,96 @@ void SSAONode::updateProjectionMatrix(osg::Matrixd projMatrix)
     setProjectionMatrixUniforms();
 }
 
+void SSAONode::updateViewMatrix(osg::Matrixd viewMatrix)
+{
+    m_frameNumber++;
+
+    // Switch to the formats the context turned out to support
+    if (m_formatsPending) {
+        m_formatsPending = false;
+        updateRenderTargets();
+    }
+
+    if (viewMatrix != previousViewMatrix || projMatrix != previousProjMatrix)
+        m_stillFrames = 0;
+
+    // Scene edits are only seen through DirtyScene()
+    if (m_sceneRevision != m_drawnSceneRevision) {
+        m_drawnSceneRevision = m_sceneRevision;
+        m_stillFrames = 0;
+        m_attachFrames = 2;
+    }
+
+    if (m_occlusionCulling) {
+        // New nodes get the culler's test.  Tiles a pager merges show up
+        // the frame after DirtyScene(), hence twice.
+        if (m_attachFrames > 0) {
+            m_attachFrames--;
+            attachCuller();
+        }
+        if (m_stillFrames == 0)
+            m_culler->viewChanged();
+        // Until the queries are answered and what they revealed is drawn
+        // the G-buffer is incomplete
+        if (m_culler->isSettling())
+            m_stillFrames = 0;
+    }
+
+    // Nothing that affects occlusion changed since the last rendered frame
+    // and the history has settled: the G-buffer and occlusion targets are
+    // still valid, only the composite has to run.
+    // Targets shared through the pool may hold another node's frame by now
+    bool targetsIntact = m_renderTargets->claim(this);
+    m_skipAO = m_stillFrames > 0 && !IsTemporalConverging() && targetsIntact;
+    m_stillFrames++;
+
+    // Consecutive points of the R2 sequence land far apart, so every
+    // recomputed frame sees a shifted tile and any run of frames covers
+    // the tile evenly
+    if (m_noiseOffsetEnabled && UsesBlueNoise() && !m_skipAO) {
+        double n = double(m_frameNumber);
+        m_noiseOffset.set(int((n * 0.7548776662 - floor(n * 0.7548776662)) * BlueNoise::Size),
+                          int((n * 0.5698402910 - floor(n * 0.5698402910)) * BlueNoise::Size));
+        m_frameBlock->set(Frame_NoiseOffset, m_noiseOffset);
+    }
+
+    // Row vectors: this view -> world -> previous view
+    m_frameBlock->set(Frame_ViewToPreviousView,
+                      osg::Matrixf(osg::Matrixd::inverse(viewMatrix) * previousViewMatrix));
+    m_frameBlock->set(Frame_PreviousProjMatrix, osg::Matrixf(previousProjMatrix));
+    previousViewMatrix = viewMatrix;
+    previousProjMatrix = projMatrix;
+
+    if (!m_temporalEnabled || m_skipAO) {
+        updateCameraMasks();
+        return;
+    }
+
+    // Write the other history target, read the one written last frame
+    m_historyIndex = 1 - m_historyIndex;
+    m_frameBlock->set(Frame_HistoryValid, m_historyFrames > 0 ? 1.0f : 0.0f);
+    m_historyFrames++;
+
+    // Golden angle rotation and golden ratio jitter give every frame new
+    // samples that stay well spread over any run of frames
+    float angle = float(m_frameNumber) * 2.39996323f;
+    m_frameBlock->set(Frame_Rotation, osg::Vec2f(cosf(angle), sinf(angle)));
+    m_frameBlock->set(Frame_Jitter, float(m_frameNumber) * 0.618034f -
+                                    floorf(float(m_frameNumber) * 0.618034f));
+
+    int stride = (m_kernelSize * m_kernelSize) / temporalSamples();
+    m_frameBlock->set(Frame_KernelPhase, int(m_frameNumber % unsigned(stride)));
+
+    updateCameraMasks();
+}
+
 // Random number generator
 unsigned int SSAONode::xorshift32() {
-	static unsigned int x = 1424447641;
+	unsigned int x = m_randomState;
 	x ^= x << 13;
 	x ^= x >> 17;
 	x ^= x << 5;
+	m_randomState = x;
 	return x;
 }
 
@@ -390,46 +1404,19 @@ float SSAONode::random(float min, float max) {
             ( static_cast <float> (0xFFFFFFFF/(max-min)) );
 }
 
-float SSAONode::lerp(float min, float max, float t) {
-	return min * (1.0f - t) + max * t;
-}
 
+void SSAONode::generateRotationNoise(osg::Vec3f* noise, size_t noiseSize) {
 
-void SSAONode::generateHemisphereSamples(osg::Vec3f* kernel, size_t kernelSize)
-{
-    QFile f("kernel.obj");
-    f.open(QIODevice::WriteOnly);
-    QTextStream fs(&f);
-    fs << "o kernel" << "\n";
-    for (size_t i = 0; i < kernelSize; ++i) {
-
-        // Actually, do not generate hemisphere,
-        // but a cone to minimize self-intersections
-		kernel[i] = osg::Vec3f(
-            random(-0.95f, 0.95f),
-			random(-0.95f, 0.95f),
-            random(0.0f, 1.0f));
-
-        kernel[i].normalize();
-        fs << "v "
-           << kernel[i].x()
-           << " "
-           << kernel[i].y()
-           << " "
-           << kernel[i].z()
-           << "\n";
+	for (size_t i = 0; i < noiseSize; ++i) {
+		float angle = random(0.0f, 2.0f * float(osg::PI));
 
-#if 1
-        // XXX why are we scaling by the index into the kernel?
-        float scale = float(i) / float(kernelSize);
-		scale = lerp(0.1f, 1.0f, scale * scale);
-		kernel[i] *= scale;
-#endif
-        fs << "f " << i << "\n";
-    }
-    fs.flush();
-    f.flush();
-    f.close();
+		// Direction rotation and step jitter, scaled to <0; 1> for RGB24
+		noise[i] = osg::Vec3f(
+			cosf(angle) * 0.5f + 0.5f,
+			sinf(angle) * 0.5f + 0.5f,
+			random(0.0f, 1.0f)
+			);
+	}
 }
 
 void SSAONode::generateNoise(osg::Vec3f* noise, size_t noiseSize) {
@@ -451,7 +1438,7 @@ void SSAONode::generateNoise(osg::Vec3f* noise, size_t noiseSize) {
 
 
 
-osg::Camera* SSAONode::createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute)
+osg::Camera* SSAONode::createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute, unsigned int level)
 {
 	osg::ref_ptr<osg::Camera> camera = new osg::Camera;
 	camera->setClearColor( osg::Vec4() );
@@ -462,8 +1449,8 @@ osg::Camera* SSAONode::createRTTCamera(osg::Camera::BufferComponent buffer, osg:
 	{
 		tex->setFilter( osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR );
 		tex->setFilter( osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR );
-		camera->setViewport( 0, 0, tex->getTextureWidth(), tex->getTextureHeight() );
-		camera->attach( buffer, tex );
+		camera->setViewport( 0, 0, tex->getTextureWidth() >> level, tex->getTextureHeight() >> level );
+		camera->attach( buffer, tex, level );
 	}
 
 	if ( isAbsolute )
@@ -472,6 +1459,10 @@ osg::Camera* SSAONode::createRTTCamera(osg::Camera::BufferComponent buffer, osg:
 		camera->setProjectionMatrix( osg::Matrix::ortho2D(0.0, 1.0, 0.0, 1.0) );
 		camera->setViewMatrix( osg::Matrix::identity() );
         camera->addChild( createScreenQuad(1.0f, 1.0f) );
+
+        // Screen quads need no depth buffer.  An implicit one would also
+        // be sized to the viewport of the first frame and never follow it.
+        camera->setImplicitBufferAttachmentMask(0, 0);
 	}
 	return camera.release();
 }
@@ -523,21 +1514,6 @@ osg::Camera* SSAONode::createRTTCameraGBuffer( osg::Camera::BufferComponent buff
 	return camera.release();
 }
 
-osg::Texture* SSAONode::createTexture2D(int width, int height, osg::Vec3f* data)
-{
-	osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D; 
-	osg::Image* image = new osg::Image;
-
-	image->setImage(width, height, 1, GL_RGB, GL_RGB, GL_FLOAT, (unsigned char*) data, osg::Image::NO_DELETE); 
-
-	texture->setImage( image ); 
-	texture->setWrap( osg::Texture::WRAP_S, osg::Texture::REPEAT ); 
-	texture->setWrap( osg::Texture::WRAP_T, osg::Texture::REPEAT ); 
-	texture->setFilter( osg::Texture::MIN_FILTER, osg::Texture::LINEAR ); 
-	texture->setFilter( osg::Texture::MAG_FILTER, osg::Texture::LINEAR ); 
-	return texture.release(); 
-}
-
 osg::Geode* SSAONode::createScreenQuad( float width, float height, float scale )
 {
     osg::Geometry* geom =
@@ -575,19 +1551,70 @@ osg::Camera* SSAONode::createHUDCamera( double left, double right,
     return camera.release();
 }
 
-#include <QFile>
-#include <QDir>
 bool SSAONode::setShaderStringFromResource(osg::Shader* shader,
         const std::string resourceName)
 {
-    QFile file( QString::fromStdString(resourceName) );
-    if (!file.open(QIODevice::ReadOnly)) {
+    // Read from the resources once per process
+    std::string source;
+    if (!ProgramCache::resourceSource(resourceName, source)) {
         qDebug("%s does ont exist", resourceName.c_str());
         return false;
     }
 
-    QString str = file.readAll();
-    file.close();
-    shader->setShaderSource(str.toStdString());
+    shader->setShaderSource(source);
     return true;
 }
+
+std::string SSAONode::injectDefines(const std::string& source,
+                                    const std::string& defines)
+{
+    // Defines have to follow the #version line
+    if (defines.empty() || source.compare(0, 8, "#version") != 0)
+        return defines + source;
+
+    size_t eol = source.find('\n');
+    if (eol == std::string::npos)
+        return source + "\n" + defines;
+
+    return source.substr(0, eol + 1) + defines + source.substr(eol + 1);
+}
+
+osg::Program* SSAONode::getOrCreateProgram(const std::string& vertexResource,
+                                           const std::string& fragmentResource,
+                                           const std::string& defines)
+{
+    std::string key = vertexResource + "|" + fragmentResource + "|" + defines;
+
+    // Another node may have built it already
+    osg::Program* cached = m_resources->program(key);
+    if (cached)
+        return cached;
+
+    // Links from a binary the driver stored on an earlier run if it can
+    osg::ref_ptr<osg::Program> program = new CachedProgram;
+    osg::ref_ptr<osg::Shader> vertexObject = new osg::Shader(osg::Shader::VERTEX);
+    osg::ref_ptr<osg::Shader> fragmentObject = new osg::Shader(osg::Shader::FRAGMENT);
+    program->addShader(fragmentObject.get());
+    program->addShader(vertexObject.get());
+
+    setShaderStringFromResource(vertexObject.get(), vertexResource);
+    setShaderStringFromResource(fragmentObject.get(), fragmentResource);
+
+    // Every fragment shader gets the uniform blocks and the shared helpers,
+    // unused ones cost nothing
+    std::string blocks, common;
+    ProgramCache::resourceSource(":/shaders/blocks.glsl", blocks);
+    ProgramCache::resourceSource(":/shaders/common.glsl", common);
+    vertexObject->setShaderSource(injectDefines(vertexObject->getShaderSource(), defines));
+    fragmentObject->setShaderSource(injectDefines(fragmentObject->getShaderSource(),
+                                                  defines + blocks + common));
+    // The binding points are the same in every node
+    m_parameterBlock->bind(program.get());
+    m_frameBlock->bind(program.get());
+    // So are the instance attributes, programs without them ignore these
+    program->addBindAttribLocation("instancePosition", InstancePositionAttrib);
+    program->addBindAttribLocation("instanceColor", InstanceColorAttrib);
+
+    m_resources->addProgram(key, program.get());
+    return program.get();
+}
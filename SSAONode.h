@@ -8,10 +8,19 @@
 #include <osg/Switch>
 #include <osg/Group>
 #include <osg/Texture2D>
+#include <osg/Vec2i>
 #include <osg/PolygonMode>
 #include <osg/Camera>
 #include <osgViewer/Viewer>
+#include "PassTimer.h"
+#include "UniformBlock.h"
+#include "RenderTargetPool.h"
+#include "SSAOResources.h"
+#include "OcclusionCuller.h"
 #include <QString>
+#include <algorithm>
+#include <map>
+#include <vector>
 
 
 class  SSAONode : public osg::Group {
@@ -21,16 +30,64 @@ public:
         SSAO_ColorAndAO = 1,
         SSAO_ColorOnly = 0
     };
+    /// Render target layout.  Compact keeps normals octahedral encoded in
+    /// two channels and occlusion in one.  It falls back to Classic where
+    /// the GL lacks RG textures.
+    enum GBufferLayout {
+        GBuffer_Classic = 0, // RGB8 normals, RGBA8 occlusion
+        GBuffer_Compact = 1  // RG16F (or RG8) normals, R8 occlusion
+    };
+    /// Occlusion estimator of the ssao pass
+    enum AOAlgorithm {
+        AO_HemisphereKernel = 0, // kernelSize^2 random taps in a cone
+        AO_HorizonBased = 1      // kernelSize/2 directions of 4 steps each
+    };
+    /// Size of the occlusion buffer relative to the window.  The ssao pass
+    /// is the expensive one, so rendering it at a fraction of the window
+    /// resolution and upsampling it in the composite pass is a big win.
+    enum AOResolution {
+        AO_FullRes = 1,
+        AO_HalfRes = 2,
+        AO_QuarterRes = 4
+    };
+    /// Passes timed on the GPU.  Passes made of several cameras (the depth
+    /// pyramid, the two blur directions) are timed as one.
+    enum RenderPass {
+        Pass_GBuffer = 0,
+        Pass_Linearize,
+        Pass_HiZ,
+        Pass_DepthPyramid,
+        Pass_Downsample,
+        Pass_Deinterleave,
+        Pass_SSAO,
+        Pass_Reinterleave,
+        Pass_Temporal,
+        Pass_Blur,
+        Pass_Composite,
+        PassCount
+    };
+    /// Levels below full resolution in the view space z pyramid the ssao
+    /// pass samples.  Buckets of 128 texels halve exactly down to level 7.
+    static const int DepthMipLevels = 5;
+    /// Frames the temporal mode accumulates before it stops converging
+    static const int TemporalFrames = 8;
+    /// Vertex attribute locations of instanced geometry: xyz center and w
+    /// edge length, and rgba color, both with a divisor of 1
+    static const int InstancePositionAttrib = 6;
+    static const int InstanceColorAttrib = 7;
+    // A width/height of 0 defers allocating any render target until the
+    // first Resize(), so widgets need not pass their placeholder size
     SSAONode(int m_width,
          int m_height,
          int m_kernelSize = 8, // 4 = good performance, 10 = good quality
-         int m_noiseSize = 2, // should be same as blurSize
-         int m_blurSize = 2, // 2-4, performance goes to hell above 4
+         int m_noiseSize = 2,
+         int m_blurSize = 2, // blur radius in AO texels, cost is linear
          float radius = 0.65f,
          float power = 3.0f);
     ~SSAONode();
 
-	// Initialize SSAO for given node. New Group will be returned that you should add to your scene
+    // Build the cameras, programs and uniforms.  Called once by the
+    // constructor, Resize() only reallocates the render targets.
     void Initialize();
 
     static void buildGraph(osg::ref_ptr<osg::Switch> root,
@@ -46,6 +103,12 @@ public:
         root->setValue(root->getChildIndex(ssao), false );
     }
 
+    // Cull callback for a node of instanced geometry (see
+    // SceneBuilder::buildScene()).  Below an SSAONode it applies that
+    // node's G-buffer program for instances, anywhere else a forward
+    // shaded one.
+    static osg::NodeCallback* createInstancedCullCallback();
+
     static void setSSAOEnabled(osg::ref_ptr<osg::Switch> root,
                                osg::ref_ptr<osg::Group> scene,
                                osg::ref_ptr<SSAONode> ssao,
@@ -68,26 +131,116 @@ public:
     void SetDisplayMode(SSAONode::DisplayMode mode);
     DisplayMode GetDisplayMode();
 
-    void setHaloRemovalEnabled(bool tf) { m_haloRemovalEnabled = tf; }
+    void setHaloRemovalEnabled(bool tf);
     bool IsHaloRemovalEnabled();
-    void setAOBlurEnabled(bool tf) { m_blurAOEnabled = tf; }
+    void setAOBlurEnabled(bool tf);
     bool IsAOBlurEnabled();
 
     void SetHaloTreshold(float treshold);
     float GetHaloTreshold();
 
+    // What the ssao and blur passes sample with, for SSAOReference
+    const osg::Vec3f* GetKernelData() const { return m_kernelData; }
+    int GetKernelLength() const { return m_kernelSize * m_kernelSize; }
+    const osg::Vec3f* GetNoiseData() const { return m_noiseData; }
+    int GetNoiseSize() const { return m_noiseSize; }
+    // True when the ssao pass samples BlueNoise instead of GetNoiseData()
+    bool UsesBlueNoise() const { return m_blueNoiseEnabled && !m_deinterleaved; }
+    osg::Vec2i GetNoiseOffset() const { return m_noiseOffset; }
+    int GetBlurSize() const { return m_blurSize; }
+    // The G-buffer depth attachment and normals of the last frame.  The
+    // targets are allocated in buckets, the frame is their m_width x
+    // m_height lower left corner.
+    osg::Texture2D* GetDepthTexture() const { return linearDepthTex.get(); }
+    osg::Texture2D* GetNormalTexture() const { return normalTex.get(); }
+
+    void SetAOResolution(SSAONode::AOResolution resolution);
+    AOResolution GetAOResolution();
+
+    void SetAOAlgorithm(SSAONode::AOAlgorithm algorithm);
+    AOAlgorithm GetAOAlgorithm();
+
+    void SetGBufferLayout(SSAONode::GBufferLayout layout);
+    GBufferLayout GetGBufferLayout();
+
+    // Temporal mode takes a few rotated samples per frame and accumulates
+    // them in a reprojected history instead of the whole kernel each frame
+    void SetTemporalEnabled(bool tf);
+    bool IsTemporalEnabled();
+    // True while the history has not settled.  Widgets that only redraw
+    // on demand should keep scheduling frames until it turns false.
+    bool IsTemporalConverging() const;
+    // True while more frames are needed to settle: temporal convergence,
+    // a switch of render target formats after the first frame or
+    // occlusion queries not answered yet
+    bool NeedsRedraw() const;
+
+    // Deinterleaved mode splits the occlusion buffer into noiseSize^2
+    // layers with one noise rotation each, so the taps of neighbouring
+    // fragments stay close in the texture cache
+    void SetDeinterleavedEnabled(bool tf);
+    bool IsDeinterleavedEnabled();
+
+    // Blue noise replaces the noiseSize^2 random rotations by a tiled
+    // BlueNoise texture, one texel per occlusion pixel, so a small kernel
+    // needs little or no blur.  Deinterleaved mode keeps its rotation per
+    // layer.
+    void SetBlueNoiseEnabled(bool tf);
+    bool IsBlueNoiseEnabled();
+    // Shifts the blue noise tile every frame the occlusion is recomputed,
+    // so temporal mode accumulates different rotations per pixel
+    void SetNoiseOffsetEnabled(bool tf);
+    bool IsNoiseOffsetEnabled();
+
+    // Occlusion culling skips the parts of the scene that earlier frames
+    // found hidden from the G-buffer pass, see OcclusionCuller.  It pays
+    // off in dense scenes and costs a little everywhere else.
+    void SetOcclusionCullingEnabled(bool tf);
+    bool IsOcclusionCullingEnabled();
+    // Nodes tested and skipped by the last G-buffer pass
+    void GetOcclusionStatistics(unsigned int& tested, unsigned int& occluded) const;
+
+    // The G-buffer and occlusion targets come from a pool of the node's
+    // own by default.  Nodes of views that render one after another on
+    // the same context can share one pool and with it their targets.  A
+    // node whose targets another node rendered into since its last frame
+    // renders the whole frame instead of reusing them.
+    void SetRenderTargetPool(RenderTargetPool* pool);
+    RenderTargetPool* GetRenderTargetPool() const;
+
+    // GPU milliseconds of a pass over the last frames it ran, read back a
+    // few frames late.  False until the pass has been timed, or when the
+    // context lacks GL_ARB_timer_query.
+    bool GetPassTime(RenderPass pass, double& lastMs, double& meanMs,
+                     double& maxMs) const;
+    // Grows whenever new pass times have been read back
+    unsigned int GetPassTimeSamples() const;
+    static const char* PassName(RenderPass pass);
+
     void updateProjectionMatrix(osg::Matrixd projMatrix);
+    // Call once per frame, after updateProjectionMatrix().  Frames where
+    // neither the camera, the scene nor a setting changed only rerun the
+    // composite.
+    void updateViewMatrix(osg::Matrixd viewMatrix);
+    // Report a scene edit: added or removed nodes, geometry, state or what
+    // the cull mask selects.  Bumps the scene revision updateViewMatrix()
+    // compares with the one its G-buffer was drawn at.
+    void DirtyScene();
 
     void addNode(osg::Node* node);
 
     void Resize(int m_width, int m_height);
 
+    // Also releases the queries and pixel buffers of the pass timer and
+    // the occlusion culler, which are not part of the graph
+    virtual void releaseGLObjects(osg::State* state = 0) const;
+
 private:
 
 	// Effect settings
     int m_kernelSize; // 4 = good performance, 10 = good quality
-    int m_noiseSize; // should be same as blurSize
-    int m_blurSize; // make this 2 to 4. Performance goes to hell above 4
+    int m_noiseSize;
+    int m_blurSize; // radius of the separable blur, 8-16 is still cheap
     float m_ssaoRadius;
     float m_ssaoPower;
 	
@@ -98,65 +251,201 @@ private:
     int m_width;
     int m_height;
 
+    AOResolution m_aoResolution;
+    AOAlgorithm m_aoAlgorithm;
+
+    // Temporal accumulation state
+    bool m_temporalEnabled;
+    int m_historyIndex;      // history texture written this frame
+    unsigned m_frameNumber;
+    int m_historyFrames;     // frames rendered since the history was reset
+    int m_stillFrames;       // frames rendered since a camera, scene or setting change
+
+    bool m_deinterleaved;
+
+    bool m_occlusionCulling;
+    int m_attachFrames; // updateViewMatrix() calls left to attach the culler
+
+    // Set by updateViewMatrix() when this frame can reuse the last one's
+    // G-buffer and occlusion
+    bool m_skipAO;
+    unsigned int m_sceneRevision;      // DirtyScene() calls
+    unsigned int m_drawnSceneRevision; // what the G-buffer shows
+
+    // What the context supports, filled in by FormatDetectCallback
+    GBufferLayout m_gbufferLayout;
+    bool m_formatsDetected;
+    bool m_formatsPending;   // detected, not applied yet
+    bool m_textureRGSupported;
+    bool m_halfFloatSupported;
+    struct FormatDetectCallback;
+    friend struct FormatDetectCallback;
+    bool compactFormats() const;
+
+    // Size of the full resolution render targets.  Allocated in buckets
+    // so that resizing the window rarely touches the textures.
+    int m_allocatedWidth;
+    int m_allocatedHeight;
+    static int bucketedSize(int requested, int allocated);
+    int aoWidth() const { return std::max(1, m_width / int(m_aoResolution)); }
+    int aoHeight() const { return std::max(1, m_height / int(m_aoResolution)); }
+
+    osg::ref_ptr<PassTimer> m_passTimer;
+    void timePass(osg::Camera* first, osg::Camera* last, RenderPass pass);
+
     osg::Vec3f* m_kernelData;
     osg::Vec3f* m_noiseData;
+    unsigned int m_randomState; // xorshift32() state, reseeded per noise
+    bool m_blueNoiseEnabled;
+    bool m_noiseOffsetEnabled;
+    osg::Vec2i m_noiseOffset; // texels, mirrored in m_frameBlock
 
 	osg::ref_ptr<osg::Camera> rttCamera;
+    osg::ref_ptr<osg::Camera> linearizeCamera;
+    osg::ref_ptr<osg::Camera> hizCamera;
+    std::vector<osg::ref_ptr<osg::Camera> > depthMipCameras; // level i + 1
+    struct MipRangeCallback;
+    friend struct MipRangeCallback;
+    osg::ref_ptr<osg::Camera> downsampleCamera;
+    osg::ref_ptr<osg::Camera> deinterleaveCamera;
     osg::ref_ptr<osg::Camera> ssaoCamera;
+    osg::ref_ptr<osg::Camera> reinterleaveCamera;
+    osg::ref_ptr<osg::Camera> temporalCameras[2]; // one per history target
+    osg::ref_ptr<osg::Camera> blurHorizontalCamera;
+    osg::ref_ptr<osg::Camera> blurVerticalCamera;
     osg::ref_ptr<osg::Camera> blurCamera;
 	osg::Matrixd projMatrix;
+    osg::Matrixd previousProjMatrix;
+    osg::Matrixd previousViewMatrix;
 
     DisplayMode displayType;
 
-	// Shader uniforms
-    osg::Uniform* projMatUniform;
-    osg::Uniform* invProjMatrixUniform;
-    osg::Uniform* radiusUniform;
-    osg::Uniform* powerUniform;
-    osg::Uniform* displayTypeUniform;
-    osg::Uniform* noiseTextureRcpUniform;
-    osg::Uniform* haloRemovalUniform;
-    osg::Uniform* haloTresholdUniform;
-    osg::Uniform* blurProjMatrixUniform;
-    osg::Uniform* blurAOUniform;
-    osg::Uniform* sceneSizeUniform;
+	// Shader uniforms.  Everything the passes share lives in two std140
+    // blocks declared by blocks.glsl, bound once on this node.  The
+    // enums are the byte offsets of the block members.
+    enum ParameterOffset {
+        Param_Kernel = 0,          // vec4[MaxKernelLength]
+        Param_SceneSize = 2048,
+        Param_TexScale = 2056,
+        Param_AOSize = 2064,
+        Param_AOTexScale = 2072,
+        Param_TileSize = 2080,
+        Param_NoiseTextureRcp = 2088,
+        Param_KernelSize = 2096,
+        Param_DownsampleScale = 2100,
+        Param_Radius = 2104,
+        Param_Power = 2108,
+        Param_HaloTreshold = 2112,
+        ParameterBlockSize = 2128
+    };
+    enum FrameOffset {
+        Frame_ProjMatrix = 0,
+        Frame_PreviousProjMatrix = 64,
+        Frame_ViewToPreviousView = 128,
+        Frame_Rotation = 192,
+        Frame_Jitter = 200,
+        Frame_HistoryValid = 204,
+        Frame_NoiseOffset = 208,
+        Frame_KernelPhase = 216,
+        FrameBlockSize = 224
+    };
+    static const int MaxKernelLength = 128; // MAX_KERNEL_SIZE in blocks.glsl
+    osg::ref_ptr<UniformBlock> m_parameterBlock; // settings and sizes
+    osg::ref_ptr<UniformBlock> m_frameBlock;     // camera and frame sequence
+    std::vector<osg::Uniform*> depthMipSizeUniforms;
 
 	void setUniforms();
 
-    // G Buffer
+    // G Buffer.  Leased from m_renderTargets by updateRenderTargets(), like
+    // every target below but the history.
     osg::ref_ptr<osg::Texture2D> colorTex;
     osg::ref_ptr<osg::Texture2D> linearDepthTex;
     osg::ref_ptr<osg::Texture2D> normalTex;
     osg::ref_ptr<osg::Texture2D> secondPassTex;
+    osg::ref_ptr<osg::Texture2D> blurTempTex; // between the two blur passes
+
+    // View space z with DepthMipLevels mips, read by the ssao pass
+    osg::ref_ptr<osg::Texture2D> linearZTex;
+    // Its farthest distances for occlusion culling, only leased while on
+    osg::ref_ptr<osg::Texture2D> hizTex;
+
+    // m_noiseSize^2 layers of the occlusion buffer side by side, only
+    // leased in deinterleaved mode
+    osg::ref_ptr<osg::Texture2D> zAtlasTex;
+    osg::ref_ptr<osg::Texture2D> normalAtlasTex;
+    osg::ref_ptr<osg::Texture2D> aoAtlasTex;
+
+    // Accumulated occlusion, ping-ponged between frames
+    osg::ref_ptr<osg::Texture2D> historyTex[2];
+
+    // G Buffer at occlusion resolution (only leased when m_aoResolution > 1)
+    osg::ref_ptr<osg::Texture2D> lowResNormalTex;
+    osg::ref_ptr<osg::Texture2D> lowResZTex; // view space z
 
 	// Math utils - possibly replace with calls to some math library
 	unsigned int xorshift32();
 	float random(float min, float max);
-	float lerp(float min, float max, float t);
 
 	// SSAO data generation
-    void generateHemisphereSamples(osg::Vec3f* kernel, size_t kernelSize);
     void generateNoise(osg::Vec3f* noise, size_t m_noiseSize);
+    void generateRotationNoise(osg::Vec3f* noise, size_t m_noiseSize);
+    void updateNoise();
+    void updateNoiseTexture();
 
     osg::StateSet* phongState;
+    // The G-buffer program variant for instanced geometry, applied by
+    // InstancedCullCallback and updated by updateShaderVariants()
+    osg::ref_ptr<osg::StateSet> m_instancedState;
+    struct InstancedCullCallback;
+    friend struct InstancedCullCallback;
 
 	// OSG Utils
     bool setShaderStringFromResource(osg::Shader* shader,
                                      const std::string resourceName);
 
-    osg::Camera* createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute);
+    // Shader programs are specialized with #define permutations rather than
+    // branching on uniforms.  Each variant is built once and kept in
+    // m_resources, shared with every other node.
+    osg::ref_ptr<SSAOResources> m_resources;
+    osg::ref_ptr<RenderTargetPool> m_renderTargets;
+    osg::ref_ptr<OcclusionCuller> m_culler;
+    static std::string injectDefines(const std::string& source,
+                                     const std::string& defines);
+    osg::Program* getOrCreateProgram(const std::string& vertexResource,
+                                     const std::string& fragmentResource,
+                                     const std::string& defines = std::string());
+    std::string compositeDefines() const;
+    std::string ssaoDefines() const;
+    std::string gbufferDefines() const;
+    std::string temporalDefines() const;
+    int temporalSamples() const;
+    std::string bilateralDefines() const;
+
+    osg::Camera* createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute, unsigned int level = 0);
     osg::Camera* createRTTCameraGBuffer(osg::Camera::BufferComponent buffer1, osg::Texture* tex1, osg::Camera::BufferComponent buffer2, osg::Texture* tex2, osg::Camera::BufferComponent buffer3, osg::Texture* tex3, bool isAbsolute);
-    osg::Texture* createTexture2D(int m_width, int m_height, osg::Vec3f* data);
     osg::Geode* createScreenQuad(float m_width, float m_height, float scale = 1.0f);
     osg::Camera* createHUDCamera(double left, double right, double bottom, double top);
 
     std::string stringFromResource(const char *resourceName);
-    void addKernelUniformToStateSet(osg::StateSet *stateset, int kernelLength);
+    void setKernel(int kernelLength);
     void removeAttachedCameras();
     void createFirstPassCamera();
+    void createDepthPyramidCameras();
+    void createHiZCamera();
+    void createDownsampleCamera();
     void createSecondPassCamera(int kernelLength);
+    void createDeinterleaveCameras();
+    void createTemporalCameras();
+    void createBlurCameras();
+    osg::Camera* createBlurPassCamera(const osg::Vec2f& direction);
     void createThirdPassCamera();
     void setProjectionMatrixUniforms();
+    void updateRenderTargets();
+    void bindRenderTargets();
+    void updateShaderVariants();
+    void updateCameraMasks();
+    void updateOcclusionCulling();
+    void attachCuller();
 };
 
 #endif // SSAO_H
@@ -0,0 +1,471 @@
+#include "SSAOReference.h"
+#include "SSAONode.h"
+#include "BlueNoise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SSAO_REFERENCE_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SSAO_REFERENCE_NEON
+#endif
+
+namespace {
+
+// Rows a thread takes from the shared counter at a time
+const int RowBlock = 8;
+
+// Taps closer than 2^LogMaxOffset pixels read the full resolution level,
+// as LOG_MAX_OFFSET in common.glsl
+const int LogMaxOffset = 3;
+
+// Four floats, in one SIMD register where the target has them.  SSE2 and
+// NEON are part of the x86-64 and AArch64 baselines, so no compiler flags
+// or runtime dispatch are needed.
+struct Float4
+{
+#if defined(SSAO_REFERENCE_SSE2)
+    __m128 v;
+    Float4(__m128 v) : v(v) {}
+    explicit Float4(float f) : v(_mm_set1_ps(f)) {}
+    static Float4 load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+#elif defined(SSAO_REFERENCE_NEON)
+    float32x4_t v;
+    Float4(float32x4_t v) : v(v) {}
+    explicit Float4(float f) : v(vdupq_n_f32(f)) {}
+    static Float4 load(const float* p) { return Float4(vld1q_f32(p)); }
+    void store(float* p) const { vst1q_f32(p, v); }
+#else
+    float v[4];
+    Float4() {}
+    explicit Float4(float f) { v[0] = v[1] = v[2] = v[3] = f; }
+    static Float4 load(const float* p) { Float4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+#endif
+};
+
+#if defined(SSAO_REFERENCE_SSE2)
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+inline Float4 abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+// 1 where a >= b, else 0
+inline Float4 stepGE(Float4 a, Float4 b)
+{
+    return _mm_and_ps(_mm_cmpge_ps(a.v, b.v), _mm_set1_ps(1.0f));
+}
+#elif defined(SSAO_REFERENCE_NEON)
+inline Float4 operator+(Float4 a, Float4 b) { return vaddq_f32(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return vsubq_f32(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return vmulq_f32(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return vdivq_f32(a.v, b.v); }
+inline Float4 min(Float4 a, Float4 b) { return vminq_f32(a.v, b.v); }
+inline Float4 max(Float4 a, Float4 b) { return vmaxq_f32(a.v, b.v); }
+inline Float4 abs(Float4 a) { return vabsq_f32(a.v); }
+inline Float4 stepGE(Float4 a, Float4 b)
+{
+    return vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(a.v, b.v),
+                                           vreinterpretq_u32_f32(vdupq_n_f32(1.0f))));
+}
+#else
+#define FLOAT4_OP(name, expr) \
+    inline Float4 name(Float4 a, Float4 b) \
+    { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = (expr); return r; }
+FLOAT4_OP(operator+, a.v[i] + b.v[i])
+FLOAT4_OP(operator-, a.v[i] - b.v[i])
+FLOAT4_OP(operator*, a.v[i] * b.v[i])
+FLOAT4_OP(operator/, a.v[i] / b.v[i])
+FLOAT4_OP(min, std::min(a.v[i], b.v[i]))
+FLOAT4_OP(max, std::max(a.v[i], b.v[i]))
+FLOAT4_OP(stepGE, a.v[i] >= b.v[i] ? 1.0f : 0.0f)
+#undef FLOAT4_OP
+inline Float4 abs(Float4 a) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = std::fabs(a.v[i]); return r; }
+#endif
+
+inline float sum(Float4 a)
+{
+    float v[4];
+    a.store(v);
+    return (v[0] + v[1]) + (v[2] + v[3]);
+}
+
+// floor(log2(x)) of a normal float, straight from the exponent bits
+inline int floorLog2(float x)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return int((bits >> 23) & 0xff) - 127;
+}
+
+} // namespace
+
+SSAOReference::SSAOReference(SSAONode* node, int threadCount)
+    : m_kernelLength(node->GetKernelLength())
+    , m_noiseSize(node->GetNoiseSize())
+    , m_radius(node->GetSSAORadius())
+    , m_power(node->GetSSAOPower())
+    , m_blurSize(node->GetBlurSize())
+    , m_blurEnabled(node->IsAOBlurEnabled())
+    , m_haloRemovalEnabled(node->IsHaloRemovalEnabled())
+    , m_haloTreshold(node->GetHaloTreshold())
+    , m_levels(SSAONode::DepthMipLevels + 1)
+    , m_job(nullptr)
+    , m_jobRows(0)
+    , m_jobGeneration(0)
+    , m_busyWorkers(0)
+    , m_nextRow(0)
+    , m_quit(false)
+{
+    const osg::Vec3f* kernel = node->GetKernelData();
+    int padded = (m_kernelLength + 3) & ~3;
+    m_kernelX.assign(padded, 0.0f);
+    m_kernelY.assign(padded, 0.0f);
+    m_kernelZ.assign(padded, 0.0f);
+    m_kernelWeight.assign(padded, 0.0f);
+    for (int i = 0; i < m_kernelLength; i++) {
+        m_kernelX[i] = kernel[i].x();
+        m_kernelY[i] = kernel[i].y();
+        m_kernelZ[i] = kernel[i].z();
+        m_kernelWeight[i] = 1.0f;
+    }
+
+    if (node->UsesBlueNoise()) {
+        // fetch_noise() decodes the angle of the shifted RG8 tile
+        osg::Vec2i offset = node->GetNoiseOffset();
+        const unsigned char* texels = BlueNoise::data();
+        m_noiseSize = BlueNoise::Size;
+        m_noise.resize(m_noiseSize * m_noiseSize);
+        for (int y = 0; y < m_noiseSize; y++) {
+            for (int x = 0; x < m_noiseSize; x++) {
+                int texel = ((y + offset.y()) & (m_noiseSize - 1)) * m_noiseSize +
+                        ((x + offset.x()) & (m_noiseSize - 1));
+                float angle = texels[2 * texel] / 255.0f * 6.28318531f;
+                m_noise[y * m_noiseSize + x].set(std::cos(angle) * 0.5f + 0.5f,
+                                                 std::sin(angle) * 0.5f + 0.5f,
+                                                 0.5f);
+            }
+        }
+    } else {
+        // The noise texture is uploaded as RGB8
+        const osg::Vec3f* noise = node->GetNoiseData();
+        m_noise.resize(m_noiseSize * m_noiseSize);
+        for (size_t i = 0; i < m_noise.size(); i++) {
+            for (int c = 0; c < 3; c++)
+                m_noise[i][c] = std::floor(noise[i][c] * 255.0f + 0.5f) / 255.0f;
+        }
+    }
+
+    if (threadCount <= 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < threadCount; i++)
+        m_workers.push_back(std::thread(&SSAOReference::workerLoop, this));
+}
+
+SSAOReference::~SSAOReference()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void SSAOReference::computeAO(int width, int height,
+                              const float* depth,
+                              const osg::Vec3f* normals,
+                              const osg::Matrixf& projMatrix,
+                              float* ao)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    m_projMatrix = projMatrix;
+    linearize(width, height, depth);
+    buildPyramid();
+
+    parallelRows(height, [&](int y0, int y1) {
+        occlusionRows(y0, y1, normals, ao);
+    });
+
+    if (!m_blurEnabled)
+        return;
+
+    // Horizontal into the temporary, vertical back, as the two blur cameras
+    m_blurTemp.resize(size_t(width) * height);
+    float* temp = &m_blurTemp[0];
+    parallelRows(height, [&](int y0, int y1) {
+        blurRows(y0, y1, true, normals, ao, temp);
+    });
+    parallelRows(height, [&](int y0, int y1) {
+        blurRows(y0, y1, false, normals, temp, ao);
+    });
+}
+
+void SSAOReference::linearize(int width, int height, const float* depth)
+{
+    Level& level = m_levels[0];
+    level.width = width;
+    level.height = height;
+    level.z.resize(size_t(width) * height);
+
+    // linearize.fp, four pixels at a time
+    const osg::Matrixf& p = m_projMatrix;
+    Float4 one(1.0f), two(2.0f);
+    Float4 p22(p(2, 2)), p23(p(2, 3)), p32(p(3, 2)), p33(p(3, 3));
+    float* z = &level.z[0];
+
+    parallelRows(height, [&](int y0, int y1) {
+        size_t i = size_t(y0) * width;
+        size_t end = size_t(y1) * width;
+        for (; i + 4 <= end; i += 4) {
+            Float4 ndcZ = Float4::load(depth + i) * two - one;
+            ((p32 - ndcZ * p33) / (ndcZ * p23 - p22)).store(z + i);
+        }
+        for (; i < end; i++) {
+            float ndcZ = depth[i] * 2.0f - 1.0f;
+            z[i] = (p(3, 2) - ndcZ * p(3, 3)) / (ndcZ * p(2, 3) - p(2, 2));
+        }
+    });
+}
+
+void SSAOReference::buildPyramid()
+{
+    // depthmip.fp: rotated grid pick from the level above
+    for (size_t l = 1; l < m_levels.size(); l++) {
+        const Level& previous = m_levels[l - 1];
+        Level& level = m_levels[l];
+        level.width = std::max(m_levels[0].width >> l, 1);
+        level.height = std::max(m_levels[0].height >> l, 1);
+        level.z.resize(size_t(level.width) * level.height);
+
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++) {
+                int px = std::min(x * 2 + (y & 1), previous.width - 1);
+                int py = std::min(y * 2 + (x & 1), previous.height - 1);
+                level.z[size_t(y) * level.width + x] =
+                        previous.z[size_t(py) * previous.width + px];
+            }
+        }
+    }
+}
+
+float SSAOReference::fetchZ(float x, float y, int mip) const
+{
+    // fetch_z() of common.glsl: truncate, shift down to the level, clamp
+    const Level& level = m_levels[mip];
+    int tx = std::min(std::max(int(x) >> mip, 0), level.width - 1);
+    int ty = std::min(std::max(int(y) >> mip, 0), level.height - 1);
+    return level.z[size_t(ty) * level.width + tx];
+}
+
+void SSAOReference::occlusionRows(int y0, int y1, const osg::Vec3f* normals,
+                                  float* ao) const
+{
+    const osg::Matrixf& p = m_projMatrix;
+    const Level& full = m_levels[0];
+    int width = full.width;
+    int height = full.height;
+    int maxMip = int(m_levels.size()) - 1;
+    int padded = int(m_kernelX.size());
+
+    float farZ = (p(3, 2) - p(3, 3)) / (p(2, 3) - p(2, 2));
+    Float4 radius(m_radius), zero(0.0f), one(1.0f), two(2.0f), three(3.0f);
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t index = size_t(y) * width + x;
+            float ssPx = x + 0.5f;
+            float ssPy = y + 0.5f;
+
+            float originZ = full.z[index];
+            if (originZ <= farZ + std::fabs(farZ) * 1e-5f) {
+                ao[index] = 1.0f;
+                continue;
+            }
+
+            // reconstruct_pos()
+            float ndcX = ssPx / width * 2.0f - 1.0f;
+            float ndcY = ssPy / height * 2.0f - 1.0f;
+            float w = p(2, 3) * originZ + p(3, 3);
+            osg::Vec3f origin((ndcX * w - p(2, 0) * originZ - p(3, 0)) / p(0, 0),
+                              (ndcY * w - p(2, 1) * originZ - p(3, 1)) / p(1, 1),
+                              originZ);
+
+            osg::Vec3f normal = normals[index];
+            normal.normalize();
+
+            const osg::Vec3f& noise = m_noise[(y % m_noiseSize) * m_noiseSize + x % m_noiseSize];
+            osg::Vec3f rvec = noise * 2.0f - osg::Vec3f(1.0f, 1.0f, 1.0f);
+
+            osg::Vec3f tangent = rvec - normal * (rvec * normal);
+            tangent.normalize();
+            osg::Vec3f bitangent = tangent ^ normal;
+
+            float ppuX = 0.5f * width * p(0, 0) / w;
+            float ppuY = 0.5f * height * p(1, 1) / w;
+
+            Float4 tx(tangent.x()), ty(tangent.y()), tz(tangent.z());
+            Float4 bx(bitangent.x()), by(bitangent.y()), bz(bitangent.z());
+            Float4 nx(normal.x()), ny(normal.y()), nz(normal.z());
+            Float4 originX(origin.x()), originY(origin.y()), originZ4(originZ);
+            Float4 ppuX4(ppuX), ppuY4(ppuY);
+            Float4 occlusion(0.0f);
+
+            for (int i = 0; i < padded; i += 4) {
+                Float4 kx = Float4::load(&m_kernelX[i]);
+                Float4 ky = Float4::load(&m_kernelY[i]);
+                Float4 kz = Float4::load(&m_kernelZ[i]);
+
+                // tbn * kernel * radius
+                Float4 ox = (tx * kx + bx * ky + nx * kz) * radius;
+                Float4 oy = (ty * kx + by * ky + ny * kz) * radius;
+                Float4 oz = (tz * kx + bz * ky + nz * kz) * radius;
+                Float4 sampleZ = originZ4 + oz;
+
+                Float4 ssOffsetX = ox * ppuX4;
+                Float4 ssOffsetY = oy * ppuY4;
+                Float4 ssR2 = ssOffsetX * ssOffsetX + ssOffsetY * ssOffsetY;
+
+                // The depth fetches are a gather, one lane at a time
+                float offX[4], offY[4], r2[4], sampleDepth[4];
+                ssOffsetX.store(offX);
+                ssOffsetY.store(offY);
+                ssR2.store(r2);
+                for (int l = 0; l < 4; l++) {
+                    // floor(log2(ssR)) == floor(log2(ssR^2)) / 2, no sqrt
+                    int logR = r2[l] > 1.0f ? floorLog2(r2[l]) >> 1 : 0;
+                    int mip = std::min(std::max(logR - LogMaxOffset, 0), maxMip);
+                    sampleDepth[l] = fetchZ(ssPx + offX[l], ssPy + offY[l], mip);
+                }
+                Float4 depth4 = Float4::load(sampleDepth);
+
+                // smoothstep(0, 1, radius / dist) * step(sample.z, depth)
+                Float4 t = min(max(radius / abs(originZ4 - depth4), zero), one);
+                Float4 rangeCheck = t * t * (three - two * t);
+                occlusion = occlusion + rangeCheck * stepGE(depth4, sampleZ) *
+                        Float4::load(&m_kernelWeight[i]);
+            }
+
+            float result = 1.0f - sum(occlusion) / float(m_kernelLength);
+            ao[index] = std::pow(result, m_power);
+        }
+    }
+}
+
+void SSAOReference::blurRows(int y0, int y1, bool horizontal,
+                             const osg::Vec3f* normals, const float* in,
+                             float* out) const
+{
+    // bilateral.fp at full resolution: taps clamp to the image edge
+    const float* z = &m_levels[0].z[0];
+    int width = m_levels[0].width;
+    int height = m_levels[0].height;
+    int radius = m_blurSize;
+
+    float sigma = (float(radius) + 1.0f) * 0.5f;
+    float falloff = 1.0f / (2.0f * sigma * sigma);
+    std::vector<float> gauss(2 * radius + 1);
+    for (int i = -radius; i <= radius; i++)
+        gauss[i + radius] = std::exp(-float(i * i) * falloff);
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t index = size_t(y) * width + x;
+
+            float centerZ = z[index];
+            osg::Vec3f centerNormal = normals[index];
+            centerNormal.normalize();
+            float depthRange = std::fabs(centerZ) * 0.1f; // DEPTH_TOLERANCE
+            if (m_haloRemovalEnabled)
+                depthRange = std::min(depthRange, m_haloTreshold);
+            depthRange = std::max(depthRange, 0.0001f);
+
+            float result = 0.0f;
+            float totalWeight = 0.0f;
+            for (int i = -radius; i <= radius; i++) {
+                int sx = horizontal ? std::min(std::max(x + i, 0), width - 1) : x;
+                int sy = horizontal ? y : std::min(std::max(y + i, 0), height - 1);
+                size_t tap = size_t(sy) * width + sx;
+                float weight = gauss[i + radius];
+
+                osg::Vec3f sampleNormal = normals[tap];
+                sampleNormal.normalize();
+
+                weight *= std::max(0.0f, 1.0f - std::fabs(z[tap] - centerZ) / depthRange);
+                float facing = std::max(sampleNormal * centerNormal, 0.0f);
+                facing *= facing;
+                facing *= facing;
+                weight *= facing * facing;
+
+                result += in[tap] * weight;
+                totalWeight += weight;
+            }
+
+            out[index] = result / totalWeight;
+        }
+    }
+}
+
+void SSAOReference::parallelRows(int height, const std::function<void(int, int)>& fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &fn;
+        m_jobRows = height;
+        m_nextRow = 0;
+        m_busyWorkers = int(m_workers.size());
+        m_jobGeneration++;
+    }
+    m_wake.notify_all();
+
+    for (;;) {
+        int y0 = m_nextRow.fetch_add(RowBlock);
+        if (y0 >= height)
+            break;
+        fn(y0, std::min(y0 + RowBlock, height));
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_job = nullptr;
+}
+
+void SSAOReference::workerLoop()
+{
+    unsigned generation = 0;
+    for (;;) {
+        const std::function<void(int, int)>* job;
+        int rows;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_quit || m_jobGeneration != generation; });
+            if (m_quit)
+                return;
+            generation = m_jobGeneration;
+            job = m_job;
+            rows = m_jobRows;
+        }
+
+        for (;;) {
+            int y0 = m_nextRow.fetch_add(RowBlock);
+            if (y0 >= rows)
+                break;
+            (*job)(y0, std::min(y0 + RowBlock, rows));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+            m_done.notify_one();
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef SSAOREFERENCE_H
+#define SSAOREFERENCE_H
+
+#include <osg/Matrixf>
+#include <osg/Vec3f>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class SSAONode;
+
+// CPU implementation of the full resolution hemisphere kernel path:
+// linearize.fp, depthmip.fp, ssao.fp and the two bilateral.fp passes.
+// It mirrors the shader math step by step, so on the same inputs it
+// agrees with the GPU up to float rounding and the 8 bit noise texture.
+// Rows are spread over a pool of worker threads and the per tap math runs
+// four taps at a time (SSE2 on x86, NEON on AArch64).
+//
+// Images are row major with row 0 at the bottom, as glReadPixels returns
+// them.  Depth is the depth buffer value in [0, 1], normals are view space.
+class SSAOReference
+{
+public:
+    // Copies the kernel, noise and settings of the node, which should use
+    // AO_HemisphereKernel.  0 threads uses one per hardware thread.
+    explicit SSAOReference(SSAONode* node, int threadCount = 0);
+    ~SSAOReference();
+
+    // Occlusion per pixel, 1 = unoccluded, blurred when the node blurs
+    void computeAO(int width, int height,
+                   const float* depth,
+                   const osg::Vec3f* normals,
+                   const osg::Matrixf& projMatrix,
+                   float* ao);
+
+    int threadCount() const { return int(m_workers.size()) + 1; }
+
+private:
+    struct Level {
+        int width;
+        int height;
+        std::vector<float> z;
+    };
+
+    void linearize(int width, int height, const float* depth);
+    void buildPyramid();
+    void occlusionRows(int y0, int y1, const osg::Vec3f* normals, float* ao) const;
+    void blurRows(int y0, int y1, bool horizontal, const osg::Vec3f* normals,
+                  const float* in, float* out) const;
+    float fetchZ(float x, float y, int mip) const;
+
+    // Runs fn(y0, y1) over blocks of rows on all threads, returns when done
+    void parallelRows(int height, const std::function<void(int, int)>& fn);
+    void workerLoop();
+
+    // Kernel taps split by component and padded to a multiple of four,
+    // padding taps have a weight of 0
+    std::vector<float> m_kernelX, m_kernelY, m_kernelZ, m_kernelWeight;
+    int m_kernelLength;
+    std::vector<osg::Vec3f> m_noise; // decoded like fetch_noise() does
+    int m_noiseSize;
+    float m_radius;
+    float m_power;
+    int m_blurSize;
+    bool m_blurEnabled;
+    bool m_haloRemovalEnabled;
+    float m_haloTreshold;
+
+    osg::Matrixf m_projMatrix;
+    std::vector<Level> m_levels; // view space z, full resolution first
+    std::vector<float> m_blurTemp;
+
+    // Worker pool.  The calling thread works too.
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(int, int)>* m_job;
+    int m_jobRows;
+    unsigned m_jobGeneration;
+    int m_busyWorkers;
+    std::atomic<int> m_nextRow;
+    bool m_quit;
+};
+
+#endif // SSAOREFERENCE_H
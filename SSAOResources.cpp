@@ -0,0 +1,78 @@
+#include "SSAOResources.h"
+#include "BlueNoise.h"
+#include <osg/Image>
+#include <osg/observer_ptr>
+#include <OpenThreads/ScopedLock>
+#include <cstring>
+
+namespace {
+
+OpenThreads::Mutex s_sharedMutex;
+osg::observer_ptr<SSAOResources> s_shared;
+
+// Texels are fetched by fragment position, so there is no filtering
+// and no mipmap
+osg::Texture2D* createNoiseTexture(osg::Image* image)
+{
+    osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D(image);
+    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+    texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    return texture.release();
+}
+
+} // namespace
+
+osg::ref_ptr<SSAOResources> SSAOResources::shared()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_sharedMutex);
+    osg::ref_ptr<SSAOResources> resources;
+    if (!s_shared.lock(resources)) {
+        resources = new SSAOResources;
+        s_shared = resources.get();
+    }
+    return resources;
+}
+
+osg::Program* SSAOResources::program(const std::string& key) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    auto cached = m_programs.find(key);
+    return cached != m_programs.end() ? cached->second.get() : nullptr;
+}
+
+void SSAOResources::addProgram(const std::string& key, osg::Program* program)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    m_programs[key] = program;
+}
+
+osg::Texture2D* SSAOResources::noiseTexture(const std::string& key, int size,
+                                            const osg::Vec3f* data)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    osg::ref_ptr<osg::Texture2D>& texture = m_noiseTextures[key];
+    if (!texture.valid()) {
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->allocateImage(size, size, 1, GL_RGB, GL_FLOAT);
+        image->setInternalTextureFormat(GL_RGB);
+        std::memcpy(image->data(), data, sizeof(osg::Vec3f) * size * size);
+        texture = createNoiseTexture(image.get());
+    }
+    return texture.get();
+}
+
+osg::Texture2D* SSAOResources::blueNoiseTexture()
+{
+    // Rotation angle in R, step jitter in G
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+    if (!m_blueNoiseTexture.valid()) {
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->setImage(BlueNoise::Size, BlueNoise::Size, 1, GL_RG8, GL_RG,
+                        GL_UNSIGNED_BYTE, (unsigned char*)BlueNoise::data(),
+                        osg::Image::NO_DELETE);
+        m_blueNoiseTexture = createNoiseTexture(image.get());
+    }
+    return m_blueNoiseTexture.get();
+}
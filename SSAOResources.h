@@ -0,0 +1,42 @@
+#ifndef SSAORESOURCES_H
+#define SSAORESOURCES_H
+
+#include <osg/Program>
+#include <osg/Texture2D>
+#include <osg/Vec3f>
+#include <OpenThreads/Mutex>
+#include <map>
+#include <string>
+
+// Programs and noise textures shared by every SSAONode alive.  OSG creates
+// the GL objects of a Program or Texture once per context that applies
+// it, so views on one context compile and upload these once, and views
+// on different contexts still share everything but the GL objects.
+class SSAOResources : public osg::Referenced
+{
+public:
+    // Created with the first node, gone with the last one
+    static osg::ref_ptr<SSAOResources> shared();
+
+    // Nullptr when no program was added for this key yet
+    osg::Program* program(const std::string& key) const;
+    void addProgram(const std::string& key, osg::Program* program);
+
+    // size x size texels, one texture per key.  The data is copied, so
+    // every caller with the same key has to pass the same data.
+    osg::Texture2D* noiseTexture(const std::string& key, int size,
+                                 const osg::Vec3f* data);
+    osg::Texture2D* blueNoiseTexture();
+
+protected:
+    SSAOResources() {}
+    virtual ~SSAOResources() {}
+
+private:
+    mutable OpenThreads::Mutex m_mutex;
+    std::map<std::string, osg::ref_ptr<osg::Program> > m_programs;
+    std::map<std::string, osg::ref_ptr<osg::Texture2D> > m_noiseTextures;
+    osg::ref_ptr<osg::Texture2D> m_blueNoiseTexture;
+};
+
+#endif // SSAORESOURCES_H
@@ -0,0 +1,370 @@
+#include "SceneBuilder.h"
+#include "SSAONode.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include <osg/Geometry>
+#include <osg/LineWidth>
+#include <osg/ShapeDrawable>
+#include <osg/VertexAttribDivisor>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+
+osg::ref_ptr<osg::Geode> SceneBuilder::buildAxes()
+{
+    osg::ref_ptr<osg::Geometry> m_axisGeom = new osg::Geometry();
+    // allocate verticies
+    osg::ref_ptr<osg::Vec3Array> m_axisVerts = new osg::Vec3Array;
+    m_axisVerts->push_back(osg::Vec3(-1.0, 0.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(1.0, 0.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, -1.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, 1.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, -1.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 0.0));
+    m_axisVerts->push_back(osg::Vec3(0.0, 0.0, 1.0));
+
+    m_axisGeom->setVertexArray(m_axisVerts);
+    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 0, 2));
+    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 1, 2));
+    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 3, 2));
+    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 4, 2));
+    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 6, 2));
+    m_axisGeom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 7, 2));
+
+    // allocate colors
+    osg::Vec4Array* colors = new osg::Vec4Array;
+    colors->push_back(osg::Vec4(.35f,0.0f,0.0f,1.0f));
+    colors->push_back(osg::Vec4(1.0f,0.0f,0.0f,1.0f));
+    colors->push_back(osg::Vec4(0.0f,.35f,0.0f,1.0f));
+    colors->push_back(osg::Vec4(0.0f,1.0f,0.0f,1.0f));
+    colors->push_back(osg::Vec4(0.0f,0.0f,.35f,1.0f));
+    colors->push_back(osg::Vec4(0.0f,0.0f,1.0f,1.0f));
+
+    m_axisGeom->setColorArray(colors);
+    m_axisGeom->setColorBinding(osg::Geometry::BIND_PER_PRIMITIVE_SET);
+    m_axisGeom->setDataVariance(osg::Object::DYNAMIC);
+
+    // generate the Geode
+    osg::ref_ptr<osg::Geode> m_axisGeode = new osg::Geode();
+    m_axisGeode->addDrawable(m_axisGeom);
+    //m_axisGeode->setNodeMask( MASK_AXIS );
+    m_axisGeode->setName("Axis");
+
+    //turn off lighting so we always see the line color
+    osg::StateSet *ss = m_axisGeode->getOrCreateStateSet();
+    ss->setMode( GL_LIGHTING, osg::StateAttribute::OFF );
+
+    // Set the linewidth a little wider so we can see the thing
+    osg::LineWidth *lineWidth = new osg::LineWidth;
+    lineWidth->setWidth( 2.0 );
+    ss->setAttributeAndModes(lineWidth);
+
+    return m_axisGeode;
+}
+
+
+namespace {
+
+struct BoxInstance {
+    osg::Vec3 center;
+    float size;
+    osg::Vec4 color;
+};
+
+// Boxes a thread generates at a time.  Each block has a generator of its
+// own seeded from the scene seed and the block index, so the boxes do not
+// depend on the thread count.
+const int BoxBlock = 4096;
+
+// Bumped whenever the boxes for a seed change, it invalidates the cache
+const int SceneVersion = 1;
+
+void generateBlock(BoxInstance* boxes, int count, unsigned seed, int block)
+{
+    // mt19937 output is fixed by the standard, distributions are not
+    std::seed_seq seq{ seed, unsigned(block) };
+    std::mt19937 rng(seq);
+    auto randUnit = [&rng]() { return float(rng() >> 8) * (1.0f / 16777215.0f); };
+    auto randCoord = [&randUnit]() { return (randUnit() - 0.5f) * 2.0f; };
+    auto randColor = [&randUnit]() { return randUnit() * 0.875f + 0.125f; };
+
+    float boxDimen = 30.0;
+    float sphMin = 0.125;
+    float sphMax = 4;
+
+    for (int i = 0; i < count; i++) {
+        BoxInstance& box = boxes[i];
+        float x = boxDimen * randCoord();
+        float y = boxDimen * randCoord();
+        float z = boxDimen * randCoord();
+        box.center.set(x, y, z);
+        box.size =  sphMin + (randUnit() * (sphMax-sphMin));
+        float r = randColor();
+        float g = randColor();
+        float b = randColor();
+        box.color.set(r, g, b, 1.0f);
+    }
+}
+
+std::vector<BoxInstance> generateBoxes(int boxCount, unsigned seed)
+{
+    std::vector<BoxInstance> boxes(std::max(boxCount, 0));
+    int blocks = (boxCount + BoxBlock - 1) / BoxBlock;
+    std::atomic<int> nextBlock(0);
+    auto work = [&]() {
+        for (;;) {
+            int block = nextBlock.fetch_add(1);
+            if (block >= blocks)
+                break;
+            int first = block * BoxBlock;
+            generateBlock(&boxes[first], std::min(BoxBlock, boxCount - first),
+                          seed, block);
+        }
+    };
+
+    int threadCount = std::min<int>(blocks, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++)
+        workers.push_back(std::thread(work));
+    work();
+    for (auto& worker : workers)
+        worker.join();
+    return boxes;
+}
+
+osg::ref_ptr<osg::Geode> buildBoxDrawables(const std::vector<BoxInstance>& boxes)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    for (const BoxInstance& box : boxes) {
+        osg::ShapeDrawable *sd = new osg::ShapeDrawable(new osg::Box(box.center, box.size));
+        sd->setColor(box.color);
+        geode->addDrawable(sd);
+    }
+    return geode;
+}
+
+// One unit cube drawn boxes.size() times.  Center, size and color are
+// per instance vertex attributes read by the INSTANCED variant of
+// phong.vp, which SSAONode's cull callback applies (see
+// setInstancedCallbacks()).
+osg::ref_ptr<osg::Geode> buildInstancedBoxes(const std::vector<BoxInstance>& boxes)
+{
+    // 6 faces of two triangles each, with face normals
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    for (int axis = 0; axis < 3; axis++) {
+        for (float side = -1.0f; side <= 1.0f; side += 2.0f) {
+            osg::Vec3 n, u, v;
+            n[axis] = side;
+            u[(axis + 1) % 3] = 0.5f;
+            v[(axis + 2) % 3] = 0.5f * side; // counter clockwise from outside
+            osg::Vec3 c = n * 0.5f;
+            osg::Vec3 quad[4] = { c - u - v, c + u - v, c + u + v, c - u + v };
+            int corners[6] = { 0, 1, 2, 0, 2, 3 };
+            for (int corner : corners) {
+                vertices->push_back(quad[corner]);
+                normals->push_back(n);
+            }
+        }
+    }
+
+    osg::ref_ptr<osg::Vec4Array> positions = new osg::Vec4Array;
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+    positions->reserve(boxes.size());
+    colors->reserve(boxes.size());
+    osg::BoundingBox bound;
+    for (const BoxInstance& box : boxes) {
+        positions->push_back(osg::Vec4(box.center, box.size));
+        colors->push_back(box.color);
+        osg::Vec3 half(box.size, box.size, box.size);
+        half *= 0.5f;
+        bound.expandBy(box.center - half);
+        bound.expandBy(box.center + half);
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(vertices);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->setVertexAttribArray(SSAONode::InstancePositionAttrib, positions,
+                                   osg::Array::BIND_PER_VERTEX);
+    geometry->setVertexAttribArray(SSAONode::InstanceColorAttrib, colors,
+                                   osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, vertices->size(),
+                                                  (int)boxes.size()));
+    // The vertex array only holds the unit cube
+    geometry->setInitialBound(bound);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry);
+    geode->setName("InstancedBoxes");
+
+    osg::StateSet* ss = geode->getOrCreateStateSet();
+    ss->setAttribute(new osg::VertexAttribDivisor(SSAONode::InstancePositionAttrib, 1));
+    ss->setAttribute(new osg::VertexAttribDivisor(SSAONode::InstanceColorAttrib, 1));
+    return geode;
+}
+
+// The cull callback is not serializable, so it is left out of files
+void setInstancedCallbacks(osg::Node* scene, bool attach)
+{
+    osg::Group* group = scene->asGroup();
+    if (!group)
+        return;
+    for (unsigned int i = 0; i < group->getNumChildren(); i++) {
+        osg::Node* child = group->getChild(i);
+        if (child->getName() == "InstancedBoxes")
+            child->setCullCallback(attach ? SSAONode::createInstancedCullCallback() : nullptr);
+    }
+}
+
+QString sceneCachePath(int boxCount, bool instanced, unsigned seed)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (dir.isEmpty())
+        return QString();
+    return QDir(dir).filePath(QString("scenes/boxes-%1-%2-%3-v%4.osgb")
+                              .arg(boxCount)
+                              .arg(seed)
+                              .arg(instanced ? "instanced" : "drawables")
+                              .arg(SceneVersion));
+}
+
+// Moves tempName over fileName.  rename() replaces the target in one
+// step on POSIX systems; where it refuses to replace, the target is
+// removed first.
+bool replaceFile(const QString& tempName, const QString& fileName)
+{
+    if (std::rename(QFile::encodeName(tempName).constData(),
+                    QFile::encodeName(fileName).constData()) == 0)
+        return true;
+    QFile::remove(fileName);
+    return QFile::rename(tempName, fileName);
+}
+
+} // namespace
+
+osg::ref_ptr<osg::Node> SceneBuilder::buildScene(int boxCount, bool instanced,
+                                                 unsigned seed)
+{
+    osg::ref_ptr<osg::Group> node = new osg::Group;
+
+    osg::ref_ptr<osg::Geode> geode = buildAxes();
+    node->addChild(geode);
+
+    std::vector<BoxInstance> boxes = generateBoxes(boxCount, seed);
+    if (instanced)
+        node->addChild(buildInstancedBoxes(boxes));
+    else
+        node->addChild(buildBoxDrawables(boxes));
+
+    setInstancedCallbacks(node.get(), true);
+    return node;
+}
+
+osg::ref_ptr<osg::Node> SceneBuilder::loadOrBuildScene(int boxCount, bool instanced,
+                                                       unsigned seed)
+{
+    QString path = sceneCachePath(boxCount, instanced, seed);
+    std::string fileName = QFile::encodeName(path).toStdString();
+    if (!path.isEmpty() && QFileInfo(path).exists()) {
+        osg::ref_ptr<osg::Node> cached = osgDB::readNodeFile(fileName);
+        if (cached.valid() && cached->getBound().valid()) {
+            setInstancedCallbacks(cached.get(), true);
+            return cached;
+        }
+        // Unreadable or empty, built and written again below
+        QFile::remove(path);
+    }
+
+    osg::ref_ptr<osg::Node> scene = buildScene(boxCount, instanced, seed);
+    if (!path.isEmpty() && QDir().mkpath(QFileInfo(path).absolutePath()))
+        writeScene(scene.get(), fileName);
+    return scene;
+}
+
+bool SceneBuilder::writeScene(osg::Node* scene, const std::string& fileName)
+{
+    // Written next to the target under a temporary name with the same
+    // extension, so osgDB picks the same plugin, then moved over it.  A
+    // crash or a concurrent reader never sees half a file.
+    QFileInfo info(QFile::decodeName(fileName.c_str()));
+    QTemporaryFile temp(info.absoluteDir().filePath(
+                            QString(".%1-XXXXXX.%2").arg(info.completeBaseName())
+                            .arg(info.suffix())));
+    if (!temp.open())
+        return false;
+    temp.close();
+
+    setInstancedCallbacks(scene, false);
+    bool written = osgDB::writeNodeFile(*scene, QFile::encodeName(temp.fileName()).toStdString());
+    setInstancedCallbacks(scene, true);
+    if (!written || !replaceFile(temp.fileName(), info.absoluteFilePath()))
+        return false;
+    temp.setAutoRemove(false);
+    return true;
+}
+
+// Floor and two walls meeting at the origin with a cube in the corner.
+// Occlusion should darken smoothly towards every crease.
+osg::ref_ptr<osg::Node> SceneBuilder::buildCorner()
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    osg::Vec4 grey(0.8f, 0.8f, 0.8f, 1.0f);
+
+    float size = 10.0f;
+    float thickness = 0.2f;
+    osg::Box* slabs[] = {
+        new osg::Box(osg::Vec3(size * 0.5f, size * 0.5f, -thickness * 0.5f),
+                     size, size, thickness),
+        new osg::Box(osg::Vec3(-thickness * 0.5f, size * 0.5f, size * 0.5f),
+                     thickness, size, size),
+        new osg::Box(osg::Vec3(size * 0.5f, -thickness * 0.5f, size * 0.5f),
+                     size, thickness, size),
+        new osg::Box(osg::Vec3(1.0f, 1.0f, 1.0f), 2.0f)
+    };
+    for (osg::Box* box : slabs) {
+        osg::ShapeDrawable *sd = new osg::ShapeDrawable(box);
+        sd->setColor(grey);
+        geode->addDrawable(sd);
+    }
+    return geode;
+}
+
+// A row of growing spheres resting on a plane, each with a contact
+// shadow underneath
+osg::ref_ptr<osg::Node> SceneBuilder::buildSpheresOnPlane()
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    osg::Vec4 grey(0.8f, 0.8f, 0.8f, 1.0f);
+
+    osg::ShapeDrawable *plane = new osg::ShapeDrawable(
+                new osg::Box(osg::Vec3(0.0f, 0.0f, -0.1f), 24.0f, 12.0f, 0.2f));
+    plane->setColor(grey);
+    geode->addDrawable(plane);
+
+    float x = -9.0f;
+    for (int i = 0 ; i < 4 ; i++ ) {
+        float radius = 0.75f + 0.5f * i;
+        x += radius;
+        osg::ShapeDrawable *sd = new osg::ShapeDrawable(
+                    new osg::Sphere(osg::Vec3(x, 0.0f, radius), radius));
+        sd->setColor(grey);
+        geode->addDrawable(sd);
+        x += radius + 0.5f;
+    }
+    return geode;
+}
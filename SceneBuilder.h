@@ -0,0 +1,36 @@
+#ifndef SCENEBUILDER_H
+#define SCENEBUILDER_H
+
+#include <osg/Geode>
+#include <osg/Node>
+#include <string>
+
+// Generates the test scene.  Kept free of any widget so the benchmark
+// can build exactly what the application shows.
+class SceneBuilder
+{
+    SceneBuilder() {}
+public:
+    static osg::ref_ptr<osg::Geode> buildAxes();
+    // Random boxes, the same for the same count and seed on any machine
+    // and thread count.  Instanced draws them all with one instanced draw
+    // call, which scales to hundreds of thousands of boxes, the default
+    // is a ShapeDrawable per box.
+    static osg::ref_ptr<osg::Node> buildScene(int boxCount = 5000,
+                                              bool instanced = false,
+                                              unsigned seed = 1);
+    // buildScene() through an .osgb cache in the user's cache directory,
+    // keyed by the parameters.  Slow, call it off the GUI thread.
+    static osg::ref_ptr<osg::Node> loadOrBuildScene(int boxCount = 5000,
+                                                    bool instanced = false,
+                                                    unsigned seed = 1);
+    // Leaves out what a file cannot hold, e.g. the instanced cull callback.
+    // The file is written under a temporary name and renamed over fileName.
+    static bool writeScene(osg::Node* scene, const std::string& fileName);
+
+    // Simple scenes whose occlusion is easy to judge by eye
+    static osg::ref_ptr<osg::Node> buildCorner();
+    static osg::ref_ptr<osg::Node> buildSpheresOnPlane();
+};
+
+#endif // SCENEBUILDER_H
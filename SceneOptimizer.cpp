@@ -0,0 +1,177 @@
+#include "SceneOptimizer.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osgUtil/Optimizer>
+
+#include <set>
+
+namespace {
+
+bool isInstanced(const osg::Drawable* drawable)
+{
+    const osg::Geometry* geometry = drawable->asGeometry();
+    if (!geometry)
+        return false;
+    for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); i++) {
+        if (geometry->getPrimitiveSet(i)->getNumInstances() > 0)
+            return true;
+    }
+    return false;
+}
+
+class StatisticsVisitor : public osg::NodeVisitor
+{
+public:
+    StatisticsVisitor() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Node& node)
+    {
+        statistics.nodes++;
+        countStateSet(node.getStateSet());
+        traverse(node);
+    }
+
+    // Drawables are only children of a Geode from OSG 3.6 on, so they are
+    // counted here rather than traversed
+    virtual void apply(osg::Geode& geode)
+    {
+        statistics.nodes++;
+        countStateSet(geode.getStateSet());
+        for (unsigned int i = 0; i < geode.getNumDrawables(); i++) {
+            const osg::Drawable* drawable = geode.getDrawable(i);
+            statistics.drawables++;
+            countStateSet(drawable->getStateSet());
+
+            const osg::Geometry* geometry = drawable->asGeometry();
+            if (!geometry) {
+                statistics.drawCalls++;
+                continue;
+            }
+            statistics.drawCalls += geometry->getNumPrimitiveSets();
+            if (geometry->getVertexArray())
+                statistics.vertices += geometry->getVertexArray()->getNumElements();
+        }
+    }
+
+    void finish()
+    {
+        statistics.stateSets = (unsigned int)m_stateSets.size();
+    }
+
+    SceneOptimizer::Statistics statistics;
+
+private:
+    void countStateSet(const osg::StateSet* stateSet)
+    {
+        if (!stateSet)
+            return;
+        statistics.stateSetRefs++;
+        m_stateSets.insert(stateSet);
+    }
+
+    std::set<const osg::StateSet*> m_stateSets;
+};
+
+// Display lists freeze a drawable at its first draw and are gone from
+// core profiles
+class VBOVisitor : public osg::NodeVisitor
+{
+public:
+    VBOVisitor() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Geode& geode)
+    {
+        for (unsigned int i = 0; i < geode.getNumDrawables(); i++) {
+            osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+            if (!geometry)
+                continue;
+            geometry->setUseDisplayList(false);
+            geometry->setUseVertexBufferObjects(true);
+        }
+    }
+};
+
+// Keeps every pass away from instanced geometry and the Geodes holding it
+class InstancedGuard : public osgUtil::Optimizer::IsOperationPermissibleForObjectCallback
+{
+public:
+    virtual bool isOperationPermissibleForObjectImplementation(
+            const osgUtil::Optimizer* optimizer, const osg::Drawable* drawable,
+            unsigned int option) const
+    {
+        return !isInstanced(drawable) &&
+                optimizer->isOperationPermissibleForObjectImplementation(drawable, option);
+    }
+
+    virtual bool isOperationPermissibleForObjectImplementation(
+            const osgUtil::Optimizer* optimizer, const osg::Node* node,
+            unsigned int option) const
+    {
+        const osg::Geode* geode = dynamic_cast<const osg::Geode*>(node);
+        if (geode) {
+            for (unsigned int i = 0; i < geode->getNumDrawables(); i++) {
+                if (isInstanced(geode->getDrawable(i)))
+                    return false;
+            }
+        }
+        return optimizer->isOperationPermissibleForObjectImplementation(node, option);
+    }
+};
+
+} // namespace
+
+SceneOptimizer::Statistics& SceneOptimizer::Statistics::operator+=(const Statistics& other)
+{
+    nodes += other.nodes;
+    drawables += other.drawables;
+    drawCalls += other.drawCalls;
+    vertices += other.vertices;
+    stateSets += other.stateSets;
+    stateSetRefs += other.stateSetRefs;
+    return *this;
+}
+
+SceneOptimizer::Statistics SceneOptimizer::collect(osg::Node* scene)
+{
+    StatisticsVisitor visitor;
+    if (scene)
+        scene->accept(visitor);
+    visitor.finish();
+    return visitor.statistics;
+}
+
+void SceneOptimizer::optimize(osg::Node* scene, const Options& options)
+{
+    if (!scene)
+        return;
+
+    // The Optimizer runs the passes in an order of its own
+    unsigned int passes = osgUtil::Optimizer::CHECK_GEOMETRY;
+    if (options.flattenTransforms)
+        passes |= osgUtil::Optimizer::FLATTEN_STATIC_TRANSFORMS |
+                osgUtil::Optimizer::REMOVE_REDUNDANT_NODES |
+                osgUtil::Optimizer::REMOVE_LOADED_PROXY_NODES |
+                osgUtil::Optimizer::COMBINE_ADJACENT_LODS |
+                osgUtil::Optimizer::STATIC_OBJECT_DETECTION;
+    if (options.mergeGeometry)
+        passes |= osgUtil::Optimizer::MERGE_GEODES |
+                osgUtil::Optimizer::MERGE_GEOMETRY;
+    if (options.shareState)
+        passes |= osgUtil::Optimizer::SHARE_DUPLICATE_STATE;
+    if (options.indexMeshes)
+        passes |= osgUtil::Optimizer::INDEX_MESH;
+    if (options.reorderVertices)
+        passes |= osgUtil::Optimizer::VERTEX_POSTTRANSFORM |
+                osgUtil::Optimizer::VERTEX_PRETRANSFORM;
+
+    osgUtil::Optimizer optimizer;
+    optimizer.setIsOperationPermissibleForObjectCallback(new InstancedGuard);
+    optimizer.optimize(scene, passes);
+
+    if (options.useVBOs) {
+        VBOVisitor visitor;
+        scene->accept(visitor);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SCENEOPTIMIZER_H
+#define SCENEOPTIMIZER_H
+
+#include <osg/Node>
+
+// Post-load clean up for models that come off disk as thousands of small
+// Geodes with duplicate state, plain triangle lists and display lists.
+// ModelLoader runs it on its worker threads.  Geometry drawn instanced is
+// left alone, merging or reindexing it would break its per instance
+// attributes.
+class SceneOptimizer
+{
+    SceneOptimizer() {}
+public:
+    struct Options {
+        bool flattenTransforms = true; // bake static transforms, drop empty groups
+        bool mergeGeometry = true;     // Geodes and Geometries of equal state
+        bool shareState = true;        // one StateSet per distinct state
+        bool indexMeshes = true;       // DrawElements instead of plain arrays
+        bool reorderVertices = true;   // post-transform vertex cache order
+        bool useVBOs = true;           // instead of display lists
+    };
+
+    // What the G-buffer pass traverses.  Shared subgraphs count once per
+    // parent, as they are drawn.
+    struct Statistics {
+        unsigned int nodes = 0;
+        unsigned int drawables = 0;
+        unsigned int drawCalls = 0;    // primitive sets, one per other drawable
+        unsigned int vertices = 0;     // vertex array elements
+        unsigned int stateSets = 0;    // distinct StateSets
+        unsigned int stateSetRefs = 0; // nodes and drawables with a StateSet
+
+        Statistics& operator+=(const Statistics& other);
+    };
+
+    static Statistics collect(osg::Node* scene);
+    static void optimize(osg::Node* scene, const Options& options = Options());
+};
+
+#endif // SCENEOPTIMIZER_H
@@ -0,0 +1,194 @@
+#include "ScenePager.h"
+
+#include <osg/PagedLOD>
+#include <osg/Polytope>
+#include <osg/Transform>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Walks the scene like a cull traversal of a wider frustum, so PagedLODs
+// around the view request their tiles.  Nothing is drawn and the time
+// stamps PagedLOD expiry goes by are left to the real cull traversals.
+class PrefetchVisitor : public osg::NodeVisitor
+{
+public:
+    PrefetchVisitor(const osg::Matrixd& viewMatrix, const osg::Matrixd& projection)
+        : osg::NodeVisitor(NODE_VISITOR, TRAVERSE_ACTIVE_CHILDREN)
+        , m_view(viewMatrix)
+        , m_projection(projection)
+    {
+        pushMatrix(osg::Matrixd::identity());
+    }
+
+    // PagedLOD picks its range from these
+    virtual osg::Vec3 getEyePoint() const { return m_eyes.back(); }
+    virtual osg::Vec3 getViewPoint() const { return m_eyes.back(); }
+    virtual float getDistanceToEyePoint(const osg::Vec3& pos, bool) const
+    {
+        return (pos - m_eyes.back()).length();
+    }
+    virtual float getDistanceFromEyePoint(const osg::Vec3& pos, bool) const
+    {
+        return (pos - m_eyes.back()).length();
+    }
+    virtual float getDistanceToViewPoint(const osg::Vec3& pos, bool) const
+    {
+        return (pos - m_eyes.back()).length();
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (!inView(node))
+            return;
+        traverse(node);
+    }
+
+    virtual void apply(osg::Transform& transform)
+    {
+        if (!inView(transform))
+            return;
+        osg::Matrix matrix = m_matrices.back();
+        transform.computeLocalToWorldMatrix(matrix, this);
+        pushMatrix(matrix);
+        traverse(transform);
+        popMatrix();
+    }
+
+private:
+    bool inView(osg::Node& node)
+    {
+        const osg::BoundingSphere& bound = node.getBound();
+        return bound.valid() && m_frustums.back().contains(bound);
+    }
+
+    void pushMatrix(const osg::Matrixd& localToWorld)
+    {
+        osg::Matrixd modelView = localToWorld * m_view;
+        osg::Polytope frustum;
+        frustum.setToUnitFrustum();
+        frustum.transformProvidingInverse(modelView * m_projection);
+
+        m_matrices.push_back(localToWorld);
+        m_frustums.push_back(frustum);
+        m_eyes.push_back(osg::Vec3(osg::Matrixd::inverse(modelView).getTrans()));
+    }
+
+    void popMatrix()
+    {
+        m_matrices.pop_back();
+        m_frustums.pop_back();
+        m_eyes.pop_back();
+    }
+
+    osg::Matrixd m_view;
+    osg::Matrixd m_projection;
+    std::vector<osg::Matrixd> m_matrices; // local to world
+    std::vector<osg::Polytope> m_frustums; // in local coordinates
+    std::vector<osg::Vec3> m_eyes;         // same
+};
+
+// Finds out whether a graph holds any PagedLOD
+class PagedLODFinder : public osg::NodeVisitor
+{
+public:
+    PagedLODFinder()
+        : osg::NodeVisitor(NODE_VISITOR, TRAVERSE_ALL_CHILDREN)
+        , found(false)
+    {}
+
+    virtual void apply(osg::PagedLOD&) { found = true; }
+    virtual void apply(osg::Node& node) { if (!found) traverse(node); }
+
+    bool found;
+};
+
+} // namespace
+
+// Counts the update traversals that merged tiles
+class ScenePager::Pager : public osgDB::DatabasePager
+{
+public:
+    Pager() : m_mergeRevision(0) {}
+
+    virtual void updateSceneGraph(const osg::FrameStamp& frameStamp)
+    {
+        unsigned int merged = _numTilesMerges;
+        osgDB::DatabasePager::updateSceneGraph(frameStamp);
+        if (_numTilesMerges != merged)
+            m_mergeRevision++;
+    }
+
+    unsigned int mergeRevision() const { return m_mergeRevision; }
+
+private:
+    unsigned int m_mergeRevision; // only touched by the update traversal
+};
+
+ScenePager::ScenePager()
+    : m_pager(new Pager)
+    , m_memoryBudget(0)
+    , m_prefetchScale(1.5)
+{
+    setMemoryBudget(1024);
+}
+
+void ScenePager::attach(osgViewer::View* view)
+{
+    view->setDatabasePager(m_pager.get());
+}
+
+void ScenePager::setMemoryBudget(unsigned int megabytes)
+{
+    // An indexed triangle takes about 36 bytes: three indices plus half a
+    // vertex with normal and color.  Once on the host, once on the GPU.
+    const size_t tileBytes = size_t(DefaultTileTriangles) * 36 * 2;
+    size_t tiles = size_t(megabytes) * 1024 * 1024 / tileBytes;
+
+    m_memoryBudget = megabytes;
+    m_pager->setTargetMaximumNumberOfPageLOD((unsigned int)std::max<size_t>(tiles, 1));
+}
+
+void ScenePager::prefetch(osgViewer::View* view, osg::Node* scene)
+{
+    if (!scene || m_prefetchScale <= 1.0)
+        return;
+
+    // Scaling clip space x and y widens the frustum around the view axis
+    osg::Camera* camera = view->getCamera();
+    osg::Matrixd projection = camera->getProjectionMatrix() *
+            osg::Matrixd::scale(1.0 / m_prefetchScale, 1.0 / m_prefetchScale, 1.0);
+
+    PrefetchVisitor visitor(camera->getViewMatrix(), projection);
+    visitor.setDatabaseRequestHandler(m_pager.get());
+    visitor.setFrameStamp(view->getFrameStamp());
+    scene->accept(visitor);
+}
+
+bool ScenePager::isLoading() const
+{
+    return m_pager->getRequestsInProgress();
+}
+
+unsigned int ScenePager::mergeRevision() const
+{
+    return m_pager->mergeRevision();
+}
+
+osgDB::DatabasePager* ScenePager::databasePager() const
+{
+    return m_pager.get();
+}
+
+osg::ref_ptr<osg::Node> ScenePager::instance(osg::Node* node)
+{
+    PagedLODFinder finder;
+    node->accept(finder);
+    if (!finder.found)
+        return node;
+
+    // Drawables are copied only with DEEP_COPY_DRAWABLES
+    return static_cast<osg::Node*>(node->clone(osg::CopyOp::DEEP_COPY_NODES));
+}
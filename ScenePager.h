@@ -0,0 +1,62 @@
+#ifndef SCENEPAGER_H
+#define SCENEPAGER_H
+
+#include <osg/Node>
+#include <osgDB/DatabasePager>
+#include <osgViewer/View>
+
+// Pages osg::PagedLOD hierarchies, such as the tiles ssao_tiler writes,
+// for one view.  A DatabasePager goes by the frame numbers of the viewer
+// it is attached to, and a PagedLOD keeps the frame it was last drawn
+// in, so neither can be shared by viewers that count frames on their
+// own.  Every view gets its own ScenePager and its own instance() of the
+// scene.  The view calls prefetch() after frame(), keeps drawing while
+// isLoading() and redraws when mergeRevision() grows.
+class ScenePager : public osg::Referenced
+{
+public:
+    // Triangles per tile ssao_tiler writes by default.  The memory budget
+    // is converted to a tile count with it.
+    static const int DefaultTileTriangles = 32768;
+
+    ScenePager();
+
+    void attach(osgViewer::View* view);
+
+    // Approximate host plus GPU memory of the loaded tiles.  Tiles outside
+    // the view are expired down to it.
+    void setMemoryBudget(unsigned int megabytes);
+    unsigned int memoryBudget() const { return m_memoryBudget; }
+
+    // Tiles are requested for a field of view this much wider than the
+    // camera's, so turning the view finds them loaded.  1 disables it.
+    void setPrefetchScale(double scale) { m_prefetchScale = scale; }
+    double prefetchScale() const { return m_prefetchScale; }
+
+    // Requests the tiles around the view's camera for the frame just drawn
+    void prefetch(osgViewer::View* view, osg::Node* scene);
+
+    // True while tiles are being read, compiled or wait to be merged
+    bool isLoading() const;
+    // Grows whenever the view's update traversal merged tiles into the
+    // scene.  The scene bound stays the same, so SSAONode has to be told.
+    unsigned int mergeRevision() const;
+
+    osgDB::DatabasePager* databasePager() const;
+
+    // Returns node itself, or a copy of its nodes for another view if it
+    // holds PagedLODs.  Geometry and state are shared.
+    static osg::ref_ptr<osg::Node> instance(osg::Node* node);
+
+protected:
+    virtual ~ScenePager() {}
+
+private:
+    class Pager;
+
+    osg::ref_ptr<Pager> m_pager;
+    unsigned int m_memoryBudget;
+    double m_prefetchScale;
+};
+
+#endif // SCENEPAGER_H
@@ -0,0 +1,70 @@
+#include "UniformBlock.h"
+#include <osg/Version>
+#include <cstring>
+
+UniformBlock::UniformBlock(const std::string& name, unsigned int bindingIndex,
+                           unsigned int size)
+    : m_name(name)
+    , m_bindingIndex(bindingIndex)
+    , m_data(new osg::UByteArray(size))
+    , m_buffer(new osg::UniformBufferObject)
+{
+    m_data->setBufferObject(m_buffer.get());
+#if OSG_VERSION_GREATER_OR_EQUAL(3, 6, 0)
+    m_binding = new osg::UniformBufferBinding(bindingIndex, m_data.get(), 0, size);
+#else
+    m_binding = new osg::UniformBufferBinding(bindingIndex, m_buffer.get(), 0, size);
+#endif
+}
+
+void UniformBlock::bind(osg::StateSet* stateset) const
+{
+    stateset->setAttributeAndModes(m_binding.get());
+}
+
+void UniformBlock::bind(osg::Program* program) const
+{
+    program->addBindUniformBlock(m_name, m_bindingIndex);
+}
+
+void UniformBlock::set(unsigned int offset, float value)
+{
+    write(offset, &value, sizeof(value));
+}
+
+void UniformBlock::set(unsigned int offset, int value)
+{
+    write(offset, &value, sizeof(value));
+}
+
+void UniformBlock::set(unsigned int offset, const osg::Vec2f& value)
+{
+    write(offset, value.ptr(), sizeof(float) * 2);
+}
+
+void UniformBlock::set(unsigned int offset, const osg::Vec2i& value)
+{
+    write(offset, value.ptr(), sizeof(int) * 2);
+}
+
+void UniformBlock::set(unsigned int offset, const osg::Vec4f& value)
+{
+    write(offset, value.ptr(), sizeof(float) * 4);
+}
+
+void UniformBlock::set(unsigned int offset, const osg::Matrixf& value)
+{
+    // OSG's row vector layout is what GLSL reads as column major, the
+    // same 16 floats glUniformMatrix4fv would get
+    write(offset, value.ptr(), sizeof(float) * 16);
+}
+
+void UniformBlock::write(unsigned int offset, const void* data, unsigned int size)
+{
+    unsigned char* target = &(*m_data)[offset];
+    if (std::memcmp(target, data, size) == 0)
+        return;
+
+    std::memcpy(target, data, size);
+    m_data->dirty();
+}
@@ -0,0 +1,50 @@
+#ifndef UNIFORMBLOCK_H
+#define UNIFORMBLOCK_H
+
+#include <osg/Array>
+#include <osg/BufferIndexBinding>
+#include <osg/BufferObject>
+#include <osg/Matrixf>
+#include <osg/Program>
+#include <osg/StateSet>
+#include <osg/Vec2f>
+#include <osg/Vec2i>
+#include <osg/Vec4f>
+#include <string>
+
+// A std140 uniform block in a uniform buffer object.  Values are written
+// at their std140 byte offsets.  Only a write that changes the contents
+// marks the buffer for upload, so a value set every frame costs a compare
+// until it actually changes.
+class UniformBlock : public osg::Referenced
+{
+public:
+    UniformBlock(const std::string& name, unsigned int bindingIndex,
+                 unsigned int size);
+
+    // Makes the buffer current for everything below the state set
+    void bind(osg::StateSet* stateset) const;
+    // Points the program's block of this name at the binding index
+    void bind(osg::Program* program) const;
+
+    void set(unsigned int offset, float value);
+    void set(unsigned int offset, int value);
+    void set(unsigned int offset, const osg::Vec2f& value);
+    void set(unsigned int offset, const osg::Vec2i& value);
+    void set(unsigned int offset, const osg::Vec4f& value);
+    void set(unsigned int offset, const osg::Matrixf& value);
+
+protected:
+    virtual ~UniformBlock() {}
+
+private:
+    void write(unsigned int offset, const void* data, unsigned int size);
+
+    std::string m_name;
+    unsigned int m_bindingIndex;
+    osg::ref_ptr<osg::UByteArray> m_data;
+    osg::ref_ptr<osg::UniformBufferObject> m_buffer;
+    osg::ref_ptr<osg::UniformBufferBinding> m_binding;
+};
+
+#endif // UNIFORMBLOCK_H
@@ -0,0 +1,236 @@
+#include "OffscreenRenderer.h"
+
+#include <osg/GL>
+#include <osg/LightModel>
+#include <osg/State>
+#include <osg/Timer>
+#include <osgViewer/Renderer>
+
+#include <algorithm>
+#include <cmath>
+
+OffscreenRenderer::OffscreenRenderer(int width, int height, SSAONode* ssao,
+                                     int statsFrames, SSAONode* secondSSAO)
+    : m_width(width)
+    , m_height(height)
+    , m_ssao(ssao)
+    , m_secondSSAO(secondSSAO)
+    , m_root(new osg::Switch)
+    , m_secondRoot(new osg::Switch)
+    , m_scene(new osg::Group)
+    , m_cameraModel(new CameraModel)
+{
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits =
+            new osg::GraphicsContext::Traits;
+    traits->readDISPLAY();
+    traits->setUndefinedScreenDetailsToDefaultScreen();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = secondSSAO ? width * 2 : width;
+    traits->height = height;
+    traits->windowDecoration = false;
+    traits->doubleBuffer = false;
+    traits->pbuffer = true;
+    traits->sharedContext = 0;
+
+    m_gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if (!m_gc.valid())
+        return;
+
+    // Same graph the widgets build
+    SSAONode::buildGraph(m_root, m_scene, m_ssao);
+    SSAONode::setSSAOEnabled(m_root, m_scene, m_ssao, true);
+
+    m_viewer = new osgViewer::Viewer;
+    m_viewer->setThreadingModel(osgViewer::Viewer::SingleThreaded);
+    m_viewer->setSceneData(m_root);
+
+    osg::Camera *cam = m_viewer->getCamera();
+    cam->setGraphicsContext(m_gc.get());
+    cam->setViewport(new osg::Viewport(0, 0, width, height));
+    cam->setDrawBuffer(GL_FRONT);
+    cam->setReadBuffer(GL_FRONT);
+    cam->setCullMask((unsigned)~0);
+    cam->setDataVariance(osg::Object::DYNAMIC);
+
+    // The GPU timer fills in its attribute a few frames late
+    m_stats = new osg::Stats("Camera", statsFrames + GpuQueryLatency);
+    m_stats->collectStats("gpu", true);
+    cam->setStats(m_stats.get());
+
+    // Cameras of one context draw one after another, each with its
+    // SSAONode's passes, as the views of a CompositeViewer would
+    osg::ref_ptr<osg::Camera> slave;
+    if (m_secondSSAO.valid()) {
+        SSAONode::buildGraph(m_secondRoot, m_scene, m_secondSSAO);
+        SSAONode::setSSAOEnabled(m_secondRoot, m_scene, m_secondSSAO, true);
+
+        slave = new osg::Camera;
+        slave->setGraphicsContext(m_gc.get());
+        slave->setViewport(new osg::Viewport(width, 0, width, height));
+        slave->setDrawBuffer(GL_FRONT);
+        slave->setReadBuffer(GL_FRONT);
+        slave->setCullMask((unsigned)~0);
+        slave->addChild(m_secondRoot);
+        m_viewer->addSlave(slave.get(), false);
+    }
+
+    m_viewer->realize();
+
+    // draw both sides of polygons, as the widgets do
+    osg::ref_ptr<osg::LightModel> lm = new osg::LightModel;
+    lm->setTwoSided(true);
+    lm->setAmbientIntensity(osg::Vec4(0.1f,0.1f,0.1f,1.0f));
+    osg::Camera* cameras[] = {cam, slave.get()};
+    for (osg::Camera* camera : cameras) {
+        if (!camera)
+            continue;
+        osgViewer::Renderer *renderer =
+                static_cast<osgViewer::Renderer *>(camera->getRenderer());
+        for (int i=0 ; i < 2 ; i++ )
+            renderer->getSceneView(i)->getGlobalStateSet()
+                    ->setAttributeAndModes(lm, osg::StateAttribute::ON);
+    }
+
+    m_cameraModel->setBoundingNode(m_scene);
+    m_cameraModel->setAspect((double)width / (double)height);
+}
+
+void OffscreenRenderer::setScene(osg::Node* node)
+{
+    m_scene->removeChildren(0, m_scene->getNumChildren());
+    m_scene->addChild(node);
+    m_ssao->DirtyScene();
+    if (m_secondSSAO.valid())
+        m_secondSSAO->DirtyScene();
+    m_cameraModel->computeInitialView();
+}
+
+double OffscreenRenderer::frame()
+{
+    osg::Camera *cam = m_viewer->getCamera();
+    cam->setViewMatrix(m_cameraModel->getModelViewMatrix());
+    cam->setProjectionMatrix(m_cameraModel->computeProjection());
+    m_ssao->updateProjectionMatrix(cam->getProjectionMatrix());
+    m_ssao->updateViewMatrix(cam->getViewMatrix());
+    if (m_secondSSAO.valid()) {
+        m_secondSSAO->updateProjectionMatrix(cam->getProjectionMatrix());
+        m_secondSSAO->updateViewMatrix(cam->getViewMatrix());
+    }
+
+    osg::Timer *timer = osg::Timer::instance();
+    osg::Timer_t start = timer->tick();
+    m_viewer->frame();
+    return timer->delta_m(start, timer->tick());
+}
+
+unsigned int OffscreenRenderer::frameNumber() const
+{
+    return m_viewer->getFrameStamp()->getFrameNumber();
+}
+
+bool OffscreenRenderer::gpuTime(unsigned int frameNumber, double& ms) const
+{
+    double seconds;
+    if (!m_stats->getAttribute(frameNumber, "GPU draw time taken", seconds))
+        return false;
+    ms = seconds * 1000.0;
+    return true;
+}
+
+osg::ref_ptr<osg::Image> OffscreenRenderer::readImage()
+{
+    // The viewer releases the context at the end of every frame
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    m_gc->makeCurrent();
+    glReadBuffer(GL_FRONT);
+    int width = m_secondSSAO.valid() ? m_width * 2 : m_width;
+    image->readPixels(0, 0, width, m_height, GL_RGB, GL_UNSIGNED_BYTE);
+    m_gc->releaseContext();
+    return image;
+}
+
+bool OffscreenRenderer::readGBuffer(std::vector<float>& depth,
+                                    std::vector<osg::Vec3f>& normals)
+{
+    osg::Texture2D* depthTex = m_ssao->GetDepthTexture();
+    osg::Texture2D* normalTex = m_ssao->GetNormalTexture();
+    if (!depthTex || !normalTex ||
+            m_ssao->GetGBufferLayout() != SSAONode::GBuffer_Classic)
+        return false;
+
+    int texWidth = depthTex->getTextureWidth();
+    int texHeight = depthTex->getTextureHeight();
+    if (texWidth < m_width || texHeight < m_height)
+        return false;
+    std::vector<float> depthTexels(size_t(texWidth) * texHeight);
+    std::vector<unsigned char> normalTexels(size_t(texWidth) * texHeight * 3);
+
+    // Bound through the state, so the next frame knows what unit 0 holds
+    m_gc->makeCurrent();
+    osg::State* state = m_gc->getState();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    state->applyTextureAttribute(0, depthTex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &depthTexels[0]);
+    state->applyTextureAttribute(0, normalTex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, &normalTexels[0]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    m_gc->releaseContext();
+
+    // n * 0.5 + 0.5 in RGB8, decoded as common.glsl does
+    depth.resize(size_t(m_width) * m_height);
+    normals.resize(depth.size());
+    for (int y = 0 ; y < m_height ; y++) {
+        for (int x = 0 ; x < m_width ; x++) {
+            size_t texel = size_t(y) * texWidth + x;
+            size_t pixel = size_t(y) * m_width + x;
+            const unsigned char* n = &normalTexels[texel * 3];
+            depth[pixel] = depthTexels[texel];
+            normals[pixel].set(n[0] / 255.0f * 2.0f - 1.0f,
+                               n[1] / 255.0f * 2.0f - 1.0f,
+                               n[2] / 255.0f * 2.0f - 1.0f);
+        }
+    }
+    return true;
+}
+
+osg::Matrixd OffscreenRenderer::projectionMatrix() const
+{
+    return m_viewer->getCamera()->getProjectionMatrix();
+}
+
+QJsonObject OffscreenRenderer::glInfo()
+{
+    QJsonObject info;
+    m_gc->makeCurrent();
+    info["vendor"] = (const char *)glGetString(GL_VENDOR);
+    info["renderer"] = (const char *)glGetString(GL_RENDERER);
+    info["version"] = (const char *)glGetString(GL_VERSION);
+    m_gc->releaseContext();
+    return info;
+}
+
+QJsonObject summarizeTimes(std::vector<double> times)
+{
+    QJsonObject o;
+    if (times.empty())
+        return o;
+
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double t : times)
+        sum += t;
+
+    auto percentile = [&times](double p) {
+        size_t rank = size_t(std::ceil(p / 100.0 * times.size()));
+        return times[std::max<size_t>(rank, 1) - 1];
+    };
+    o["mean"] = sum / times.size();
+    o["min"] = times.front();
+    o["p50"] = percentile(50.0);
+    o["p90"] = percentile(90.0);
+    o["p95"] = percentile(95.0);
+    o["p99"] = percentile(99.0);
+    o["max"] = times.back();
+    return o;
+}
@@ -0,0 +1,73 @@
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+#include "SSAONode.h"
+#include "CameraModel.h"
+
+#include <QJsonObject>
+#include <osg/Image>
+#include <osg/Stats>
+#include <osgViewer/Viewer>
+#include <vector>
+
+// Renders the SSAO graph into a pbuffer the way the widgets render it
+// into a window.  Shared by the orbit benchmark and the regression suite.
+class OffscreenRenderer
+{
+public:
+    // Frames the GPU timer queries trail the frame that issued them
+    static const int GpuQueryLatency = 4;
+
+    // statsFrames is how many frames back gpuTime() can look.  With a
+    // secondSSAO the pbuffer is twice as wide: a slave camera on the same
+    // context draws that node's view of the scene into the right half,
+    // after ssao has drawn the left one.
+    OffscreenRenderer(int width, int height, SSAONode* ssao, int statsFrames,
+                      SSAONode* secondSSAO = nullptr);
+
+    // False when no pbuffer could be created
+    bool isValid() const { return m_viewer.valid(); }
+
+    SSAONode* ssao() { return m_ssao.get(); }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    CameraModel* cameraModel() { return m_cameraModel.get(); }
+
+    // Replaces what is drawn and fits the camera to it
+    void setScene(osg::Node* node);
+
+    // Renders one frame from the camera model, returns its CPU time in
+    // milliseconds
+    double frame();
+    unsigned int frameNumber() const;
+    bool gpuTime(unsigned int frameNumber, double& ms) const;
+
+    // Color buffer of the last frame, RGB8, both views
+    osg::ref_ptr<osg::Image> readImage();
+    // Depth buffer values and view space normals of the last frame's
+    // G-buffer, rows from the bottom like readImage().  False unless the
+    // node uses GBuffer_Classic.
+    bool readGBuffer(std::vector<float>& depth, std::vector<osg::Vec3f>& normals);
+    osg::Matrixd projectionMatrix() const;
+
+    // GL_VENDOR, GL_RENDERER and GL_VERSION
+    QJsonObject glInfo();
+
+private:
+    int m_width;
+    int m_height;
+    osg::ref_ptr<osg::GraphicsContext> m_gc;
+    osg::ref_ptr<osgViewer::Viewer> m_viewer;
+    osg::ref_ptr<osg::Stats> m_stats;
+    osg::ref_ptr<SSAONode> m_ssao;
+    osg::ref_ptr<SSAONode> m_secondSSAO;
+    osg::ref_ptr<osg::Switch> m_root;
+    osg::ref_ptr<osg::Switch> m_secondRoot;
+    osg::ref_ptr<osg::Group> m_scene;
+    osg::ref_ptr<CameraModel> m_cameraModel;
+};
+
+// Mean, min, max and nearest rank percentiles of times in milliseconds
+QJsonObject summarizeTimes(std::vector<double> times);
+
+#endif // OFFSCREENRENDERER_H
@@ -0,0 +1,373 @@
+#include "RegressionSuite.h"
+#include "OffscreenRenderer.h"
+#include "SceneBuilder.h"
+#include "SSAOReference.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+RegressionSuite::RegressionSuite(OffscreenRenderer& renderer,
+                                 const Options& options)
+    : m_renderer(renderer)
+    , m_options(options)
+    , m_passed(true)
+{
+    if (options.baseline.isEmpty())
+        return;
+
+    QFile file(options.baseline);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    QJsonObject report = QJsonDocument::fromJson(file.readAll()).object();
+    for (const QJsonValue& entry : report["configurations"].toArray())
+        m_baseline[entry.toObject()["name"].toString()] = entry;
+}
+
+int RegressionSuite::framesPerConfiguration(const Options& options)
+{
+    return options.warmup + options.frames + OffscreenRenderer::GpuQueryLatency;
+}
+
+QJsonObject RegressionSuite::run()
+{
+    struct SceneCase {
+        const char* name;
+        osg::ref_ptr<osg::Node> node;
+        osg::Vec2d azEl; // fixed view
+    } scenes[] = {
+        {"boxes", SceneBuilder::buildScene(m_options.boxes, m_options.instanced), osg::Vec2d(30.0, 20.0)},
+        {"corner", SceneBuilder::buildCorner(), osg::Vec2d(-135.0, 30.0)},
+        {"spheres", SceneBuilder::buildSpheresOnPlane(), osg::Vec2d(-70.0, 25.0)},
+    };
+    struct ModeCase {
+        const char* name;
+        SSAONode::DisplayMode mode;
+    } modes[] = {
+        {"color", SSAONode::SSAO_ColorOnly},
+        {"color_ao", SSAONode::SSAO_ColorAndAO},
+        {"ao", SSAONode::SSAO_AOOnly},
+    };
+
+    SSAONode* ssao = m_renderer.ssao();
+    QJsonArray configurations;
+
+    for (SceneCase& scene : scenes) {
+        m_renderer.setScene(scene.node.get());
+        m_renderer.cameraModel()->setViewDirFromAzEl(scene.azEl);
+
+        for (ModeCase& mode : modes) {
+            for (int halo = 1; halo >= 0; halo--) {
+                for (int blur = 1; blur >= 0; blur--) {
+                    // Color only shows no occlusion, one run covers it
+                    bool colorOnly = mode.mode == SSAONode::SSAO_ColorOnly;
+                    if (colorOnly && (!halo || !blur))
+                        continue;
+
+                    QString name = QString("%1-%2").arg(scene.name).arg(mode.name);
+                    if (!colorOnly) {
+                        name += halo ? "-halo" : "-nohalo";
+                        name += blur ? "-blur" : "-noblur";
+                    }
+
+                    ssao->SetDisplayMode(mode.mode);
+                    ssao->setHaloRemovalEnabled(halo != 0);
+                    ssao->setAOBlurEnabled(blur != 0);
+
+                    // The view does not move, so have every frame recompute
+                    // the occlusion rather than only composite it
+                    std::vector<unsigned int> frameNumbers;
+                    std::vector<double> cpuTimes;
+                    for (int i = 0 ; i < framesPerConfiguration(m_options) ; i++) {
+                        ssao->DirtyScene();
+                        double cpuMs = m_renderer.frame();
+                        if (i >= m_options.warmup &&
+                                i < m_options.warmup + m_options.frames) {
+                            frameNumbers.push_back(m_renderer.frameNumber());
+                            cpuTimes.push_back(cpuMs);
+                        }
+                    }
+
+                    std::vector<double> gpuTimes;
+                    for (unsigned int frameNumber : frameNumbers) {
+                        double gpuMs;
+                        if (m_renderer.gpuTime(frameNumber, gpuMs))
+                            gpuTimes.push_back(gpuMs);
+                    }
+
+                    QJsonObject cpu = summarizeTimes(cpuTimes);
+                    QJsonObject gpu = summarizeTimes(gpuTimes);
+
+                    QJsonObject configuration;
+                    configuration["name"] = name;
+                    configuration["cpu_ms"] = cpu;
+                    configuration["gpu_ms"] = gpuTimes.empty() ?
+                                QJsonValue(QJsonValue::Null) : gpu;
+                    configuration["image"] = compareImage(name);
+                    configuration["performance"] = comparePerformance(name, cpu, gpu);
+                    configurations.append(configuration);
+                }
+            }
+        }
+    }
+
+    QJsonObject sharedPool = compareSharedPool(scenes[2].node.get(), scenes[2].azEl);
+
+    // The reference implements the full resolution hemisphere kernel on a
+    // classic G-buffer, without the temporal or deinterleaved modes
+    ssao->SetAOAlgorithm(SSAONode::AO_HemisphereKernel);
+    ssao->SetAOResolution(SSAONode::AO_FullRes);
+    ssao->SetGBufferLayout(SSAONode::GBuffer_Classic);
+    ssao->SetTemporalEnabled(false);
+    ssao->SetDeinterleavedEnabled(false);
+    ssao->SetOcclusionCullingEnabled(false);
+    ssao->SetDisplayMode(SSAONode::SSAO_AOOnly);
+    ssao->setHaloRemovalEnabled(true);
+    ssao->setAOBlurEnabled(true);
+
+    QJsonArray references;
+    for (SceneCase& scene : scenes) {
+        m_renderer.setScene(scene.node.get());
+        m_renderer.cameraModel()->setViewDirFromAzEl(scene.azEl);
+        // Switching the layout takes effect a frame late
+        for (int i = 0 ; i < 2 || (ssao->NeedsRedraw() && i < 10) ; i++)
+            m_renderer.frame();
+        references.append(compareReference(scene.name));
+    }
+
+    QJsonObject report;
+    report["configurations"] = configurations;
+    report["shared_pool"] = sharedPool;
+    report["reference"] = references;
+    report["passed"] = m_passed;
+    return report;
+}
+
+QJsonObject RegressionSuite::compareImage(const QString& name)
+{
+    QJsonObject result;
+    osg::ref_ptr<osg::Image> image = m_renderer.readImage();
+    QString path = QDir(m_options.goldenDir).filePath(name + ".png");
+
+    if (m_options.updateGolden) {
+        QDir().mkpath(m_options.goldenDir);
+        bool written = osgDB::writeImageFile(*image, path.toStdString());
+        result["golden"] = written ? "written" : "write failed";
+        result["passed"] = written;
+        m_passed = m_passed && written;
+        return result;
+    }
+
+    osg::ref_ptr<osg::Image> golden = osgDB::readImageFile(path.toStdString());
+    if (!golden.valid() || golden->s() != image->s() || golden->t() != image->t()) {
+        result["golden"] = golden.valid() ? "size differs" : "missing";
+        result["passed"] = false;
+        m_passed = false;
+        return result;
+    }
+
+    // Compare luma of the (gamma encoded) colors.  The difference is box
+    // filtered over 3x3 pixels first, so rasterization noise along edges
+    // averages out while a visible change in shading does not.
+    int width = image->s();
+    int height = image->t();
+    std::vector<float> diff(size_t(width) * height);
+    double squaredError = 0.0;
+    for (int y = 0 ; y < height ; y++) {
+        for (int x = 0 ; x < width ; x++) {
+            osg::Vec4 a = image->getColor(x, y) * 255.0f;
+            osg::Vec4 b = golden->getColor(x, y) * 255.0f;
+            osg::Vec4 d = a - b;
+            squaredError += d.r() * d.r() + d.g() * d.g() + d.b() * d.b();
+            diff[size_t(y) * width + x] =
+                    0.2126f * d.r() + 0.7152f * d.g() + 0.0722f * d.b();
+        }
+    }
+
+    int changed = 0;
+    float maxDifference = 0.0f;
+    for (int y = 0 ; y < height ; y++) {
+        for (int x = 0 ; x < width ; x++) {
+            float sum = 0.0f;
+            int count = 0;
+            for (int j = std::max(y - 1, 0) ; j <= std::min(y + 1, height - 1) ; j++) {
+                for (int i = std::max(x - 1, 0) ; i <= std::min(x + 1, width - 1) ; i++) {
+                    sum += diff[size_t(j) * width + i];
+                    count++;
+                }
+            }
+            float difference = std::fabs(sum / count);
+            maxDifference = std::max(maxDifference, difference);
+            if (difference > m_options.pixelTolerance)
+                changed++;
+        }
+    }
+
+    double changedPercent = 100.0 * changed / (double(width) * height);
+    double mse = squaredError / (3.0 * width * height);
+    bool passed = changedPercent <= m_options.imageTolerance;
+
+    result["changed_pixels_percent"] = changedPercent;
+    result["max_difference"] = maxDifference;
+    result["psnr"] = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 100.0;
+    result["passed"] = passed;
+    m_passed = m_passed && passed;
+    return result;
+}
+
+QJsonObject RegressionSuite::compareReference(const QString& name)
+{
+    QJsonObject result;
+    result["name"] = name;
+
+    std::vector<float> depth;
+    std::vector<osg::Vec3f> normals;
+    if (!m_renderer.readGBuffer(depth, normals)) {
+        result["error"] = "G-buffer not readable";
+        result["passed"] = false;
+        m_passed = false;
+        return result;
+    }
+    osg::ref_ptr<osg::Image> image = m_renderer.readImage();
+
+    int width = m_renderer.width();
+    int height = m_renderer.height();
+    size_t pixels = size_t(width) * height;
+    osg::Matrixf projection(m_renderer.projectionMatrix());
+    SSAONode* ssao = m_renderer.ssao();
+
+    // Every pixel runs the same code whichever thread takes its row, so
+    // one thread and all of them have to agree bit for bit
+    std::vector<float> single(pixels), parallel(pixels);
+    SSAOReference singleThreaded(ssao, 1);
+    singleThreaded.computeAO(width, height, &depth[0], &normals[0],
+                             projection, &single[0]);
+    SSAOReference multiThreaded(ssao);
+    multiThreaded.computeAO(width, height, &depth[0], &normals[0],
+                            projection, &parallel[0]);
+    bool deterministic = std::memcmp(&single[0], &parallel[0],
+                                     pixels * sizeof(float)) == 0;
+
+    // The GPU occlusion went through 8 bit targets after every pass
+    float maxError = 0.0f;
+    double sumError = 0.0;
+    for (int y = 0 ; y < height ; y++) {
+        for (int x = 0 ; x < width ; x++) {
+            float error = std::fabs(image->getColor(x, y).r() -
+                                    single[size_t(y) * width + x]);
+            maxError = std::max(maxError, error);
+            sumError += error;
+        }
+    }
+
+    bool passed = deterministic && maxError <= m_options.referenceTolerance;
+    result["threads"] = multiThreaded.threadCount();
+    result["deterministic"] = deterministic;
+    result["max_error"] = maxError;
+    result["mean_error"] = sumError / pixels;
+    result["passed"] = passed;
+    m_passed = m_passed && passed;
+    return result;
+}
+
+QJsonObject RegressionSuite::compareSharedPool(osg::Node* scene,
+                                               const osg::Vec2d& azEl)
+{
+    QJsonObject result;
+    int width = m_renderer.width();
+    int height = m_renderer.height();
+    osg::ref_ptr<osg::Image> images[2];
+    size_t bytes[2];
+
+    // Two views of the same size, with pools of their own and then sharing
+    // one.  The second view's occlusion differs, so a view that composites
+    // targets the other one rendered into shows.
+    for (int shared = 0 ; shared < 2 ; shared++) {
+        osg::ref_ptr<SSAONode> first = new SSAONode(width, height);
+        osg::ref_ptr<SSAONode> second = new SSAONode(width, height);
+        second->SetSSAORadius(first->GetSSAORadius() * 2.0f);
+        if (shared)
+            second->SetRenderTargetPool(first->GetRenderTargetPool());
+
+        OffscreenRenderer renderer(width, height, first.get(), 1, second.get());
+        if (!renderer.isValid()) {
+            result["error"] = "no pbuffer for two views";
+            result["passed"] = false;
+            m_passed = false;
+            return result;
+        }
+        renderer.setScene(scene);
+        renderer.cameraModel()->setViewDirFromAzEl(azEl);
+
+        // The camera stands still: views with pools of their own only
+        // composite after the first frames, sharing ones find their
+        // targets overwritten and render everything again
+        for (int i = 0 ; i < 10 ; i++) {
+            renderer.frame();
+            if (i >= 3 && !first->NeedsRedraw() && !second->NeedsRedraw())
+                break;
+        }
+
+        images[shared] = renderer.readImage();
+        bytes[shared] = first->GetRenderTargetPool()->allocatedBytes();
+        if (!shared)
+            bytes[shared] += second->GetRenderTargetPool()->allocatedBytes();
+    }
+
+    float maxDifference = 0.0f;
+    for (int y = 0 ; y < images[0]->t() ; y++) {
+        for (int x = 0 ; x < images[0]->s() ; x++) {
+            osg::Vec4 d = (images[1]->getColor(x, y) -
+                           images[0]->getColor(x, y)) * 255.0f;
+            for (int c = 0 ; c < 3 ; c++)
+                maxDifference = std::max(maxDifference, std::fabs(d[c]));
+        }
+    }
+
+    // Equal sizes share every target, so the pool is the size of one view's
+    bool halved = bytes[1] * 2 <= bytes[0];
+    bool passed = halved && maxDifference <= m_options.pixelTolerance;
+    result["render_target_mb"] = double(bytes[1]) / (1024.0 * 1024.0);
+    result["unshared_render_target_mb"] = double(bytes[0]) / (1024.0 * 1024.0);
+    result["max_difference"] = maxDifference;
+    result["passed"] = passed;
+    m_passed = m_passed && passed;
+    return result;
+}
+
+QJsonObject RegressionSuite::comparePerformance(const QString& name,
+                                                const QJsonObject& cpu,
+                                                const QJsonObject& gpu)
+{
+    QJsonObject result;
+    QJsonObject baseline = m_baseline[name].toObject();
+    if (baseline.isEmpty()) {
+        result["baseline_ms"] = QJsonValue::Null;
+        return result;
+    }
+
+    // GPU time where both runs have it, it is what the shaders change
+    QJsonObject baselineGpu = baseline["gpu_ms"].toObject();
+    bool useGpu = !gpu.isEmpty() && !baselineGpu.isEmpty();
+    double baselineMs = useGpu ? baselineGpu["mean"].toDouble() :
+                                 baseline["cpu_ms"].toObject()["mean"].toDouble();
+    double ms = useGpu ? gpu["mean"].toDouble() : cpu["mean"].toDouble();
+    double ratio = baselineMs > 0.0 ? ms / baselineMs : 1.0;
+    bool passed = ratio <= 1.0 + m_options.perfTolerance / 100.0;
+
+    result["timer"] = useGpu ? "gpu" : "cpu";
+    result["baseline_ms"] = baselineMs;
+    result["ms"] = ms;
+    result["ratio"] = ratio;
+    result["passed"] = passed;
+    m_passed = m_passed && passed;
+    return result;
+}
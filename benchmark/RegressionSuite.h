@@ -0,0 +1,56 @@
+#ifndef REGRESSIONSUITE_H
+#define REGRESSIONSUITE_H
+
+#include <QJsonObject>
+#include <QString>
+#include <osg/Node>
+#include <osg/Vec2d>
+
+class OffscreenRenderer;
+
+// Renders fixed views of the box field and the analytic scenes in every
+// display mode, with and without halo removal and blur.  Each image is
+// compared against a stored golden image, each configuration's frame
+// time against a baseline report.  Two SSAONodes sharing a
+// RenderTargetPool are checked against two with pools of their own, and
+// last the hemisphere kernel path of every scene against SSAOReference.
+class RegressionSuite
+{
+public:
+    struct Options {
+        int frames;            // timed frames per configuration
+        int warmup;            // untimed frames first
+        int boxes;             // boxes in the generated scene
+        bool instanced;        // draw them instanced, same golden images
+        QString goldenDir;     // <configuration>.png files
+        bool updateGolden;     // write the images instead of comparing
+        QString baseline;      // report of an earlier run, may be empty
+        double perfTolerance;  // percent a mean may grow over the baseline
+        double pixelTolerance; // luma difference counted as changed, 0..255
+        double imageTolerance; // percent of pixels that may change
+        double referenceTolerance; // AO difference to SSAOReference, 0..1
+    };
+
+    RegressionSuite(OffscreenRenderer& renderer, const Options& options);
+
+    // Runs every configuration, the report lists what failed
+    QJsonObject run();
+    bool passed() const { return m_passed; }
+
+    // Total frames run() renders per configuration
+    static int framesPerConfiguration(const Options& options);
+
+private:
+    QJsonObject compareImage(const QString& name);
+    QJsonObject compareReference(const QString& name);
+    QJsonObject compareSharedPool(osg::Node* scene, const osg::Vec2d& azEl);
+    QJsonObject comparePerformance(const QString& name, const QJsonObject& cpu,
+                                   const QJsonObject& gpu);
+
+    OffscreenRenderer& m_renderer;
+    Options m_options;
+    QJsonObject m_baseline; // configuration name -> its entry
+    bool m_passed;
+};
+
+#endif // REGRESSIONSUITE_H
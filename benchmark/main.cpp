@@ -0,0 +1,418 @@
+// Headless benchmark of the SSAO pipeline.  Renders the generated test
+// scene into a pbuffer along a scripted orbit and prints per-frame CPU and
+// GPU times as JSON.  With --suite it runs the regression suite instead,
+// see RegressionSuite.  Under Linux without a GPU run it on Mesa llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a ssao_benchmark --size 1280x720
+//
+#include "SSAONode.h"
+#include "SSAOKernels.h"
+#include "ProgramCache.h"
+#include "SceneBuilder.h"
+#include "SceneOptimizer.h"
+#include "OffscreenRenderer.h"
+#include "RegressionSuite.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <osgDB/ReadFile>
+
+#include <climits>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct Settings {
+    int width = 1280;
+    int height = 720;
+    int frames = 300;
+    int warmup = 30;
+    int boxes = 5000;
+    bool instanced = false;
+    QString model;
+    bool optimize = false;
+    int kernelSize = 8;
+    int noiseSize = 2;
+    int blurSize = 2;
+    SSAONode::AOResolution resolution = SSAONode::AO_FullRes;
+    SSAONode::AOAlgorithm algorithm = SSAONode::AO_HemisphereKernel;
+    SSAONode::GBufferLayout layout = SSAONode::GBuffer_Compact;
+    bool temporal = false;
+    bool deinterleaved = false;
+    bool blueNoise = false;
+    bool noiseOffset = false;
+    bool occlusionCulling = false;
+    bool programCache = true;
+    QString output;
+
+    bool suite = false;
+    RegressionSuite::Options suiteOptions;
+};
+
+bool parseSettings(const QStringList &args, Settings &s, QString &error)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offscreen SSAO benchmark");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"size", "Render target size.", "WxH", "1280x720"},
+        {"frames", "Timed frames.", "n", "300"},
+        {"warmup", "Untimed frames rendered first.", "n", "30"},
+        {"boxes", "Boxes in the generated scene.", "n", "5000"},
+        {"instanced", "Draw the boxes with one instanced draw call."},
+        {"model", "Render a model file instead of the boxes.", "file"},
+        {"optimize", "Run the model through SceneOptimizer first."},
+        {"kernel", QString("Kernel size, kernel^2 taps, at most %1.")
+         .arg(SSAOKernels::MaxKernelSize), "n", "8"},
+        {"noise", "Noise texture size.", "n", "2"},
+        {"blur", "Blur radius in AO texels, 0 disables the blur.", "n", "2"},
+        {"resolution", "AO resolution: full, half or quarter.", "res", "full"},
+        {"algorithm", "AO algorithm: hemisphere or horizon.", "alg",
+         "hemisphere"},
+        {"layout", "G-buffer layout: classic or compact.", "layout",
+         "compact"},
+        {"temporal", "Accumulate AO over frames."},
+        {"deinterleaved", "Deinterleaved SSAO pass."},
+        {"blue-noise", "Blue noise rotations instead of the noise texture."},
+        {"noise-offset", "Shift the blue noise every frame."},
+        {"occlusion-culling", "Skip scene nodes hidden in the G-buffer pass."},
+        {"no-program-cache", "Link every shader from source, as on a first start."},
+        {{"o", "output"}, "Write the JSON report to a file.", "file"},
+        {"suite", "Run the regression suite instead of the orbit."},
+        {"golden", "Golden image directory of the suite.", "dir", "golden"},
+        {"update-golden", "Write the golden images instead of comparing."},
+        {"baseline", "Suite report to compare frame times against.", "file"},
+        {"perf-tolerance", "Percent a mean time may exceed the baseline.",
+         "percent", "20"},
+        {"pixel-tolerance", "Luma difference (0-255) that counts a pixel "
+         "as changed.", "value", "3"},
+        {"image-tolerance", "Percent of pixels that may change.", "percent",
+         "0.5"},
+        {"reference-tolerance", "Largest occlusion difference (0-1) to the "
+         "CPU reference.", "value", "0.1"},
+    });
+    if (!parser.parse(args)) {
+        error = parser.errorText();
+        return false;
+    }
+    if (parser.isSet("help")) {
+        error = parser.helpText();
+        return false;
+    }
+
+    QStringList size = parser.value("size").split('x');
+    bool ok = size.size() == 2;
+    if (ok) s.width = size[0].toInt(&ok);
+    if (ok) s.height = size[1].toInt(&ok);
+    if (!ok || s.width <= 0 || s.height <= 0) {
+        error = "invalid --size " + parser.value("size");
+        return false;
+    }
+
+    // SSAONode would clamp a larger kernel, and the report would carry a
+    // size that was never measured
+    struct { const char *name; int *value; int minimum; int maximum; } ints[] = {
+        {"frames", &s.frames, 1, INT_MAX},
+        {"warmup", &s.warmup, 0, INT_MAX},
+        {"boxes", &s.boxes, 0, INT_MAX},
+        {"kernel", &s.kernelSize, 1, SSAOKernels::MaxKernelSize},
+        {"noise", &s.noiseSize, 1, INT_MAX},
+        {"blur", &s.blurSize, 0, INT_MAX},
+    };
+    for (auto &i : ints) {
+        *i.value = parser.value(i.name).toInt(&ok);
+        if (!ok || *i.value < i.minimum || *i.value > i.maximum) {
+            error = QString("invalid --%1 %2").arg(i.name)
+                    .arg(parser.value(i.name));
+            return false;
+        }
+    }
+
+    QString resolution = parser.value("resolution");
+    if (resolution == "full") s.resolution = SSAONode::AO_FullRes;
+    else if (resolution == "half") s.resolution = SSAONode::AO_HalfRes;
+    else if (resolution == "quarter") s.resolution = SSAONode::AO_QuarterRes;
+    else {
+        error = "invalid --resolution " + resolution;
+        return false;
+    }
+
+    QString algorithm = parser.value("algorithm");
+    if (algorithm == "hemisphere") s.algorithm = SSAONode::AO_HemisphereKernel;
+    else if (algorithm == "horizon") s.algorithm = SSAONode::AO_HorizonBased;
+    else {
+        error = "invalid --algorithm " + algorithm;
+        return false;
+    }
+
+    QString layout = parser.value("layout");
+    if (layout == "classic") s.layout = SSAONode::GBuffer_Classic;
+    else if (layout == "compact") s.layout = SSAONode::GBuffer_Compact;
+    else {
+        error = "invalid --layout " + layout;
+        return false;
+    }
+
+    s.instanced = parser.isSet("instanced");
+    s.model = parser.value("model");
+    s.optimize = parser.isSet("optimize");
+    s.temporal = parser.isSet("temporal");
+    s.deinterleaved = parser.isSet("deinterleaved");
+    s.blueNoise = parser.isSet("blue-noise");
+    s.noiseOffset = parser.isSet("noise-offset");
+    s.occlusionCulling = parser.isSet("occlusion-culling");
+    s.programCache = !parser.isSet("no-program-cache");
+    s.output = parser.value("output");
+
+    // The suite renders a few dozen configurations, so it defaults to
+    // fewer frames each
+    s.suite = parser.isSet("suite");
+    if (s.suite) {
+        if (!parser.isSet("frames")) s.frames = 20;
+        if (!parser.isSet("warmup")) s.warmup = 5;
+    }
+
+    RegressionSuite::Options& o = s.suiteOptions;
+    o.frames = s.frames;
+    o.warmup = s.warmup;
+    o.boxes = s.boxes;
+    o.instanced = s.instanced;
+    o.goldenDir = parser.value("golden");
+    o.updateGolden = parser.isSet("update-golden");
+    o.baseline = parser.value("baseline");
+    struct { const char *name; double *value; } doubles[] = {
+        {"perf-tolerance", &o.perfTolerance},
+        {"pixel-tolerance", &o.pixelTolerance},
+        {"image-tolerance", &o.imageTolerance},
+        {"reference-tolerance", &o.referenceTolerance},
+    };
+    for (auto &d : doubles) {
+        *d.value = parser.value(d.name).toDouble(&ok);
+        if (!ok || *d.value < 0.0) {
+            error = QString("invalid --%1 %2").arg(d.name)
+                    .arg(parser.value(d.name));
+            return false;
+        }
+    }
+    return true;
+}
+
+QJsonObject settingsToJson(const Settings &s)
+{
+    static const char *resolutions[] = {"", "full", "half", "", "quarter"};
+    QJsonObject o;
+    o["width"] = s.width;
+    o["height"] = s.height;
+    o["frames"] = s.frames;
+    o["warmup"] = s.warmup;
+    o["boxes"] = s.boxes;
+    o["instanced"] = s.instanced;
+    o["model"] = s.model;
+    o["optimize"] = s.optimize;
+    o["kernel"] = s.kernelSize;
+    o["noise"] = s.noiseSize;
+    o["blur"] = s.blurSize;
+    o["resolution"] = resolutions[s.resolution];
+    o["algorithm"] = s.algorithm == SSAONode::AO_HorizonBased ?
+                "horizon" : "hemisphere";
+    o["layout"] = s.layout == SSAONode::GBuffer_Classic ?
+                "classic" : "compact";
+    o["temporal"] = s.temporal;
+    o["deinterleaved"] = s.deinterleaved;
+    o["blue_noise"] = s.blueNoise;
+    o["noise_offset"] = s.noiseOffset;
+    o["occlusion_culling"] = s.occlusionCulling;
+    o["program_cache"] = s.programCache;
+    o["suite"] = s.suite;
+    return o;
+}
+
+QJsonObject statisticsToJson(const SceneOptimizer::Statistics& s)
+{
+    QJsonObject o;
+    o["nodes"] = int(s.nodes);
+    o["drawables"] = int(s.drawables);
+    o["draw_calls"] = int(s.drawCalls);
+    o["vertices"] = int(s.vertices);
+    o["state_sets"] = int(s.stateSets);
+    o["state_set_refs"] = int(s.stateSetRefs);
+    return o;
+}
+
+bool writeReport(const QJsonObject& report, const QString& output)
+{
+    QByteArray json = QJsonDocument(report).toJson();
+    if (output.isEmpty()) {
+        QTextStream(stdout) << json;
+        return true;
+    }
+    QFile file(output);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(json);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    Settings s;
+    QString error;
+    if (!parseSettings(app.arguments(), s, error)) {
+        err << error << "\n";
+        return 1;
+    }
+
+    ProgramCache::setBinaryCacheEnabled(s.programCache);
+    osg::ref_ptr<SSAONode> ssao = new SSAONode(s.width, s.height,
+                                               s.kernelSize, s.noiseSize,
+                                               s.blurSize);
+    ssao->SetGBufferLayout(s.layout);
+    ssao->SetAOResolution(s.resolution);
+    ssao->SetAOAlgorithm(s.algorithm);
+    ssao->SetTemporalEnabled(s.temporal);
+    ssao->SetDeinterleavedEnabled(s.deinterleaved);
+    ssao->SetBlueNoiseEnabled(s.blueNoise);
+    ssao->SetNoiseOffsetEnabled(s.noiseOffset);
+    ssao->SetOcclusionCullingEnabled(s.occlusionCulling);
+    ssao->setAOBlurEnabled(s.blurSize > 0);
+
+    int statsFrames = s.suite ?
+                RegressionSuite::framesPerConfiguration(s.suiteOptions) :
+                s.warmup + s.frames;
+    OffscreenRenderer renderer(s.width, s.height, ssao.get(), statsFrames);
+    if (!renderer.isValid()) {
+        err << "could not create a " << s.width << "x" << s.height
+            << " pbuffer\n";
+        return 1;
+    }
+
+    QJsonObject report;
+    report["settings"] = settingsToJson(s);
+    report["gl"] = renderer.glInfo();
+
+    if (s.suite) {
+        RegressionSuite suite(renderer, s.suiteOptions);
+        QJsonObject results = suite.run();
+        for (auto it = results.begin(); it != results.end(); ++it)
+            report[it.key()] = it.value();
+
+        if (!writeReport(report, s.output)) {
+            err << "could not write " << s.output << "\n";
+            return 1;
+        }
+        return suite.passed() ? 0 : 2;
+    }
+
+    osg::ref_ptr<osg::Node> scene;
+    if (s.model.isEmpty()) {
+        scene = SceneBuilder::buildScene(s.boxes, s.instanced);
+    } else {
+        scene = osgDB::readNodeFile(QFile::encodeName(s.model).toStdString());
+        if (!scene.valid()) {
+            err << "could not read " << s.model << "\n";
+            return 1;
+        }
+    }
+    if (s.optimize) {
+        report["scene_before_optimization"] =
+                statisticsToJson(SceneOptimizer::collect(scene.get()));
+        SceneOptimizer::optimize(scene.get());
+    }
+    report["scene"] = statisticsToJson(SceneOptimizer::collect(scene.get()));
+    renderer.setScene(scene.get());
+    CameraModel* cameraModel = renderer.cameraModel();
+    double fitDistance = cameraModel->viewDistance();
+
+    std::vector<unsigned> frameNumbers;
+    std::vector<double> cpuTimes;
+    std::vector<unsigned> testedNodes, occludedNodes;
+    int totalFrames = s.warmup + s.frames + OffscreenRenderer::GpuQueryLatency;
+
+    for (int i = 0 ; i < totalFrames ; i++) {
+        // One orbit over the timed frames, bobbing in elevation and
+        // distance so both near and far occluders show up
+        double t = double(i - s.warmup) / double(s.frames);
+        double phase = 2.0 * osg::PI * t;
+        cameraModel->setViewDirFromAzEl(
+                    osg::Vec2d(360.0 * t, 20.0 + 15.0 * sin(phase)));
+        cameraModel->setViewDistance(fitDistance *
+                                     (0.75 + 0.25 * cos(phase)));
+
+        double cpuMs = renderer.frame();
+
+        // Compiles or loads every program the view needs
+        if (i == 0)
+            report["first_frame_ms"] = cpuMs;
+
+        if (i >= s.warmup && i < s.warmup + s.frames) {
+            frameNumbers.push_back(renderer.frameNumber());
+            cpuTimes.push_back(cpuMs);
+
+            unsigned tested, occluded;
+            ssao->GetOcclusionStatistics(tested, occluded);
+            testedNodes.push_back(tested);
+            occludedNodes.push_back(occluded);
+        }
+    }
+
+    QJsonArray frames;
+    std::vector<double> gpuTimes;
+    for (size_t i = 0 ; i < frameNumbers.size() ; i++) {
+        QJsonObject frame;
+        frame["frame"] = int(i);
+        frame["cpu_ms"] = cpuTimes[i];
+        if (s.occlusionCulling) {
+            frame["nodes_tested"] = int(testedNodes[i]);
+            frame["nodes_occluded"] = int(occludedNodes[i]);
+        }
+
+        double gpuMs;
+        if (renderer.gpuTime(frameNumbers[i], gpuMs)) {
+            frame["gpu_ms"] = gpuMs;
+            gpuTimes.push_back(gpuMs);
+        } else {
+            frame["gpu_ms"] = QJsonValue::Null;
+        }
+        frames.append(frame);
+    }
+
+    // Pass times cover the last PassTimer::SampleWindow frames only
+    QJsonObject passes;
+    for (int i = 0 ; i < SSAONode::PassCount ; i++) {
+        SSAONode::RenderPass pass = (SSAONode::RenderPass)i;
+        double lastMs, meanMs, maxMs;
+        if (!ssao->GetPassTime(pass, lastMs, meanMs, maxMs))
+            continue;
+        QJsonObject o;
+        o["mean"] = meanMs;
+        o["max"] = maxMs;
+        passes[SSAONode::PassName(pass)] = o;
+    }
+
+    report["cpu_ms"] = summarizeTimes(cpuTimes);
+    // No GL_ARB_timer_query leaves the GPU times out
+    report["gpu_ms"] = gpuTimes.empty() ?
+                QJsonValue(QJsonValue::Null) : summarizeTimes(gpuTimes);
+    report["passes_gpu_ms"] = passes;
+    report["render_target_mb"] = double(ssao->GetRenderTargetPool()->allocatedBytes()) /
+            (1024.0 * 1024.0);
+    report["frames"] = frames;
+
+    if (!writeReport(report, s.output)) {
+        err << "could not write " << s.output << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#version 130
+
+// One direction of the separable occlusion blur.  Run once horizontally
+// and once vertically, so the cost grows with 2n instead of n*n.  Every
+// tap is weighted by how close its view z and normal are to the center
+// pixel, which keeps occlusion from bleeding across silhouettes.  Taps
+// more than DEPTH_TOLERANCE of the distance in front of or behind the
+// center get no weight, HALO_REMOVAL narrows that to haloTreshold view
+// units where it is stricter.  BLUR_RADIUS (in occlusion texels) is
+// compiled in so the loop can be unrolled.
+#ifndef BLUR_RADIUS
+#define BLUR_RADIUS 2
+#endif
+
+#define DEPTH_TOLERANCE 0.1
+
+uniform sampler2D aoTexture;
+uniform sampler2D aoZTexture; // view space z
+uniform sampler2D aoNormalTexture;
+
+uniform vec2 blurDirection;
+
+// aoSize, aoTexScale and haloTreshold are in blocks.glsl, decode_normal()
+// in common.glsl
+
+float fetch_view_z(vec2 coord)
+{
+	return texelFetch(aoZTexture, ivec2(coord * vec2(textureSize(aoZTexture, 0))), 0).r;
+}
+
+void main(void)
+{
+	vec2 uv = gl_TexCoord[0].st;
+	vec2 texelStep = blurDirection / aoSize;
+
+	// Taps past the viewport edge would read unused parts of the texture
+	vec2 uvMin = 0.5 / aoSize;
+	vec2 uvMax = 1.0 - uvMin;
+
+	float sigma = (float(BLUR_RADIUS) + 1.0) * 0.5;
+	float falloff = 1.0 / (2.0 * sigma * sigma);
+
+	float depth = fetch_view_z(uv * aoTexScale);
+	vec3 normal = decode_normal(texture2D(aoNormalTexture, uv * aoTexScale));
+	float depthRange = abs(depth) * DEPTH_TOLERANCE;
+#ifdef HALO_REMOVAL
+	depthRange = min(depthRange, haloTreshold);
+#endif
+	depthRange = max(depthRange, 0.0001);
+
+	float result = 0.0;
+	float totalWeight = 0.0;
+
+	for (int i = -BLUR_RADIUS; i <= BLUR_RADIUS; ++i) {
+		vec2 coord = clamp(uv + float(i) * texelStep, uvMin, uvMax) * aoTexScale;
+		float weight = exp(-float(i * i) * falloff);
+
+		float sampleDepth = fetch_view_z(coord);
+		vec3 sampleNormal = decode_normal(texture2D(aoNormalTexture, coord));
+
+		weight *= max(0.0, 1.0 - abs(sampleDepth - depth) / depthRange);
+		weight *= pow(max(dot(sampleNormal, normal), 0.0), 8.0);
+
+		result += texture2D(aoTexture, coord).r * weight;
+		totalWeight += weight;
+	}
+
+	// The center tap always has full weight, so totalWeight > 0
+	gl_FragColor = vec4(result / totalWeight);
+}
@@ -0,0 +1,36 @@
+// Uniform blocks shared by every SSAO pass.  SSAONode inserts this after
+// the #version line of each fragment shader and keeps one buffer per
+// block, so a value is uploaded once for all programs that read it.
+// std140, the offsets must match the Parameter and Frame enums in
+// SSAONode.h.
+#extension GL_ARB_uniform_buffer_object : require
+
+const int MAX_KERNEL_SIZE = 128;
+
+// Changes with the settings and the viewport size
+layout(std140) uniform SSAOParameters {
+    vec4 ssaoKernel[MAX_KERNEL_SIZE]; // xyz, tangent space
+    vec2 sceneSize;       // full resolution viewport
+    vec2 texScale;        // viewport relative -> texture coordinates
+    vec2 aoSize;          // occlusion viewport
+    vec2 aoTexScale;      // same for the occlusion resolution targets
+    vec2 tileSize;        // one layer of the deinterleaved atlas
+    vec2 noiseTextureRcp; // noise tiles per occlusion viewport
+    int kernelSize;       // taps in ssaoKernel
+    int downsampleScale;  // full resolution pixels per occlusion pixel
+    float ssaoRadius;
+    float ssaoPower;
+    float haloTreshold;
+};
+
+// Changes every frame
+layout(std140) uniform SSAOFrame {
+    mat4 projMatrix;
+    mat4 previousProjMatrix;
+    mat4 viewToPreviousView;
+    vec2 frameRotation;   // cos, sin
+    float frameJitter;
+    float historyValid;   // 0 until the history holds a frame
+    ivec2 noiseOffset;    // blue noise tile shift in texels
+    int kernelPhase;      // first kernel tap of this frame
+};
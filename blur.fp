@@ -1,116 +1,82 @@
-#version 120
+#version 130
+
+// Composite pass.  SSAONode compiles one program per combination of
+//   DISPLAY_MODE  0 = color only, 1 = color and AO, 2 = AO only
+//   UPSAMPLE_AO   defined when the occlusion buffer is low resolution
+// so none of these are decided per fragment.
+#ifndef DISPLAY_MODE
+#define DISPLAY_MODE 1
+#endif
 
 uniform sampler2D sceneTex;
-uniform sampler2D linearDepthTexture;
-uniform int uBlurSize; // use size of noise texture
-uniform vec2 sceneSize;
+uniform sampler2D linearZTexture; // view space z, full resolution
+uniform sampler2D colorTexture;
+uniform sampler2D aoZTexture;     // view space z at occlusion resolution
 
-uniform mat4 projMatrix;
+// sceneSize, aoSize, texScale and aoTexScale are in blocks.glsl
 
-uniform int displayType = 0; 
-uniform int blurAOEnable = 0; 
-uniform int haloRemoval = 0; 
-uniform float haloTreshold = 0; 
+// Depth aware upsample of a low resolution occlusion buffer.  Each of the
+// four nearest occlusion texels is weighted bilinearly and by how close its
+// view z is to the full resolution one, relative to the distance, so
+// occlusion does not leak across silhouettes.
+float upsampleAO(vec2 uv)
+{
+	ivec2 ssP = clamp(ivec2(uv * sceneSize), ivec2(0), ivec2(sceneSize) - ivec2(1));
+	float depth = texelFetch(linearZTexture, ssP, 0).r;
 
-float reconstruct_z(in float depth, in mat4 projMatrix){
-	return -projMatrix[3][2] / (depth + projMatrix[2][2]);
-}
+	vec2 pos = uv * aoSize - 0.5;
+	vec2 base = clamp(floor(pos), vec2(0.0), aoSize - 2.0);
+	vec2 f = clamp(pos - base, 0.0, 1.0);
 
-float blurAOHaloRemoval()
-{
-	vec2 texelSize = 1.0 / vec2(sceneSize);
 	float result = 0.0;
-	vec2 hlim = vec2(float(-uBlurSize) * 0.5 + 0.5);
-	float depth = reconstruct_z(texture2D(linearDepthTexture, gl_TexCoord[0].st).r, projMatrix);
+	float totalWeight = 0.0;
 
-	float totalWeight = float(uBlurSize * uBlurSize);
-	float pixelWeight = 1.0f;
+	for (int i = 0; i < 2; ++i) {
+		for (int j = 0; j < 2; ++j) {
+			vec2 texel = base + vec2(float(i), float(j));
+			vec2 coord = (texel + 0.5) / aoSize * aoTexScale;
+			float sampleDepth = texelFetch(aoZTexture, ivec2(texel), 0).r;
 
-	for (int i = 0; i < uBlurSize; ++i) {
-		for (int j = 0; j < uBlurSize; ++j) {
-			vec2 offset = (hlim + vec2(float(i), float(j))) * texelSize;
-			float offsetDepth = reconstruct_z(texture2D(linearDepthTexture, gl_TexCoord[0].st + offset).r, projMatrix);
+			float bilinear = (i == 0 ? 1.0 - f.x : f.x) * (j == 0 ? 1.0 - f.y : f.y);
+			float weight = bilinear / (0.0001 + abs(sampleDepth - depth) / max(abs(depth), 0.0001));
 
-			if (abs(offsetDepth - depth) > haloTreshold) {
-				totalWeight -= pixelWeight;
-				continue;
-			}
-
-			result += texture2D(sceneTex, gl_TexCoord[0].st + offset).a;
+			result += texture2D(sceneTex, coord).r * weight;
+			totalWeight += weight;
 		}
 	}
-	
-	// This is blurred occlusion factor
-	float occlusionFactor = result / totalWeight;
 
-	return occlusionFactor;
+	return result / totalWeight;
 }
 
-float blurAO()
+float AO(vec2 uv)
 {
-	vec2 texelSize = 1.0 / vec2(sceneSize);
-	float result = 0.0;
-	vec2 hlim = vec2(float(-uBlurSize) * 0.5 + 0.5);
-	for (int i = 0; i < uBlurSize; ++i) {
-		for (int j = 0; j < uBlurSize; ++j) {
-			vec2 offset = (hlim + vec2(float(i), float(j))) * texelSize;
-			result += texture2D(sceneTex, gl_TexCoord[0].st + offset).a;
-		}
-	}
-	
-	// This is blurred occlusion factor
-	float occlusionFactor = (result / float(uBlurSize * uBlurSize));
-
-	return occlusionFactor;
+#ifdef UPSAMPLE_AO
+	return upsampleAO(uv);
+#else
+	return texture2D(sceneTex, uv * aoTexScale).r;
+#endif
 }
 
 float AO()
 {
-	return texture2D(sceneTex, gl_TexCoord[0].st).a;
+	return AO(gl_TexCoord[0].st);
 }
 
 vec3 Color()
 {
-	return texture2D(sceneTex, gl_TexCoord[0].st).rgb;
+	return texture2D(colorTexture, gl_TexCoord[0].st * texScale).rgb;
 }
 
+// Composite the (already blurred) occlusion with the G-buffer color
 void main(void)
 {
-	float occlusion;
-	vec3 color = Color();
-	vec3 resultColor;
-
-	if (displayType == 1) {
-		if (haloRemoval == 1) {
-			if (blurAOEnable == 1) {
-				resultColor = color * blurAOHaloRemoval();
-			} else {
-				resultColor = color * AO();
-			}
-		} else {
-			if (blurAOEnable == 1) {
-				resultColor = color * blurAO();
-			} else {
-				resultColor = color * AO();
-			}
-		}
-	} else if(displayType == 2) {
-		if (haloRemoval == 1) {
-			if (blurAOEnable == 1) {
-				resultColor = vec3(blurAOHaloRemoval());
-			} else {
-				resultColor = vec3(AO());
-			}
-		} else {
-			if (blurAOEnable == 1) {
-				resultColor = vec3(blurAO());
-			} else {
-				resultColor = vec3(AO());
-			}
-		}
-	} else {
-		resultColor = color;
-	}
+#if DISPLAY_MODE == 1
+	vec3 resultColor = Color() * AO();
+#elif DISPLAY_MODE == 2
+	vec3 resultColor = vec3(AO());
+#else
+	vec3 resultColor = Color();
+#endif
 
 	gl_FragColor = vec4(resultColor, 1);
 }
@@ -0,0 +1,126 @@
+// Helpers shared by the SSAO fragment shaders.  SSAONode inserts this
+// after blocks.glsl into each of them, functions a shader does not call
+// cost nothing.
+
+// View space position from viewport relative coordinates and view space z
+vec3 reconstruct_pos(float z, vec2 vTexCoord, in mat4 projMatrix){
+    vec2 ndc = vTexCoord * 2.0 - 1.0;
+    float w = projMatrix[2][3] * z + projMatrix[3][3];
+    return vec3((ndc.x * w - projMatrix[2][0] * z - projMatrix[3][0]) / projMatrix[0][0],
+                (ndc.y * w - projMatrix[2][1] * z - projMatrix[3][1]) / projMatrix[1][1],
+                z);
+}
+
+// G-buffer normal.  With OCT_NORMALS the G-buffer holds octahedral
+// encoded normals in two channels (Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors"), otherwise
+// n * 0.5 + 0.5 in three.  phong.fp writes them.
+vec3 decode_normal(vec4 texel)
+{
+#ifdef OCT_NORMALS
+    vec2 e = texel.xy * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+#else
+    return normalize(texel.xyz * 2.0 - 1.0);
+#endif
+}
+
+#ifdef DEINTERLEAVE
+// The occlusion passes run on an atlas of DEINTERLEAVE^2 layers of the
+// occlusion buffer.  Layer (i, j) holds the pixels with
+// x % DEINTERLEAVE == i and y % DEINTERLEAVE == j and uses a single noise
+// rotation.  Taps stay in the layer, so neighbouring fragments fetch
+// neighbouring texels.  aoSize and tileSize give the occlusion viewport
+// and one layer of the atlas.
+
+// Occlusion pixel of an atlas texel and the layer it is in
+ivec2 atlas_to_ao(ivec2 atlasP, out ivec2 atlasLayer)
+{
+    atlasLayer = atlasP / ivec2(tileSize);
+    return (atlasP - atlasLayer * ivec2(tileSize)) * DEINTERLEAVE + atlasLayer;
+}
+#endif
+
+#ifdef AO_PASS
+// The G-buffer fetches of the occlusion passes, ssao.fp and hbao.fp.
+// SSAONode defines AO_PASS for them.
+
+// Taps read view space z from a mip pyramid.  The further a tap lands
+// from the origin the coarser the level it reads, so large radii stay
+// cache friendly (McGuire et al., "Scalable Ambient Obscurance").
+#ifndef DEPTH_MIP_LEVELS
+#define DEPTH_MIP_LEVELS 5
+#endif
+
+// Taps closer than 2^LOG_MAX_OFFSET pixels read the full resolution level
+#define LOG_MAX_OFFSET 3
+
+// G-buffer
+uniform sampler2D linearZTexture; // view space z, DEPTH_MIP_LEVELS mips
+uniform sampler2D normalTexture;
+
+#ifdef DEINTERLEAVE
+// linearZTexture and normalTexture hold atlases as well
+ivec2 layer; // of this fragment, set by fragment_uv()
+#endif
+
+// Per pixel rotation (rg) and jitter (b), ssao.fp only uses the rotation.
+// BLUE_NOISE: noiseTexture is a tileable BLUE_NOISE^2 blue noise texture
+// (rotation angle, jitter), one texel per occlusion pixel shifted by
+// noiseOffset
+uniform sampler2D noiseTexture;
+
+// Viewport relative coordinates of this fragment's occlusion pixel
+vec2 fragment_uv()
+{
+#ifdef DEINTERLEAVE
+    ivec2 aoP = atlas_to_ao(ivec2(gl_FragCoord.xy), layer);
+    return (vec2(aoP) + 0.5) / aoSize;
+#else
+    return gl_TexCoord[0].st;
+#endif
+}
+
+float fetch_z(vec2 ssP, int mip)
+{
+#ifdef DEINTERLEAVE
+    // Nearest pixel of this fragment's layer, the atlas has no mips
+    vec2 aoP = ssP * aoSize / sceneSize;
+    ivec2 count = (ivec2(aoSize) - layer + ivec2(DEINTERLEAVE - 1)) / DEINTERLEAVE;
+    ivec2 layerP = ivec2(floor((aoP - vec2(layer) - 0.5) / float(DEINTERLEAVE) + 0.5));
+    layerP = clamp(layerP, ivec2(0), count - ivec2(1));
+    return texelFetch(linearZTexture, layer * ivec2(tileSize) + layerP, 0).r;
+#else
+    ivec2 size = max(ivec2(sceneSize) >> mip, ivec2(1));
+    ivec2 texel = clamp(ivec2(ssP) >> mip, ivec2(0), size - ivec2(1));
+    return texelFetch(linearZTexture, texel, mip).r;
+#endif
+}
+
+vec3 fetch_noise(vec2 uv)
+{
+#ifdef DEINTERLEAVE
+    return texture2D(noiseTexture, (vec2(layer) + 0.5) / float(DEINTERLEAVE)).xyz;
+#elif defined(BLUE_NOISE)
+    // Same encoding as the random noise
+    ivec2 texel = (ivec2(gl_FragCoord.xy) + noiseOffset) & (BLUE_NOISE - 1);
+    vec2 noise = texelFetch(noiseTexture, texel, 0).rg;
+    float angle = noise.r * 6.28318531;
+    return vec3(vec2(cos(angle), sin(angle)) * 0.5 + 0.5, noise.g);
+#else
+    return texture2D(noiseTexture, uv * noiseTextureRcp).xyz;
+#endif
+}
+
+vec3 fetch_normal(vec2 uv)
+{
+#ifdef DEINTERLEAVE
+    return decode_normal(texelFetch(normalTexture, ivec2(gl_FragCoord.xy), 0));
+#else
+    return decode_normal(texture2D(normalTexture, uv * aoTexScale));
+#endif
+}
+#endif // AO_PASS
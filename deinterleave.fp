@@ -0,0 +1,23 @@
+#version 130
+
+// Splits view space z and normal at occlusion resolution into an atlas of
+// DEINTERLEAVE^2 layers, see the DEINTERLEAVE notes in common.glsl.
+// SSAONode always defines DEINTERLEAVE for this pass.
+
+uniform sampler2D linearZTexture;
+uniform sampler2D normalTexture;
+
+// sceneSize, aoSize and downsampleScale are in blocks.glsl
+
+void main(void)
+{
+    ivec2 layer;
+    ivec2 aoP = atlas_to_ao(ivec2(gl_FragCoord.xy), layer);
+
+    // Padding past the viewport repeats the edge
+    aoP = min(aoP, ivec2(aoSize) - ivec2(1));
+    ivec2 ssP = min(aoP * downsampleScale, ivec2(sceneSize) - ivec2(1));
+
+    gl_FragData[0] = vec4(texelFetch(linearZTexture, ssP, 0).r);
+    gl_FragData[1] = texelFetch(normalTexture, ssP, 0);
+}
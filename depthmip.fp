@@ -0,0 +1,18 @@
+#version 130
+
+// Builds one level of the view space z pyramid from the level above.
+// A rotated grid pick keeps real depths, averaging would invent
+// surfaces between foreground and background.
+// SSAONode sets the base and max level of linearZTexture to the level
+// above while this runs, so level 0 of the sampler is that level and the
+// level rendered into is out of reach.
+uniform sampler2D linearZTexture;
+uniform vec2 previousMIPSize; // viewport of the level above
+
+void main(void)
+{
+    ivec2 ssP = ivec2(gl_FragCoord.xy);
+    ivec2 maxP = ivec2(previousMIPSize) - ivec2(1);
+    ivec2 texel = clamp(ssP * 2 + ivec2(ssP.y & 1, ssP.x & 1), ivec2(0), maxP);
+    gl_FragColor = vec4(texelFetch(linearZTexture, texel, 0).r);
+}
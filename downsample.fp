@@ -0,0 +1,39 @@
+#version 130
+
+// Reduce the G-buffer to occlusion resolution.  Depth and normals must not
+// be filtered (that would invent surfaces that are not in the scene), so
+// one of the central 2x2 full resolution samples of each block is picked:
+// the closest one, which keeps thin foreground objects alive.  Its view
+// space z is what the depth aware passes at this resolution compare.
+
+uniform sampler2D linearDepthTexture;
+uniform sampler2D normalTexture;
+uniform sampler2D linearZTexture; // pyramid base, same texels
+// sceneSize, texScale and downsampleScale are in blocks.glsl
+
+void main(void)
+{
+	vec2 texelSize = texScale / sceneSize;
+	float scale = float(downsampleScale);
+
+	// Center of the top left texel of the central 2x2 of this block
+	vec2 blockOrigin = floor(gl_TexCoord[0].st * sceneSize / scale) * scale;
+	vec2 first = blockOrigin + vec2(float(downsampleScale / 2) - 0.5);
+
+	float bestDepth = 2.0;
+	vec2 bestCoord = first * texelSize;
+
+	for (int i = 0; i < 2; ++i) {
+		for (int j = 0; j < 2; ++j) {
+			vec2 coord = (first + vec2(float(i), float(j))) * texelSize;
+			float depth = texture2D(linearDepthTexture, coord).r;
+			if (depth < bestDepth) {
+				bestDepth = depth;
+				bestCoord = coord;
+			}
+		}
+	}
+
+	gl_FragData[0] = texture2D(normalTexture, bestCoord);
+	gl_FragData[1] = vec4(texelFetch(linearZTexture, ivec2(bestCoord / texelSize), 0).r);
+}
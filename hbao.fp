@@ -0,0 +1,100 @@
+#version 130
+
+// Horizon based ambient occlusion (Bavoil et al., "Image-Space
+// Horizon-Based Ambient Occlusion").  Marches NUM_DIRECTIONS screen space
+// rays of NUM_STEPS taps through the view space z pyramid.  Far fewer
+// fetches than the hemisphere kernel for a similar result, as every tap
+// contributes how far it rises above the tangent plane.  The pyramid,
+// DEINTERLEAVE, the noise and the G-buffer fetches are in common.glsl.
+#ifndef NUM_DIRECTIONS
+#define NUM_DIRECTIONS 4
+#endif
+#ifndef NUM_STEPS
+#define NUM_STEPS 4
+#endif
+
+// Ignores horizons this close to the tangent plane, hides tessellation
+#define ANGLE_BIAS 0.1
+
+const float PI = 3.14159265;
+
+// The matrices, sizes and settings are in blocks.glsl
+
+// TEMPORAL: each frame turns the directions by frameRotation and shifts
+// the step jitter by frameJitter, the temporal pass accumulates the frames
+
+float hbao(vec2 uv)
+{
+    // Full resolution pixel of this fragment
+    vec2 ssP = uv * sceneSize;
+
+    float originZ = fetch_z(ssP, 0);
+
+    // Skip fragments on far plane (linearize.fp stores far z there)
+    float farZ = (projMatrix[3][2] - projMatrix[3][3]) / (projMatrix[2][3] - projMatrix[2][2]);
+    if (originZ <= farZ + abs(farZ) * 1e-5) return 1.0f;
+
+    vec3 origin = reconstruct_pos(originZ, uv, projMatrix);
+
+    // Fetch view space normal
+    vec3 normal = fetch_normal(uv);
+
+    // Radius in pixels at the origin's depth
+    float w = projMatrix[2][3] * originZ + projMatrix[3][3];
+    float radiusPixels = ssaoRadius * 0.5 * sceneSize.y * projMatrix[1][1] / w;
+
+    // Less than a pixel, nothing to march
+    if (radiusPixels < 1.0) return 1.0f;
+
+    vec3 noise = fetch_noise(uv);
+    vec2 rotation = normalize(noise.xy * 2.0 - 1.0);
+#ifdef TEMPORAL
+    rotation = vec2(rotation.x * frameRotation.x - rotation.y * frameRotation.y,
+                    rotation.x * frameRotation.y + rotation.y * frameRotation.x);
+    noise.z = fract(noise.z + frameJitter);
+#endif
+
+    float stepPixels = radiusPixels / float(NUM_STEPS + 1);
+    float negInvRadius2 = -1.0 / (ssaoRadius * ssaoRadius);
+
+    float occlusion = 0.0;
+
+    for (int d = 0; d < NUM_DIRECTIONS; ++d) {
+
+	float angle = (2.0 * PI / float(NUM_DIRECTIONS)) * float(d);
+	vec2 direction = vec2(cos(angle), sin(angle));
+	direction = vec2(direction.x * rotation.x - direction.y * rotation.y,
+	                 direction.x * rotation.y + direction.y * rotation.x);
+
+	// jitter the first step so neighbouring pixels sample different rings
+	float rayPixels = noise.z * stepPixels + 1.0;
+
+	for (int s = 0; s < NUM_STEPS; ++s) {
+	    vec2 tapP = ssP + direction * rayPixels;
+
+	    int mip = clamp(int(floor(log2(rayPixels))) - LOG_MAX_OFFSET, 0, DEPTH_MIP_LEVELS);
+	    float tapZ = fetch_z(tapP, mip);
+	    vec3 tap = reconstruct_pos(tapZ, (floor(tapP) + 0.5) / sceneSize, projMatrix);
+
+	    // elevation above the tangent plane, faded out towards the radius
+	    vec3 v = tap - origin;
+	    float vv = dot(v, v);
+	    float nv = dot(normal, v) * inversesqrt(max(vv, 1e-8));
+	    float falloff = clamp(vv * negInvRadius2 + 1.0, 0.0, 1.0);
+	    occlusion += clamp(nv - ANGLE_BIAS, 0.0, 1.0) * falloff;
+
+	    rayPixels += stepPixels;
+	}
+    }
+
+    occlusion = 1.0 - occlusion / float(NUM_DIRECTIONS * NUM_STEPS);
+    occlusion = pow(occlusion, ssaoPower);
+
+    return occlusion;
+}
+
+
+void main(void)
+{
+    gl_FragColor = vec4(hbao(fragment_uv()));
+}
@@ -0,0 +1,22 @@
+#version 130
+
+// One texel of the hierarchical z buffer OcclusionCuller reads back: the
+// farthest view space distance in a HIZ_TILE square of the depth pyramid
+// base level.  A box nearer than that everywhere it covers is in front of
+// something, one farther is hidden.
+#define HIZ_TILE 16 // OcclusionCuller::HiZTile
+uniform sampler2D linearZTexture;
+// sceneSize is in blocks.glsl
+
+void main(void)
+{
+    ivec2 first = ivec2(gl_FragCoord.xy) * HIZ_TILE;
+    ivec2 last = min(first + ivec2(HIZ_TILE - 1), ivec2(sceneSize) - ivec2(1));
+
+    float farthest = 0.0;
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++)
+            farthest = max(farthest, -texelFetch(linearZTexture, ivec2(x, y), 0).r);
+    }
+    gl_FragColor = vec4(farthest);
+}
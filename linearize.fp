@@ -0,0 +1,19 @@
+#version 120
+
+// Turns the G-buffer depth into view space z, level 0 of the depth
+// pyramid the ssao pass samples
+uniform sampler2D linearDepthTexture;
+// projMatrix and texScale are in blocks.glsl
+
+void main(void)
+{
+    float depth = texture2D(linearDepthTexture, gl_TexCoord[0].st * texScale).r;
+
+    // Inverts the projection's z row, so orthographic cameras work too.
+    // Far plane fragments get the far plane z.
+    float ndcZ = depth * 2.0 - 1.0;
+    float z = (projMatrix[3][2] - ndcZ * projMatrix[3][3]) /
+              (ndcZ * projMatrix[2][3] - projMatrix[2][2]);
+
+    gl_FragColor = vec4(z);
+}
@@ -1,5 +1,6 @@
 #include "MainWindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
 
 #include <QFile>
 #include <QDir>
@@ -14,7 +15,13 @@ int main(int argc, char *argv[])
 
 
 
-    MainWindow w;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"write-scene", "Also write the generated scene to a file "
+                      "(e.g. testScene.osg).", "file"});
+    parser.process(a);
+
+    MainWindow w(0, parser.value("write-scene"));
     w.show();
 
     return a.exec();
@@ -12,6 +12,18 @@ vec3 phong(vec3 normal, vec3 lightPosition, vec3 position, vec3 ka, vec3 kd, vec
 	return ka + kd * max( dot(s, normal), 0.0 ) + ks * pow(max(dot(r,v), 0.0), shine);
 }
 
+#ifdef OCT_NORMALS
+// Octahedral encoding, two channels instead of three.  decode_normal() in
+// common.glsl is the matching decoder.
+vec2 oct_encode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.z >= 0.0 ? n.xy :
+	         (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return e * 0.5 + 0.5;
+}
+#endif
+
 void main(void)
 {
 	vec3 n = normalize(vertNormal);
@@ -23,5 +35,9 @@ void main(void)
 	gl_FragData[0] = vec4(color, 1.0);
 
 	// Normal buffer
+#ifdef OCT_NORMALS
+	gl_FragData[1] = vec4(oct_encode(n), 0.0, 1.0);
+#else
 	gl_FragData[1] = vec4(n * 0.5 + 0.5, 1.0);
+#endif
 }
@@ -0,0 +1,8 @@
+#version 120
+
+// Bounding boxes OcclusionCuller draws inside occlusion queries.  Color
+// and depth writes are off, only the samples passing the depth test count.
+void main(void)
+{
+    gl_FragColor = vec4(1.0);
+}
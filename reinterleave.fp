@@ -0,0 +1,17 @@
+#version 130
+
+// Gathers the occlusion of the DEINTERLEAVE^2 atlas layers back into
+// one image for the temporal, blur and composite passes
+#ifndef DEINTERLEAVE
+#define DEINTERLEAVE 2
+#endif
+
+uniform sampler2D aoTexture;
+// tileSize is in blocks.glsl
+
+void main(void)
+{
+    ivec2 aoP = ivec2(gl_FragCoord.xy);
+    ivec2 layer = aoP % DEINTERLEAVE;
+    gl_FragColor = texelFetch(aoTexture, layer * ivec2(tileSize) + aoP / DEINTERLEAVE, 0);
+}
@@ -1,89 +1,91 @@
-#version 120
+#version 130
 
-// G-buffer
-uniform sampler2D linearDepthTexture;
-uniform sampler2D normalTexture;
-uniform sampler2D colorTexture;
+// Hemisphere kernel occlusion.  The pyramid, DEINTERLEAVE, the noise and
+// the G-buffer fetches are in common.glsl.
 
-uniform sampler2D noiseTexture;
+// The kernel, matrices, sizes and settings are in blocks.glsl
 
-const int MAX_KERNEL_SIZE = 128;
-uniform vec3 ssaoKernel[MAX_KERNEL_SIZE];
+// TEMPORAL: each frame rotates the noise by frameRotation and takes
+// TEMPORAL_SAMPLES kernel taps, strided through the kernel from
+// kernelPhase.  The temporal pass accumulates the frames.
 
-uniform mat4 projMatrix;
-uniform mat4 invProjMatrix;
-uniform vec2 noiseTextureRcp;
-uniform int kernelSize;
-
-uniform float ssaoRadius;
-uniform float ssaoPower;
-
-uniform int displayType = 0; 
-
-vec3 reconstruct_pos(float z, vec2 vTexCoord, in mat4 projMatrix){
-    vec4 vProjectedPos = vec4(vTexCoord * 2.0 - 1.0, z, 1.0f);
-    vProjectedPos = invProjMatrix * vProjectedPos; 
-    return vProjectedPos.xyz / vProjectedPos.w;  
-}
+float ssao(vec2 uv)
+{
+    // Full resolution pixel of this fragment
+    vec2 ssP = uv * sceneSize;
 
-float reconstruct_z(in float depth, in mat4 projMatrix){
-    return -projMatrix[3][2] / (depth + projMatrix[2][2]);
-}
+    float originZ = fetch_z(ssP, 0);
 
-float ssao()
-{
-    //	Calculate view space position
-    float originDepthNormalized = texture2D(linearDepthTexture, gl_TexCoord[0].st).r;
-	
-    // Skip fragments on far plane
-    if (originDepthNormalized == 1.0f) return 1.0f;
+    // Skip fragments on far plane (linearize.fp stores far z there)
+    float farZ = (projMatrix[3][2] - projMatrix[3][3]) / (projMatrix[2][3] - projMatrix[2][2]);
+    if (originZ <= farZ + abs(farZ) * 1e-5) return 1.0f;
 
-    vec3 origin = reconstruct_pos(originDepthNormalized, gl_TexCoord[0].st, projMatrix);
+    vec3 origin = reconstruct_pos(originZ, uv, projMatrix);
 
     // Fetch view space normal
-    vec3 normal = normalize(texture2D(normalTexture, gl_TexCoord[0].st).xyz * 2.0 - 1.0);
+    vec3 normal = fetch_normal(uv);
 
-    // Fetch noise
-    vec3 rvec = texture2D(noiseTexture, gl_TexCoord[0].st * noiseTextureRcp).xyz * 2.0 - 1.0;
+    // Fetch noise, the kernel only turns about the normal
+    vec3 rvec = vec3(fetch_noise(uv).xy * 2.0 - 1.0, 0.0);
+#ifdef TEMPORAL
+    rvec.xy = vec2(rvec.x * frameRotation.x - rvec.y * frameRotation.y,
+                   rvec.x * frameRotation.y + rvec.y * frameRotation.x);
+#endif
 
     // Calculate change-of-basis matrix (view space -> "face" space)
     vec3 tangent = normalize(rvec - dot(rvec, normal) * normal);
     vec3 bitangent = cross(tangent, normal);
     mat3 tbn = mat3(tangent, bitangent, normal);
-	
+
+    // Pixels per view space unit at the origin's depth.  Taps are offset
+    // with this instead of being projected one by one, which is exact
+    // for orthographic and close enough for the small perspective
+    // change across one radius.
+    float w = projMatrix[2][3] * originZ + projMatrix[3][3];
+    vec2 pixelsPerUnit = 0.5 * sceneSize * vec2(projMatrix[0][0], projMatrix[1][1]) / w;
+
     float occlusion = 0.0;
 
+#ifdef TEMPORAL
+    int sampleCount = TEMPORAL_SAMPLES;
+    int stride = kernelSize / TEMPORAL_SAMPLES;
+
+    for (int j = 0; j < TEMPORAL_SAMPLES; ++j) {
+	int i = j * stride + kernelPhase;
+#else
+    int sampleCount = kernelSize;
+
     for (int i = 0; i < kernelSize; ++i) {
+#endif
 
 	// get sample position:
-	vec3 _sample = origin + (tbn * (ssaoKernel[i])) * ssaoRadius;
-
-	// project sample position:
-	vec4 offset = projMatrix * vec4(_sample, 1.0);
+	vec3 offset = (tbn * ssaoKernel[i].xyz) * ssaoRadius;
+	vec3 _sample = origin + offset;
 
-	offset.xy /= offset.w;
-	offset.xy = offset.xy * 0.5 + 0.5;
+	// screen space offset and the pyramid level that matches it:
+	vec2 ssOffset = offset.xy * pixelsPerUnit;
+	float ssR = max(length(ssOffset), 1.0);
+	int mip = clamp(int(floor(log2(ssR))) - LOG_MAX_OFFSET, 0, DEPTH_MIP_LEVELS);
 
 	// get sample depth:
-	float sampleDepth = texture2D(linearDepthTexture, offset.xy).r;
-	sampleDepth = reconstruct_z(sampleDepth, projMatrix);
-	
+	float sampleDepth = fetch_z(ssP + ssOffset, mip);
+
 	float dist = abs(origin.z - sampleDepth);
-		
+
 	float rangeCheck = smoothstep(0.0, 1.0, ssaoRadius / dist);
 	occlusion += rangeCheck * step(_sample.z, sampleDepth);
     }
 
-    occlusion = 1.0 - (occlusion / float(kernelSize));
+    occlusion = 1.0 - (occlusion / float(sampleCount));
     occlusion = pow(occlusion, ssaoPower);
-	 
+
     return occlusion;
 }
 
 
 void main(void)
 {
-    float occlusion = ssao();
-    vec3 color = texture2D(colorTexture, gl_TexCoord[0].st).rgb;
-    gl_FragColor = vec4(color, occlusion);
+    // Color is read straight from the G-buffer by the composite pass,
+    // so this target only carries occlusion (and may be low resolution)
+    gl_FragColor = vec4(ssao(fragment_uv()));
 }
@@ -0,0 +1,52 @@
+#version 130
+
+// Accumulates occlusion over frames.  The current pixel is reprojected
+// into the previous frame, and the history there is blended in unless
+// its view z says a different surface was visible (disocclusion).
+// Output: r = occlusion, g = accumulated frames / TEMPORAL_FRAMES, b = view z
+#ifndef TEMPORAL_FRAMES
+#define TEMPORAL_FRAMES 8
+#endif
+
+// History further than this fraction of the depth away is rejected
+#define REJECT_DEPTH 0.02
+
+uniform sampler2D aoTexture;      // this frame's occlusion
+uniform sampler2D historyTexture; // previous output of this pass
+uniform sampler2D linearZTexture; // view space z
+
+// projMatrix, previousProjMatrix, viewToPreviousView, sceneSize,
+// aoTexScale and historyValid are in blocks.glsl, reconstruct_pos() in
+// common.glsl
+
+void main(void)
+{
+    vec2 uv = gl_TexCoord[0].st;
+    float ao = texture2D(aoTexture, uv * aoTexScale).r;
+
+    ivec2 ssP = clamp(ivec2(uv * sceneSize), ivec2(0), ivec2(sceneSize) - ivec2(1));
+    float z = texelFetch(linearZTexture, ssP, 0).r;
+    vec3 position = reconstruct_pos(z, uv, projMatrix);
+
+    // Where this surface was last frame
+    vec4 previousPosition = viewToPreviousView * vec4(position, 1.0);
+    vec4 previousClip = previousProjMatrix * previousPosition;
+    vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+
+    float frames = 1.0;
+    float result = ao;
+
+    bool onScreen = all(greaterThanEqual(previousUV, vec2(0.0))) &&
+                    all(lessThanEqual(previousUV, vec2(1.0)));
+
+    if (historyValid > 0.5 && onScreen && previousClip.w > 0.0) {
+        vec4 history = texture2D(historyTexture, previousUV * aoTexScale);
+
+        if (abs(history.b - previousPosition.z) < REJECT_DEPTH * abs(previousPosition.z)) {
+            frames = min(history.g * float(TEMPORAL_FRAMES) + 1.0, float(TEMPORAL_FRAMES));
+            result = mix(history.r, ao, 1.0 / frames);
+        }
+    }
+
+    gl_FragColor = vec4(result, frames / float(TEMPORAL_FRAMES), z, 1.0);
+}
@@ -0,0 +1,316 @@
+#include "PagedTileWriter.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/PagedLOD>
+#include <osg/TriangleIndexFunctor>
+#include <osgDB/WriteFile>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace {
+
+struct IndexCollector {
+    std::vector<unsigned int>* indices;
+    void operator()(unsigned int i1, unsigned int i2, unsigned int i3)
+    {
+        if (i1 == i2 || i2 == i3 || i1 == i3)
+            return;
+        indices->push_back(i1);
+        indices->push_back(i2);
+        indices->push_back(i3);
+    }
+};
+
+// Gathers the triangles of every Geometry in world space.  Active children
+// only, so LODs and Switches contribute what they show by default.
+class TriangleCollector : public osg::NodeVisitor
+{
+public:
+    TriangleCollector(std::vector<PagedTileWriter::Triangle>& triangles)
+        : osg::NodeVisitor(TRAVERSE_ACTIVE_CHILDREN)
+        , m_triangles(triangles)
+    {}
+
+    virtual void apply(osg::Geode& geode)
+    {
+        osg::Matrix matrix = osg::computeLocalToWorld(getNodePath());
+        osg::Matrix inverse = osg::Matrix::inverse(matrix);
+        for (unsigned int i = 0; i < geode.getNumDrawables(); i++) {
+            osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+            if (geometry)
+                collect(*geometry, matrix, inverse);
+        }
+    }
+
+private:
+    void collect(osg::Geometry& geometry, const osg::Matrix& matrix,
+                 const osg::Matrix& inverse)
+    {
+        const osg::Vec3Array* vertices =
+                dynamic_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+        if (!vertices || vertices->empty())
+            return;
+
+        const osg::Vec3Array* normals =
+                dynamic_cast<const osg::Vec3Array*>(geometry.getNormalArray());
+        if (normals && (normals->getBinding() != osg::Array::BIND_PER_VERTEX ||
+                        normals->size() < vertices->size()))
+            normals = 0;
+
+        const osg::Vec4Array* colors =
+                dynamic_cast<const osg::Vec4Array*>(geometry.getColorArray());
+        bool perVertexColor = colors &&
+                colors->getBinding() == osg::Array::BIND_PER_VERTEX &&
+                colors->size() >= vertices->size();
+        osg::Vec4 color(0.8f, 0.8f, 0.8f, 1.0f);
+        if (colors && !perVertexColor && !colors->empty())
+            color = colors->front();
+
+        std::vector<unsigned int> indices;
+        osg::TriangleIndexFunctor<IndexCollector> functor;
+        functor.indices = &indices;
+        geometry.accept(functor);
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            PagedTileWriter::Triangle triangle;
+            for (int c = 0; c < 3; c++) {
+                unsigned int index = indices[i + c];
+                PagedTileWriter::Vertex& v = triangle.v[c];
+                v.position = (*vertices)[index] * matrix;
+                if (normals) {
+                    // Normals go by the inverse transpose
+                    v.normal = osg::Matrix::transform3x3(inverse, (*normals)[index]);
+                    v.normal.normalize();
+                }
+                v.color = perVertexColor ? (*colors)[index] : color;
+            }
+            if (!normals) {
+                osg::Vec3 face = (triangle.v[1].position - triangle.v[0].position) ^
+                        (triangle.v[2].position - triangle.v[0].position);
+                if (face.normalize() == 0.0f)
+                    continue;
+                for (int c = 0; c < 3; c++)
+                    triangle.v[c].normal = face;
+            }
+            m_triangles.push_back(triangle);
+        }
+    }
+
+    std::vector<PagedTileWriter::Triangle>& m_triangles;
+};
+
+osg::ref_ptr<osg::Geode> makeGeode(const std::vector<PagedTileWriter::Vertex>& vertices,
+                                   const std::vector<unsigned int>& indices)
+{
+    osg::ref_ptr<osg::Vec3Array> positions = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+    positions->reserve(vertices.size());
+    normals->reserve(vertices.size());
+    colors->reserve(vertices.size());
+    for (const PagedTileWriter::Vertex& v : vertices) {
+        positions->push_back(v.position);
+        normals->push_back(v.normal);
+        colors->push_back(v.color);
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(positions.get());
+    geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawElementsUInt(
+            GL_TRIANGLES, indices.begin(), indices.end()));
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode;
+}
+
+osg::BoundingBox boundsOf(const std::vector<PagedTileWriter::Triangle>& triangles)
+{
+    osg::BoundingBox bounds;
+    for (const PagedTileWriter::Triangle& t : triangles) {
+        for (int c = 0; c < 3; c++)
+            bounds.expandBy(t.v[c].position);
+    }
+    return bounds;
+}
+
+int longestAxis(const osg::BoundingBox& bounds)
+{
+    osg::Vec3 size = bounds._max - bounds._min;
+    if (size.x() >= size.y() && size.x() >= size.z())
+        return 0;
+    return size.y() >= size.z() ? 1 : 2;
+}
+
+} // namespace
+
+bool PagedTileWriter::Vertex::operator<(const Vertex& other) const
+{
+    if (position != other.position)
+        return position < other.position;
+    if (normal != other.normal)
+        return normal < other.normal;
+    return color < other.color;
+}
+
+PagedTileWriter::PagedTileWriter(const Options& options)
+    : m_options(options)
+    , m_failed(false)
+{
+}
+
+bool PagedTileWriter::write(osg::Node* model, const std::string& directory)
+{
+    m_directory = directory;
+    m_result = Result();
+    m_failed = false;
+
+    std::vector<Triangle> triangles;
+    TriangleCollector collector(triangles);
+    model->accept(collector);
+    if (triangles.empty())
+        return false;
+
+    osg::ref_ptr<osg::Node> root = buildTile(triangles, "t", 0);
+    return writeFile(root.get(), "root.osgb") && !m_failed;
+}
+
+osg::ref_ptr<osg::Node> PagedTileWriter::buildTile(std::vector<Triangle>& triangles,
+                                                   const std::string& name,
+                                                   unsigned int depth)
+{
+    m_result.depth = std::max(m_result.depth, depth);
+
+    if (triangles.size() <= size_t(std::max(m_options.tileTriangles, 1))) {
+        // Full detail, with shared vertices
+        std::map<Vertex, unsigned int> lookup;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        indices.reserve(triangles.size() * 3);
+        for (const Triangle& t : triangles) {
+            for (int c = 0; c < 3; c++) {
+                auto inserted = lookup.insert(
+                        std::make_pair(t.v[c], (unsigned int)vertices.size()));
+                if (inserted.second)
+                    vertices.push_back(t.v[c]);
+                indices.push_back(inserted.first->second);
+            }
+        }
+        m_result.tiles++;
+        m_result.triangles += (unsigned int)triangles.size();
+        return makeGeode(vertices, indices);
+    }
+
+    osg::BoundingBox bounds = boundsOf(triangles);
+    osg::ref_ptr<osg::Node> coarse = buildCoarse(triangles);
+
+    // Halve at the median centroid along the longest side
+    int axis = longestAxis(bounds);
+    auto centroid = [axis](const Triangle& t) {
+        return t.v[0].position[axis] + t.v[1].position[axis] + t.v[2].position[axis];
+    };
+    size_t middle = triangles.size() / 2;
+    std::nth_element(triangles.begin(), triangles.begin() + middle, triangles.end(),
+                     [&centroid](const Triangle& a, const Triangle& b) {
+                         return centroid(a) < centroid(b);
+                     });
+    std::vector<Triangle> upper(triangles.begin() + middle, triangles.end());
+    triangles.resize(middle);
+    triangles.shrink_to_fit();
+
+    osg::ref_ptr<osg::Group> halves = new osg::Group;
+    halves->addChild(buildTile(triangles, name + "0", depth + 1).get());
+    halves->addChild(buildTile(upper, name + "1", depth + 1).get());
+    std::string fileName = name + "_sub.osgb";
+    writeFile(halves.get(), fileName);
+
+    float radius = (bounds._max - bounds._min).length() * 0.5f;
+    float switchDistance = radius * m_options.rangeScale;
+
+    osg::ref_ptr<osg::PagedLOD> lod = new osg::PagedLOD;
+    lod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+    lod->setCenter(bounds.center());
+    lod->setRadius(radius);
+    lod->addChild(coarse.get(), switchDistance, FLT_MAX);
+    lod->setFileName(1, fileName);
+    lod->setRange(1, 0.0f, switchDistance);
+    return lod;
+}
+
+osg::ref_ptr<osg::Node> PagedTileWriter::buildCoarse(const std::vector<Triangle>& triangles) const
+{
+    // Vertices in the same grid cell collapse to their average
+    osg::BoundingBox bounds = boundsOf(triangles);
+    osg::Vec3 size = bounds._max - bounds._min;
+    float cell = std::max(std::max(size.x(), size.y()), size.z()) /
+            float(std::max(m_options.clusterGrid, 1));
+    if (cell <= 0.0f)
+        cell = 1.0f;
+
+    struct Cluster {
+        Vertex sum;
+        unsigned int count = 0;
+    };
+    std::map<std::array<int, 3>, unsigned int> cellIndex;
+    std::vector<Cluster> clusters;
+    auto clusterOf = [&](const Vertex& v) {
+        osg::Vec3 p = (v.position - bounds._min) / cell;
+        std::array<int, 3> key = {{int(p.x()), int(p.y()), int(p.z())}};
+        auto inserted = cellIndex.insert(
+                std::make_pair(key, (unsigned int)clusters.size()));
+        if (inserted.second)
+            clusters.push_back(Cluster());
+        Cluster& c = clusters[inserted.first->second];
+        c.sum.position += v.position;
+        c.sum.normal += v.normal;
+        c.sum.color += v.color;
+        c.count++;
+        return inserted.first->second;
+    };
+
+    std::vector<unsigned int> indices;
+    std::set<std::array<unsigned int, 3> > seen;
+    for (const Triangle& t : triangles) {
+        std::array<unsigned int, 3> tri = {{clusterOf(t.v[0]), clusterOf(t.v[1]),
+                                            clusterOf(t.v[2])}};
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+            continue;
+        std::array<unsigned int, 3> sorted = tri;
+        std::sort(sorted.begin(), sorted.end());
+        if (!seen.insert(sorted).second)
+            continue;
+        indices.insert(indices.end(), tri.begin(), tri.end());
+    }
+
+    std::vector<Vertex> vertices(clusters.size());
+    for (size_t i = 0; i < clusters.size(); i++) {
+        float n = float(clusters[i].count);
+        vertices[i].position = clusters[i].sum.position / n;
+        vertices[i].normal = clusters[i].sum.normal;
+        if (vertices[i].normal.normalize() == 0.0f)
+            vertices[i].normal.set(0.0f, 0.0f, 1.0f);
+        vertices[i].color = clusters[i].sum.color / n;
+    }
+    return makeGeode(vertices, indices);
+}
+
+bool PagedTileWriter::writeFile(osg::Node* node, const std::string& name)
+{
+    if (!osgDB::writeNodeFile(*node, m_directory + "/" + name)) {
+        m_failed = true;
+        return false;
+    }
+    m_result.files++;
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef PAGEDTILEWRITER_H
+#define PAGEDTILEWRITER_H
+
+#include "ScenePager.h"
+
+#include <osg/Node>
+
+#include <string>
+#include <vector>
+
+// Splits a model into a binary tree of tiles on disk.  Each inner tile is
+// a PagedLOD that draws a coarse version of its triangles from afar and
+// pages in its two halves, one .osgb file, up close.  Leaves hold the full
+// triangles.  The coarse versions come from vertex clustering on a grid,
+// which needs no connectivity and so copes with any triangle soup.
+// Geometry is flattened to world space with per vertex colors, textures
+// are dropped.
+class PagedTileWriter
+{
+public:
+    struct Options {
+        int tileTriangles = ScenePager::DefaultTileTriangles; // most in a leaf
+        int clusterGrid = 64;    // cells along the longest side of a coarse tile
+        float rangeScale = 3.0f; // halves are drawn within this many radii
+    };
+
+    struct Result {
+        unsigned int files = 0;     // root.osgb included
+        unsigned int tiles = 0;     // leaves
+        unsigned int triangles = 0; // in the leaves
+        unsigned int depth = 0;
+    };
+
+    explicit PagedTileWriter(const Options& options = Options());
+
+    // Writes <directory>/root.osgb and the files it pages in.  False when
+    // the model has no triangles or a file could not be written.
+    bool write(osg::Node* model, const std::string& directory);
+
+    const Result& result() const { return m_result; }
+
+    struct Vertex {
+        osg::Vec3 position;
+        osg::Vec3 normal;
+        osg::Vec4 color;
+        bool operator<(const Vertex& other) const;
+    };
+    struct Triangle {
+        Vertex v[3];
+    };
+
+private:
+    osg::ref_ptr<osg::Node> buildTile(std::vector<Triangle>& triangles,
+                                      const std::string& name, unsigned int depth);
+    osg::ref_ptr<osg::Node> buildCoarse(const std::vector<Triangle>& triangles) const;
+    bool writeFile(osg::Node* node, const std::string& name);
+
+    Options m_options;
+    std::string m_directory;
+    Result m_result;
+    bool m_failed;
+};
+
+#endif // PAGEDTILEWRITER_H
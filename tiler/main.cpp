@@ -0,0 +1,76 @@
+// Cuts a model into PagedLOD tiles the viewer pages in as the camera gets
+// close, for CAD models too large to keep in memory at once:
+//
+//   ssao_tiler plant.osgb tiles/ --triangles 32768
+//
+// then open tiles/root.osgb with File > Open.
+//
+#include "PagedTileWriter.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QTextStream>
+
+#include <osgDB/ReadFile>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    PagedTileWriter::Options options;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes a model as PagedLOD tiles");
+    parser.addHelpOption();
+    parser.addPositionalArgument("model", "Model file to tile.");
+    parser.addPositionalArgument("directory", "Output directory.");
+    parser.addOptions({
+        {"triangles", "Most triangles in a full detail tile.", "n",
+         QString::number(options.tileTriangles)},
+        {"grid", "Clustering cells along a coarse tile.", "n",
+         QString::number(options.clusterGrid)},
+        {"range", "Tile radii within which a tile is refined.", "r",
+         QString::number(options.rangeScale)},
+    });
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+    if (args.size() != 2) {
+        err << parser.helpText();
+        return 1;
+    }
+
+    bool ok = true;
+    options.tileTriangles = parser.value("triangles").toInt(&ok);
+    if (ok) options.clusterGrid = parser.value("grid").toInt(&ok);
+    if (ok) options.rangeScale = parser.value("range").toFloat(&ok);
+    if (!ok || options.tileTriangles < 1 || options.clusterGrid < 1 ||
+            options.rangeScale <= 0.0f) {
+        err << "invalid --triangles, --grid or --range\n";
+        return 1;
+    }
+
+    osg::ref_ptr<osg::Node> model = osgDB::readNodeFile(args[0].toStdString());
+    if (!model) {
+        err << "cannot read " << args[0] << "\n";
+        return 1;
+    }
+    if (!QDir().mkpath(args[1])) {
+        err << "cannot create " << args[1] << "\n";
+        return 1;
+    }
+
+    PagedTileWriter writer(options);
+    if (!writer.write(model.get(), QDir(args[1]).absolutePath().toStdString())) {
+        err << "tiling " << args[0] << " failed\n";
+        return 1;
+    }
+
+    const PagedTileWriter::Result& result = writer.result();
+    out << result.triangles << " triangles in " << result.tiles << " tiles, "
+        << result.files << " files, depth " << result.depth << "\n";
+    return 0;
+}